@@ -0,0 +1,128 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "acquisitionthread.h"
+#include "monotonicclock.h"
+
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+//Default constructor
+AcquisitionThread::AcquisitionThread(QObject *parent) : QThread(parent)
+{
+    this->m_realtime = false;
+    this->m_priority = 80;
+    this->m_cpu = -1;
+    this->setFrequency(this->minFrequency);
+}
+
+//Destructor
+AcquisitionThread::~AcquisitionThread()
+{
+    this->Stop();
+}
+
+//Sets the sampling frequency
+//The period is kept in nanoseconds so it is not truncated to whole ms
+void AcquisitionThread::setFrequency(int frequency)
+{
+    if(frequency < this->minFrequency)
+        frequency = this->minFrequency;
+    else if(frequency > this->maxFrequency)
+        frequency = this->maxFrequency;
+    this->m_frequency = frequency;
+    this->m_period = 1000000000LL / frequency;
+    this->m_timingStats.setPeriod(this->m_period);
+}
+
+//Stops the acquisition loop
+void AcquisitionThread::Stop()
+{
+    this->requestInterruption();
+    if(this->isRunning())
+        this->wait();
+}
+
+//Acquisition loop
+//Sleeps until an absolute deadline and then emits "tick"
+//If a deadline is missed the loop skips to the next point of the
+//grid instead of firing a burst of late ticks
+void AcquisitionThread::run()
+{
+    this->setupScheduling();
+
+    qint64 deadline = MonotonicClock::Now();
+    while(!this->isInterruptionRequested())
+    {
+        deadline += this->m_period;
+
+#ifdef Q_OS_LINUX
+        struct timespec ts;
+        ts.tv_sec = deadline / 1000000000LL;
+        ts.tv_nsec = deadline % 1000000000LL;
+        //Restarts the sleep if it is interrupted by a signal
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+                                          std::chrono::nanoseconds(deadline)));
+#endif
+
+        if(this->isInterruptionRequested())
+            break;
+
+        this->m_timingStats.AddTick(deadline, MonotonicClock::Now());
+        emit this->tick();
+
+        //Realigns the deadline if the tick took longer than a full period
+        //The skipped grid points are counted as missed deadlines
+        qint64 now = MonotonicClock::Now();
+        if(now - deadline > this->m_period)
+        {
+            qint64 skipped = (now - deadline) / this->m_period;
+            deadline += skipped * this->m_period;
+            this->m_timingStats.AddMissed((int)skipped);
+        }
+    }
+}
+
+//Applies SCHED_FIFO and the CPU affinity if they were requested
+void AcquisitionThread::setupScheduling()
+{
+#ifdef Q_OS_LINUX
+    if(this->m_cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(this->m_cpu, &cpuset);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if(ret != 0)
+            qDebug() << "Acquisition: could not pin to CPU" << this->m_cpu << ":" << strerror(ret);
+    }
+    if(this->m_realtime)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = this->m_priority;
+        int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if(ret != 0)
+            qDebug() << "Acquisition: SCHED_FIFO not available:" << strerror(ret);
+    }
+#else
+    if(this->m_realtime)
+        this->setPriority(QThread::TimeCriticalPriority);
+#endif
+}
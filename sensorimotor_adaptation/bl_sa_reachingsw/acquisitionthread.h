@@ -0,0 +1,93 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Thread that drives the data acquisition at a fixed sampling
+ * period. Each period ends at an absolute deadline (clock_nanosleep on
+ * Linux), so the sample grid does not drift with the time spent in the tick,
+ * in rendering or in disk I/O. Optionally runs with SCHED_FIFO priority and
+ * pinned to a single CPU.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef ACQUISITIONTHREAD_H
+#define ACQUISITIONTHREAD_H
+
+#include <QThread>
+#include "timingstats.h"
+
+class AcquisitionThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    //Constructor
+    AcquisitionThread(QObject *parent = 0);
+    ~AcquisitionThread();
+
+    //Methods
+    //Stops the acquisition loop and waits for the thread to finish
+    void Stop();
+
+    //Getters and setters
+    //Sampling frequency (Hz), limited to the supported range
+    void setFrequency(int frequency);
+    int frequency() const
+    {
+        return m_frequency;
+    }
+    //Sampling period (ns)
+    qint64 period() const
+    {
+        return m_period;
+    }
+    //Requests SCHED_FIFO with the given priority (1-99)
+    //Requires CAP_SYS_NICE or an rtprio limit, otherwise it is ignored
+    void setRealtimePriority(bool realtime, int priority = 80)
+    {
+        m_realtime = realtime;
+        m_priority = priority;
+    }
+    //Pins the thread to the given CPU (-1 means no pinning)
+    void setCpuAffinity(int cpu)
+    {
+        m_cpu = cpu;
+    }
+    //Timing of the ticks since the last TimingStats::Reset()
+    //Only to be used from the tick slot (acquisition thread)
+    TimingStats* timingStats()
+    {
+        return &m_timingStats;
+    }
+
+    //Supported sampling frequencies (Hz)
+    static const int minFrequency = 100;
+    static const int maxFrequency = 2000;
+
+signals:
+    //Emitted once per sampling period from the acquisition thread
+    //Connect with Qt::DirectConnection so the slot runs on this thread
+    void tick();
+
+protected:
+    void run();
+
+private:
+    //Fields
+    int m_frequency;
+    qint64 m_period;
+    bool m_realtime;
+    int m_priority;
+    int m_cpu;
+    TimingStats m_timingStats;
+
+    //Methods
+    //Applies the scheduling policy and CPU affinity to the calling thread
+    void setupScheduling();
+};
+
+#endif // ACQUISITIONTHREAD_H
@@ -0,0 +1,196 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "adaptationestimator.h"
+
+#include <cmath>
+
+//Default constructor
+AdaptationEstimator::AdaptationEstimator(AdaptationModel::Model _model, int _delay)
+{
+    this->m_model = _model;
+    //The history holds two trials and the delay
+    this->m_delay = qBound(0, _delay, (int)historySize - 3);
+    this->regressors = _model == AdaptationModel::TwoState ? 4 : (_model == AdaptationModel::SingleState ? 2 : 1);
+    this->Reset();
+}
+
+void AdaptationEstimator::Reset()
+{
+    for(int i=0; i<maxRegressors; i++)
+    {
+        for(int j=0; j<maxRegressors; j++)
+            this->XtX[i][j] = 0;
+        this->Xty[i] = 0;
+    }
+    this->m_rows = 0;
+    this->Skip();
+}
+
+void AdaptationEstimator::Skip()
+{
+    this->head = 0;
+    this->history = 0;
+}
+
+void AdaptationEstimator::Update(double _perturbation, double _error, bool _errorSeen)
+{
+    double x = _perturbation - _error;
+    int lags = this->m_delay + (this->m_model == AdaptationModel::TwoState ? 2 : 1);
+    if(this->history >= lags)
+    {
+        double row[maxRegressors];
+        double y = x;
+        switch(this->m_model)
+        {
+        case AdaptationModel::Simple:
+            y = x - this->vX[this->past(1)];
+            row[0] = this->vU[this->past(1 + this->m_delay)];
+            break;
+        case AdaptationModel::SingleState:
+            row[0] = this->vX[this->past(1)];
+            row[1] = this->vU[this->past(1 + this->m_delay)];
+            break;
+        default:
+            row[0] = this->vX[this->past(1)];
+            row[1] = this->vX[this->past(2)];
+            row[2] = this->vU[this->past(1 + this->m_delay)];
+            row[3] = this->vU[this->past(2 + this->m_delay)];
+            break;
+        }
+        for(int i=0; i<this->regressors; i++)
+        {
+            for(int j=0; j<this->regressors; j++)
+                this->XtX[i][j] += row[i] * row[j];
+            this->Xty[i] += row[i] * y;
+        }
+        this->m_rows++;
+    }
+
+    this->head = (this->head + 1) % historySize;
+    this->vX[this->head] = x;
+    this->vU[this->head] = _errorSeen ? _error : 0;
+    if(this->history < historySize)
+        this->history++;
+}
+
+//Index of the trial _k trials before the one being added
+//(the head holds the trial just before it)
+int AdaptationEstimator::past(int _k) const
+{
+    return (this->head + historySize + 1 - _k) % historySize;
+}
+
+bool AdaptationEstimator::Estimate(AdaptationParameters &_parameters) const
+{
+    //Gaussian elimination with partial pivoting on a copy of the normal equations
+    int n = this->regressors;
+    double M[maxRegressors][maxRegressors + 1];
+    double scale = 0;
+    for(int i=0; i<n; i++)
+    {
+        for(int j=0; j<n; j++)
+            M[i][j] = this->XtX[i][j];
+        M[i][n] = this->Xty[i];
+        scale = qMax(scale, this->XtX[i][i]);
+    }
+    if(this->m_rows < n || scale <= 0)
+        return false;
+    for(int c=0; c<n; c++)
+    {
+        int pivot = c;
+        for(int r=c+1; r<n; r++)
+            if(fabs(M[r][c]) > fabs(M[pivot][c]))
+                pivot = r;
+        if(fabs(M[pivot][c]) <= 1e-12 * scale)
+            return false;
+        for(int j=0; j<=n; j++)
+            qSwap(M[c][j], M[pivot][j]);
+        for(int r=c+1; r<n; r++)
+        {
+            double f = M[r][c] / M[c][c];
+            for(int j=c; j<=n; j++)
+                M[r][j] -= f * M[c][j];
+        }
+    }
+    double theta[maxRegressors];
+    for(int r=n-1; r>=0; r--)
+    {
+        double sum = M[r][n];
+        for(int j=r+1; j<n; j++)
+            sum -= M[r][j] * theta[j];
+        theta[r] = sum / M[r][r];
+    }
+
+    _parameters = AdaptationParameters();
+    switch(this->m_model)
+    {
+    case AdaptationModel::Simple:
+        _parameters.retention = 1;
+        _parameters.learningRate = theta[0];
+        break;
+    case AdaptationModel::SingleState:
+        _parameters.retention = theta[0];
+        _parameters.learningRate = theta[1];
+        break;
+    default:
+    {
+        //Af and As are the roots of z^2 - a1 z - a2
+        double a1 = theta[0], a2 = theta[1], b1 = theta[2], b2 = theta[3];
+        double discriminant = a1*a1 + 4*a2;
+        if(discriminant <= 0)
+            return false;
+        double root = sqrt(discriminant);
+        double Af = (a1 - root) / 2;
+        double As = (a1 + root) / 2;
+        double Bf = (-b2 - b1*Af) / (As - Af);
+        _parameters.fastRetention = Af;
+        _parameters.fastRate = Bf;
+        _parameters.slowRetention = As;
+        _parameters.slowRate = b1 - Bf;
+        break;
+    }
+    }
+    return true;
+}
+
+QString AdaptationEstimator::Describe() const
+{
+    AdaptationParameters parameters;
+    bool valid = this->Estimate(parameters);
+    QString name = QString(AdaptationModel::Name(this->m_model)) + " model ";
+    QString text;
+    if(this->m_model == AdaptationModel::TwoState)
+    {
+        text += name + "fast retention: " + (valid ? QString::number(parameters.fastRetention, 'f', 4) : QString("NaN")) + "\n";
+        text += name + "fast learning rate: " + (valid ? QString::number(parameters.fastRate, 'f', 4) : QString("NaN")) + "\n";
+        text += name + "slow retention: " + (valid ? QString::number(parameters.slowRetention, 'f', 4) : QString("NaN")) + "\n";
+        text += name + "slow learning rate: " + (valid ? QString::number(parameters.slowRate, 'f', 4) : QString("NaN")) + "\n";
+    }
+    else
+    {
+        if(this->m_model == AdaptationModel::SingleState)
+            text += name + "retention: " + (valid ? QString::number(parameters.retention, 'f', 4) : QString("NaN")) + "\n";
+        text += name + "learning rate: " + (valid ? QString::number(parameters.learningRate, 'f', 4) : QString("NaN")) + "\n";
+    }
+    return text;
+}
+
+bool AdaptationEstimator::Fit(AdaptationModel::Model _model, const double *_perturbation, const double *_error,
+                              const bool *_errorSeen, int _trials, AdaptationParameters &_parameters, int _delay,
+                              const bool *_measured)
+{
+    AdaptationEstimator estimator(_model, _delay);
+    for(int i=0; i<_trials; i++)
+    {
+        if(_measured == NULL || _measured[i])
+            estimator.Update(_perturbation[i], _error[i], _errorSeen == NULL || _errorSeen[i]);
+        else
+            estimator.Skip();
+    }
+    return estimator.Estimate(_parameters);
+}
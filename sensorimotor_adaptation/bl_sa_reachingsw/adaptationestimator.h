@@ -0,0 +1,103 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Fits a model of AdaptationModel to the trials while they are
+ * performed. Each trial gives the adaptation x(n) = p(n) - e(n) from the
+ * direction error of the visual feedback e(n), which includes the rotation
+ * p(n). The model is linear in its parameters when written as a regression
+ * of x(n) on the trials before it:
+ * - simple:       x(n) - x(n-1) = B u(n-1-d)
+ * - single-state: x(n) = A x(n-1) + B u(n-1-d)
+ * - two-state:    x(n) = a1 x(n-1) + a2 x(n-2) + b1 u(n-1-d) + b2 u(n-2-d)
+ *   with a1 = Af + As, a2 = -Af As, b1 = Bf + Bs, b2 = -(Bf As + Bs Af), so
+ *   Af and As are the roots of z^2 - a1 z - a2
+ * u is the error that drives the learning (0 on trials without feedback).
+ * Update() adds the row of each trial to the normal equations (recursive
+ * least squares, O(1) per trial) and Estimate() solves them (at most 4x4),
+ * so the parameters are available after every trial. Fit() is the batch
+ * mode: the same sums over a whole session, solved once, which gives the
+ * same numbers as the online updates (bl_sa_fit reports it next to the fit
+ * of the simulated adaptation).
+ * The errors of the direction are noisy, so the retentions are biased
+ * towards 0 on short sessions (least squares on the measured states).
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef ADAPTATIONESTIMATOR_H
+#define ADAPTATIONESTIMATOR_H
+
+#include <QtGlobal>
+#include <QString>
+#include "adaptationmodel.h"
+
+class AdaptationEstimator
+{
+public:
+    //Constructor
+    //_delay: delay of the error in trials (see AdaptationModel)
+    AdaptationEstimator(AdaptationModel::Model _model = AdaptationModel::SingleState, int _delay = 0);
+
+    //Methods
+    //Forgets every trial
+    void Reset();
+    //Adds a trial: perturbation and direction error of the feedback (degrees)
+    //and whether the error was seen (feedback shown)
+    void Update(double _perturbation, double _error, bool _errorSeen = true);
+    //Trial without a measurement: the rows after it do not use the trials before it
+    void Skip();
+    //Least-squares parameters of the trials so far
+    //Returns false while they cannot be identified (no perturbation yet, or
+    //the two-state roots are not real and distinct)
+    bool Estimate(AdaptationParameters &_parameters) const;
+    //"Name: value" lines of the parameters, as in the trial information
+    //(NaN while they cannot be identified)
+    QString Describe() const;
+    //Batch mode: fits the trials of a session at once
+    //_measured: the trial has a measurement (NULL: every trial), the others
+    //are skipped as in Skip()
+    static bool Fit(AdaptationModel::Model _model, const double *_perturbation, const double *_error,
+                    const bool *_errorSeen, int _trials, AdaptationParameters &_parameters, int _delay = 0,
+                    const bool *_measured = NULL);
+
+    //Getters
+    AdaptationModel::Model model() const
+    {
+        return m_model;
+    }
+    int delay() const
+    {
+        return m_delay;
+    }
+    //Trials in the regression
+    int rows() const
+    {
+        return m_rows;
+    }
+
+private:
+    enum { maxRegressors = 4, historySize = 8 };
+    //Fields
+    AdaptationModel::Model m_model;
+    int m_delay;
+    int regressors;
+    int m_rows;
+    //Normal equations
+    double XtX[maxRegressors][maxRegressors];
+    double Xty[maxRegressors];
+    //Adaptation and learning error of the last trials, and how many of
+    //them are consecutive
+    double vX[historySize];
+    double vU[historySize];
+    int head;
+    int history;
+
+    //Methods
+    int past(int _k) const;
+};
+
+#endif // ADAPTATIONESTIMATOR_H
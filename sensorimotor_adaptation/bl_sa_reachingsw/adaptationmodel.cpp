@@ -0,0 +1,184 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "adaptationmodel.h"
+
+void AdaptationCandidates::resize(int _size)
+{
+    this->vRetention.resize(_size);
+    this->vLearningRate.resize(_size);
+    this->vFastRetention.resize(_size);
+    this->vFastRate.resize(_size);
+    this->vSlowRetention.resize(_size);
+    this->vSlowRate.resize(_size);
+}
+
+void AdaptationCandidates::set(int _index, const AdaptationParameters &_parameters)
+{
+    this->vRetention[_index] = _parameters.retention;
+    this->vLearningRate[_index] = _parameters.learningRate;
+    this->vFastRetention[_index] = _parameters.fastRetention;
+    this->vFastRate[_index] = _parameters.fastRate;
+    this->vSlowRetention[_index] = _parameters.slowRetention;
+    this->vSlowRate[_index] = _parameters.slowRate;
+}
+
+AdaptationParameters AdaptationCandidates::at(int _index) const
+{
+    AdaptationParameters parameters;
+    parameters.retention = this->vRetention.at(_index);
+    parameters.learningRate = this->vLearningRate.at(_index);
+    parameters.fastRetention = this->vFastRetention.at(_index);
+    parameters.fastRate = this->vFastRate.at(_index);
+    parameters.slowRetention = this->vSlowRetention.at(_index);
+    parameters.slowRate = this->vSlowRate.at(_index);
+    return parameters;
+}
+
+AdaptationParameters AdaptationModel::ScriptParameters(Model _model)
+{
+    AdaptationParameters parameters;
+    parameters.retention = _model == Simple ? 1 : 0.99;
+    parameters.learningRate = 0.1;
+    parameters.fastRetention = 0.95;
+    parameters.fastRate = 0.06;
+    parameters.slowRetention = 0.995;
+    parameters.slowRate = 0.02;
+    return parameters;
+}
+
+int AdaptationModel::ScriptDelay(Model _model)
+{
+    return _model == TwoState ? 1 : 0;
+}
+
+const char* AdaptationModel::Name(Model _model)
+{
+    switch(_model)
+    {
+    case Simple:
+        return "simple";
+    case SingleState:
+        return "single-state";
+    default:
+        return "two-state";
+    }
+}
+
+void AdaptationModel::Simulate(Model _model, const AdaptationParameters &_parameters, const double *_perturbation,
+                               int _trials, double *_adaptation, int _delay, const bool *_errorSeen)
+{
+    double A = _model == Simple ? 1 : _parameters.retention;
+    double fast = 0, slow = 0;
+    for(int n=0; n<_trials; n++)
+    {
+        if(n == 0)
+        {
+            _adaptation[0] = 0;
+            continue;
+        }
+        //Error that drives the learning of this trial
+        int k = n - 1 - _delay;
+        double error = 0;
+        if(k >= 0 && (_errorSeen == NULL || _errorSeen[k]))
+            error = _perturbation[k] - _adaptation[k];
+        if(_model == TwoState)
+        {
+            fast = _parameters.fastRetention * fast + _parameters.fastRate * error;
+            slow = _parameters.slowRetention * slow + _parameters.slowRate * error;
+            _adaptation[n] = fast + slow;
+        }
+        else
+            _adaptation[n] = A * _adaptation[n-1] + _parameters.learningRate * error;
+    }
+}
+
+void AdaptationModel::Score(Model _model, const AdaptationCandidates &_candidates, const double *_perturbation,
+                            const double *_adaptation, int _trials, double *_sse, int _delay,
+                            const bool *_errorSeen, const bool *_measured)
+{
+    //The candidates are run in blocks: the parameters and the state of a
+    //block are local arrays, which stay in the cache for every trial and do
+    //not alias, so the loops over the candidates are vectorized
+    enum { block = 64, maxRows = 8 };
+    int delay = qBound(0, _delay, (int)maxRows - 1);
+    int rows = delay + 1;
+    int count = _candidates.size();
+    for(int first=0; first<count; first+=block)
+    {
+        int size = qMin((int)block, count - first);
+        double A[block], B[block], Af[block], Bf[block], As[block], Bs[block];
+        //The unused candidates of the last block are run with zeros
+        for(int k=0; k<block; k++)
+        {
+            bool used = k < size;
+            A[k] = used ? (_model == Simple ? 1 : _candidates.vRetention.at(first + k)) : 0;
+            B[k] = used ? _candidates.vLearningRate.at(first + k) : 0;
+            Af[k] = used ? _candidates.vFastRetention.at(first + k) : 0;
+            Bf[k] = used ? _candidates.vFastRate.at(first + k) : 0;
+            As[k] = used ? _candidates.vSlowRetention.at(first + k) : 0;
+            Bs[k] = used ? _candidates.vSlowRate.at(first + k) : 0;
+        }
+        //Adaptation, fast and slow processes, and the adaptation of the last
+        //trials (only read with a delay)
+        double x[block], fast[block], slow[block], sse[block];
+        double history[maxRows][block];
+        for(int k=0; k<block; k++)
+        {
+            x[k] = fast[k] = slow[k] = sse[k] = 0;
+            for(int r=0; r<rows; r++)
+                history[r][k] = 0;
+        }
+
+        for(int n=0; n<_trials; n++)
+        {
+            if(n > 0)
+            {
+                //Trial whose error drives the learning (gain 0 if none)
+                int t = n - 1 - delay;
+                bool learn = t >= 0 && (_errorSeen == NULL || _errorSeen[t]);
+                double p = learn ? _perturbation[t] : 0;
+                double gain = learn ? 1 : 0;
+                //Adaptation of that trial: x itself without a delay
+                const double *old = delay > 0 ? history[(learn ? t : 0) % rows] : x;
+                double error[block];
+                for(int k=0; k<block; k++)
+                    error[k] = gain * (p - old[k]);
+                if(_model == TwoState)
+                {
+                    for(int k=0; k<block; k++)
+                    {
+                        fast[k] = Af[k] * fast[k] + Bf[k] * error[k];
+                        slow[k] = As[k] * slow[k] + Bs[k] * error[k];
+                        x[k] = fast[k] + slow[k];
+                    }
+                }
+                else
+                {
+                    for(int k=0; k<block; k++)
+                        x[k] = A[k] * x[k] + B[k] * error[k];
+                }
+            }
+            if(delay > 0)
+            {
+                for(int k=0; k<block; k++)
+                    history[n % rows][k] = x[k];
+            }
+            if(_measured == NULL || _measured[n])
+            {
+                double measured = _adaptation[n];
+                for(int k=0; k<block; k++)
+                {
+                    double difference = x[k] - measured;
+                    sse[k] += difference * difference;
+                }
+            }
+        }
+        for(int k=0; k<size; k++)
+            _sse[first + k] = sse[k];
+    }
+}
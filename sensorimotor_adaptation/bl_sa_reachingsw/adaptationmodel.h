@@ -0,0 +1,92 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: State-space models of sensorimotor adaptation of
+ * ../analysis/script_models.m. x(n) is the adaptation (degrees the hand is
+ * turned against the rotation) and e(n) = p(n) - x(n) the error seen on
+ * trial n, for the perturbation p(n):
+ * - simple model:       x(n+1) = x(n) + B e(n)
+ * - single-state model: x(n+1) = A x(n) + B e(n)
+ * - two-state model:    x(n+1) = xf(n+1) + xs(n+1), with
+ *                       xf(n+1) = Af xf(n) + Bf e(n-d) (fast process)
+ *                       xs(n+1) = As xs(n) + Bs e(n-d) (slow process)
+ * d is the delay of the error in trials. The two-state loop of the script
+ * uses the error of the trial before (d = 1); the other models use d = 0.
+ * Simulate() is the trial recursion of the script, starting at x(0) = 0.
+ * Score() runs the same recursion for many candidate parameters at once
+ * (used by the fits of bl_sa_fit): the candidates are stored as one array
+ * per parameter and are the inner loop of each trial, so the compiler
+ * vectorizes the loop over the candidates (the delay is at most 7 trials).
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef ADAPTATIONMODEL_H
+#define ADAPTATIONMODEL_H
+
+#include <QtGlobal>
+#include <QVector>
+
+//Parameters of a model (the ones a model does not use are not read)
+struct AdaptationParameters
+{
+    double retention; //A (simple model: 1)
+    double learningRate; //B
+    double fastRetention; //Af
+    double fastRate; //Bf
+    double slowRetention; //As
+    double slowRate; //Bs
+};
+
+//Candidate parameters, one array per parameter (structure of arrays)
+struct AdaptationCandidates
+{
+    QVector<double> vRetention;
+    QVector<double> vLearningRate;
+    QVector<double> vFastRetention;
+    QVector<double> vFastRate;
+    QVector<double> vSlowRetention;
+    QVector<double> vSlowRate;
+
+    void resize(int _size);
+    int size() const
+    {
+        return vRetention.size();
+    }
+    void set(int _index, const AdaptationParameters &_parameters);
+    AdaptationParameters at(int _index) const;
+};
+
+class AdaptationModel
+{
+public:
+    enum Model
+    {
+        Simple = 0,
+        SingleState = 1,
+        TwoState = 2
+    };
+
+    //Parameters of the script
+    static AdaptationParameters ScriptParameters(Model _model);
+    //Delay of the error in the script (1 for the two-state model, 0 otherwise)
+    static int ScriptDelay(Model _model);
+    //Name of the model, as in the header of the files
+    static const char* Name(Model _model);
+    //Adaptation of each trial for the perturbation of each trial
+    //_errorSeen (optional): trials without it do not learn (no feedback)
+    static void Simulate(Model _model, const AdaptationParameters &_parameters, const double *_perturbation,
+                         int _trials, double *_adaptation, int _delay = 0, const bool *_errorSeen = NULL);
+    //Sum of the squared differences between the adaptation simulated with
+    //each candidate and the measured adaptation, in _sse
+    //_measured (optional): trials that are compared
+    static void Score(Model _model, const AdaptationCandidates &_candidates, const double *_perturbation,
+                      const double *_adaptation, int _trials, double *_sse, int _delay = 0,
+                      const bool *_errorSeen = NULL, const bool *_measured = NULL);
+};
+
+#endif // ADAPTATIONMODEL_H
@@ -0,0 +1,270 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "asyncwriter.h"
+#include "monotonicclock.h"
+
+#include <string.h>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+//Shared instance
+static AsyncWriter *sharedWriter = NULL;
+static QMutex sharedWriterMutex;
+
+//Default constructor
+AsyncWriter::AsyncWriter()
+{
+    this->head = 0;
+    this->count = 0;
+    this->busy = false;
+    this->stopping = false;
+    this->nextFileId = 1;
+    memset(&this->m_stats, 0, sizeof(this->m_stats));
+    this->queue.resize(this->queueCapacity);
+}
+
+//Returns the shared instance, creating and starting it if needed
+AsyncWriter* AsyncWriter::instance()
+{
+    QMutexLocker locker(&sharedWriterMutex);
+    if(sharedWriter == NULL)
+    {
+        sharedWriter = new AsyncWriter();
+        sharedWriter->start();
+    }
+    return sharedWriter;
+}
+
+//Executes the remaining commands and stops the shared instance
+void AsyncWriter::Shutdown()
+{
+    QMutexLocker locker(&sharedWriterMutex);
+    if(sharedWriter == NULL)
+        return;
+    sharedWriter->mutex.lock();
+    sharedWriter->stopping = true;
+    sharedWriter->notEmpty.wakeAll();
+    sharedWriter->mutex.unlock();
+    sharedWriter->wait();
+    delete sharedWriter;
+    sharedWriter = NULL;
+}
+
+//Identifier for a new file
+quint64 AsyncWriter::NewFileId()
+{
+    QMutexLocker locker(&this->mutex);
+    return this->nextFileId++;
+}
+
+//Adds a command to the queue
+//If the queue is full the caller waits (backpressure)
+void AsyncWriter::Enqueue(const Command &_command)
+{
+    QMutexLocker locker(&this->mutex);
+    if(this->count >= this->queueCapacity)
+    {
+        qint64 start = MonotonicClock::Now();
+        this->m_stats.stalls++;
+        while(this->count >= this->queueCapacity)
+            this->notFull.wait(&this->mutex);
+        this->m_stats.stallTime += MonotonicClock::Now() - start;
+    }
+    this->queue[(this->head + this->count) % this->queueCapacity] = _command;
+    this->count++;
+    if(this->count > this->m_stats.maxDepth)
+        this->m_stats.maxDepth = this->count;
+    this->notEmpty.wakeOne();
+}
+
+//Opens a file and waits for the result
+//The commands queued before it are executed first
+bool AsyncWriter::OpenFile(quint64 _fileId, const QString &_filename, bool _append)
+{
+    Command command;
+    command.type = Open;
+    command.fileId = _fileId;
+    command.filename = _filename;
+    command.append = _append;
+    command.sync = false;
+    this->Enqueue(command);
+
+    QMutexLocker locker(&this->mutex);
+    while(!this->openResults.contains(_fileId))
+        this->openDone.wait(&this->mutex);
+    bool ok = this->openResults.value(_fileId);
+    this->openResults.remove(_fileId);
+    return ok;
+}
+
+//Waits until the queue is empty and no command is being executed
+void AsyncWriter::WaitForIdle()
+{
+    QMutexLocker locker(&this->mutex);
+    while(this->count > 0 || this->busy)
+        this->idle.wait(&this->mutex);
+}
+
+//Takes an empty buffer from the pool
+//Buffers keep their capacity, so filling them does not allocate
+QByteArray AsyncWriter::AcquireBuffer()
+{
+    QMutexLocker locker(&this->mutex);
+    if(!this->pool.isEmpty())
+    {
+        QByteArray buffer = this->pool.last();
+        this->pool.pop_back();
+        return buffer;
+    }
+    locker.unlock();
+    QByteArray buffer;
+    buffer.reserve(this->batchSize + 4096);
+    return buffer;
+}
+
+//Returns a written buffer to the pool
+//Must be called with the mutex locked
+void AsyncWriter::ReleaseBuffer(QByteArray &_buffer)
+{
+    //Keeps a few buffers of the batch size, the others are freed
+    if(this->pool.size() < 8 && _buffer.capacity() >= this->batchSize)
+    {
+        _buffer.resize(0);
+        this->pool.push_back(_buffer);
+    }
+    _buffer = QByteArray();
+}
+
+//Statistics
+AsyncWriter::Stats AsyncWriter::stats()
+{
+    QMutexLocker locker(&this->mutex);
+    return this->m_stats;
+}
+
+//I/O loop
+void AsyncWriter::run()
+{
+    this->mutex.lock();
+    while(true)
+    {
+        while(this->count == 0 && !this->stopping)
+            this->notEmpty.wait(&this->mutex);
+        if(this->count == 0 && this->stopping)
+            break;
+
+        //Takes the next command and releases the lock while executing it
+        Command command = this->queue[this->head];
+        this->queue[this->head].data = QByteArray();
+        this->head = (this->head + 1) % this->queueCapacity;
+        this->count--;
+        this->busy = true;
+        this->notFull.wakeAll();
+        this->mutex.unlock();
+
+        this->Execute(command);
+
+        this->mutex.lock();
+        this->busy = false;
+        this->m_stats.commands++;
+        if(command.type == Write)
+            this->ReleaseBuffer(command.data);
+        if(this->count == 0)
+            this->idle.wakeAll();
+    }
+    this->mutex.unlock();
+
+    //Files that were never closed
+    QHash<quint64, QFile*>::iterator it;
+    for(it = this->files.begin(); it != this->files.end(); ++it)
+    {
+        it.value()->close();
+        delete it.value();
+    }
+    this->files.clear();
+}
+
+//Executes one command on the I/O thread
+void AsyncWriter::Execute(Command &_command)
+{
+    QFile *file = this->files.value(_command.fileId, NULL);
+    bool ok = true;
+
+    switch(_command.type)
+    {
+    case Open:
+    {
+        file = new QFile(_command.filename);
+        QIODevice::OpenMode mode = QIODevice::WriteOnly;
+        if(_command.append)
+            mode |= QIODevice::Append;
+        if(file->open(mode))
+            this->files.insert(_command.fileId, file);
+        else
+        {
+            qDebug() << "Writer: could not open" << _command.filename;
+            delete file;
+            ok = false;
+        }
+        this->mutex.lock();
+        this->openResults.insert(_command.fileId, ok);
+        this->openDone.wakeAll();
+        this->mutex.unlock();
+        break;
+    }
+
+    case Write:
+        if(file != NULL)
+        {
+            qint64 written = file->write(_command.data);
+            ok = written == _command.data.size();
+            if(written > 0)
+            {
+                this->mutex.lock();
+                this->m_stats.bytes += written;
+                this->mutex.unlock();
+            }
+        }
+        else
+            ok = false;
+        break;
+
+    case Sync:
+    case Close:
+        if(file != NULL)
+        {
+            ok = file->flush();
+            if(_command.type == Sync || _command.sync)
+            {
+#ifdef Q_OS_UNIX
+                ok = ok && fsync(file->handle()) == 0;
+#endif
+                this->mutex.lock();
+                this->m_stats.syncs++;
+                this->mutex.unlock();
+            }
+            if(_command.type == Close)
+            {
+                file->close();
+                this->files.remove(_command.fileId);
+                delete file;
+            }
+        }
+        break;
+    }
+
+    if(!ok)
+    {
+        this->mutex.lock();
+        this->m_stats.errors++;
+        this->mutex.unlock();
+    }
+}
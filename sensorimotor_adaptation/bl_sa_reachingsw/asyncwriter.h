@@ -0,0 +1,118 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: I/O thread shared by every DataFileController. Files are
+ * opened, written, synced and closed on this thread, in the order in which
+ * the commands were queued. The queue is bounded: when it is full the
+ * caller waits, and the stall is counted in the statistics, so no command
+ * can be queued from a thread that must not block. Write buffers
+ * are recycled through a small pool, so a controller fills one batch while
+ * the thread writes the previous one.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+
+class AsyncWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    //Commands executed by the I/O thread
+    enum CommandType{Open=1, Write=2, Sync=3, Close=4};
+
+    struct Command
+    {
+        CommandType type;
+        quint64 fileId;
+        QString filename; //Open
+        bool append; //Open
+        QByteArray data; //Write
+        bool sync; //Close: fsync before closing
+    };
+
+    //Statistics of the queue
+    struct Stats
+    {
+        quint64 commands; //Commands executed
+        quint64 bytes; //Bytes written
+        quint64 stalls; //Times a caller waited for room in the queue
+        qint64 stallTime; //Total time callers waited (ns)
+        int maxDepth; //Largest number of queued commands
+        quint64 syncs; //fsync calls
+        quint64 errors; //Failed open/write/sync
+    };
+
+    //Methods
+    //Shared instance, started on first use
+    static AsyncWriter* instance();
+    //Stops the shared instance after every queued command is executed
+    static void Shutdown();
+
+    //Returns an identifier for a new file
+    quint64 NewFileId();
+    //Queues a command, waiting if the queue is full
+    void Enqueue(const Command &_command);
+    //Queues the opening of a file and waits until the I/O thread has tried
+    //it; returns false if the file could not be opened
+    bool OpenFile(quint64 _fileId, const QString &_filename, bool _append);
+    //Waits until every queued command has been executed
+    void WaitForIdle();
+    //Takes an empty buffer from the pool
+    QByteArray AcquireBuffer();
+
+    //Getters
+    Stats stats();
+
+    //Maximum number of queued commands
+    static const int queueCapacity = 64;
+    //Size of each write batch (bytes)
+    static const int batchSize = 64*1024;
+
+protected:
+    void run();
+
+private:
+    //Constructor
+    AsyncWriter();
+
+    //Fields
+    QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    QWaitCondition idle;
+    QWaitCondition openDone;
+    QVector<Command> queue; //Ring of queueCapacity commands
+    int head; //Next command to execute
+    int count; //Number of queued commands
+    bool busy; //A command is being executed
+    bool stopping;
+    quint64 nextFileId;
+    QVector<QByteArray> pool;
+    Stats m_stats;
+    //Result of the opens that a caller is waiting for
+    QHash<quint64, bool> openResults;
+    //Files currently open (used only by the I/O thread)
+    QHash<quint64, QFile*> files;
+
+    //Methods
+    void Execute(Command &_command);
+    void ReleaseBuffer(QByteArray &_buffer);
+};
+
+#endif // ASYNCWRITER_H
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Benchmark of the trajectory codec (TrajectoryCodec)
+# against the text files of the previous versions
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = bl_sa_codecbench
+TEMPLATE = app
+
+
+SOURCES += codecbench.cpp \
+    trajectorycodec.cpp
+
+HEADERS  += trajectorycodec.h \
+    samplebuffer.h \
+    monotonicclock.h
@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# Converts archives of text files of the previous
+# versions into session files (LegacyConverter)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = bl_sa_convert
+TEMPLATE = app
+
+
+SOURCES += convertmain.cpp \
+    legacyconverter.cpp \
+    sessionfilewriter.cpp \
+    sessionfilereader.cpp \
+    datafilecontroller.cpp \
+    asyncwriter.cpp \
+    trajectorycodec.cpp
+
+HEADERS  += legacyconverter.h \
+    sessionfilewriter.h \
+    sessionfilereader.h \
+    sessionformat.h \
+    datafilecontroller.h \
+    asyncwriter.h \
+    trajectorycodec.h \
+    samplebuffer.h \
+    monotonicclock.h
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Exports session files to MAT v5 and NumPy
+# (SessionExporter)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = bl_sa_export
+TEMPLATE = app
+
+
+SOURCES += exportmain.cpp \
+    sessionexporter.cpp \
+    sessionfilereader.cpp \
+    trajectorycodec.cpp
+
+HEADERS  += sessionexporter.h \
+    sessionfilereader.h \
+    sessionformat.h \
+    trajectorycodec.h \
+    samplebuffer.h \
+    monotonicclock.h
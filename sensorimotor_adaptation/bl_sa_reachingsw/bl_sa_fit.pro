@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Fits the adaptation models of script_models.m
+# to a cohort on a work-stealing thread pool
+# (AdaptationModel, WorkStealingPool)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = bl_sa_fit
+TEMPLATE = app
+
+
+SOURCES += fitmain.cpp \
+    adaptationmodel.cpp \
+    adaptationestimator.cpp \
+    workstealingpool.cpp \
+    sessionfilereader.cpp \
+    trajectorycodec.cpp
+
+HEADERS  += adaptationmodel.h \
+    adaptationestimator.h \
+    workstealingpool.h \
+    sessionfilereader.h \
+    sessionformat.h \
+    trajectorycodec.h \
+    samplebuffer.h \
+    monotonicclock.h
@@ -8,6 +8,8 @@ QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+CONFIG += c++11
+
 TARGET = bl_sa_reachingsw
 TEMPLATE = app
 
@@ -18,14 +20,62 @@ SOURCES += main.cpp\
     reachingwindow.cpp \
     cursorcontroller.cpp \
     protocolcontroller.cpp \
-    guiobject.cpp
+    movementenddetector.cpp \
+    kinematicfeatures.cpp \
+    adaptationmodel.cpp \
+    adaptationestimator.cpp \
+    guiobject.cpp \
+    samplebuffer.cpp \
+    acquisitionthread.cpp \
+    evdevinputsource.cpp \
+    replayinputsource.cpp \
+    resampler.cpp \
+    timingstats.cpp \
+    sessionfilewriter.cpp \
+    sessionfilereader.cpp \
+    asyncwriter.cpp \
+    triallog.cpp \
+    trajectorycodec.cpp \
+    framescheduler.cpp \
+    latencytracker.cpp \
+    scenerenderer.cpp \
+    scenestore.cpp \
+    targetset.cpp \
+    perturbationschedule.cpp \
+    protocolcompiler.cpp
 
 HEADERS  += mainwindow.h \
     datafilecontroller.h \
     reachingwindow.h \
     cursorcontroller.h \
     protocolcontroller.h \
-    guiobject.h
+    movementenddetector.h \
+    kinematicfeatures.h \
+    adaptationmodel.h \
+    adaptationestimator.h \
+    guiobject.h \
+    samplebuffer.h \
+    monotonicclock.h \
+    acquisitionthread.h \
+    inputsource.h \
+    evdevinputsource.h \
+    replayinputsource.h \
+    resampler.h \
+    timingstats.h \
+    sessionformat.h \
+    sessionfilewriter.h \
+    sessionfilereader.h \
+    asyncwriter.h \
+    triallog.h \
+    trajectorycodec.h \
+    framescheduler.h \
+    latencytracker.h \
+    scenerenderer.h \
+    scenestore.h \
+    targetset.h \
+    visuomotortransform.h \
+    perturbationschedule.h \
+    protocolcompiler.h
 
 FORMS    += mainwindow.ui \
     reachingwindow.ui
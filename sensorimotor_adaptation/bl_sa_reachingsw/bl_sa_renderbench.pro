@@ -0,0 +1,75 @@
+#-------------------------------------------------
+#
+# Headless benchmark of the stimulus pipeline
+# (ProtocolController::updateGUI() + SceneRenderer)
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = bl_sa_renderbench
+TEMPLATE = app
+
+
+SOURCES += renderbench.cpp \
+    scenerenderer.cpp \
+    scenestore.cpp \
+    targetset.cpp \
+    perturbationschedule.cpp \
+    protocolcompiler.cpp \
+    framescheduler.cpp \
+    latencytracker.cpp \
+    datafilecontroller.cpp \
+    cursorcontroller.cpp \
+    protocolcontroller.cpp \
+    movementenddetector.cpp \
+    kinematicfeatures.cpp \
+    adaptationmodel.cpp \
+    adaptationestimator.cpp \
+    guiobject.cpp \
+    samplebuffer.cpp \
+    acquisitionthread.cpp \
+    evdevinputsource.cpp \
+    replayinputsource.cpp \
+    resampler.cpp \
+    timingstats.cpp \
+    sessionfilewriter.cpp \
+    sessionfilereader.cpp \
+    asyncwriter.cpp \
+    triallog.cpp \
+    trajectorycodec.cpp
+
+HEADERS  += scenerenderer.h \
+    framescheduler.h \
+    latencytracker.h \
+    targetset.h \
+    visuomotortransform.h \
+    perturbationschedule.h \
+    protocolcompiler.h \
+    datafilecontroller.h \
+    cursorcontroller.h \
+    protocolcontroller.h \
+    movementenddetector.h \
+    kinematicfeatures.h \
+    adaptationmodel.h \
+    adaptationestimator.h \
+    guiobject.h \
+    samplebuffer.h \
+    monotonicclock.h \
+    acquisitionthread.h \
+    inputsource.h \
+    evdevinputsource.h \
+    replayinputsource.h \
+    resampler.h \
+    timingstats.h \
+    sessionformat.h \
+    sessionfilewriter.h \
+    sessionfilereader.h \
+    asyncwriter.h \
+    triallog.h \
+    trajectorycodec.h
@@ -0,0 +1,207 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Benchmark of TrajectoryCodec against the text files written
+ * by the previous versions (DataFileController::WriteData()).
+ * Synthetic center-out reaches (minimum-jerk profile plus hand tremor) are
+ * generated at the sampling frequency and as mouse events with jittered
+ * timestamps, then encoded and decoded block by block.
+ * Usage: bl_sa_codecbench [trials] [block samples]
+ * ----------------------------------------------------------------------------
+*/
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <QtMath>
+#include <stdlib.h>
+#include "trajectorycodec.h"
+#include "monotonicclock.h"
+
+//Keeps the compiler from removing the decode loops
+static volatile qint64 sink = 0;
+
+//Center-out reaches of 2 s, sampled at _frequency (Hz)
+//_jitter: maximum error of the timestamps (ns), as in mouse events
+static QVector<CursorSample> GenerateTrajectories(int _trials, int _frequency, qint64 _jitter)
+{
+    QVector<CursorSample> samples;
+    qint64 period = 1000000000LL / _frequency;
+    int perTrial = 2 * _frequency;
+    qint64 t = 0;
+    srand(1);
+    for(int trial=0; trial<_trials; trial++)
+    {
+        double angle = 2 * M_PI * (trial % 8) / 8.0;
+        double rotation = -40 * M_PI / 180.0;
+        for(int i=0; i<perTrial; i++)
+        {
+            //Minimum-jerk profile of a 320 pixel reach
+            double tau = qMin(1.0, i / (0.6 * perTrial));
+            double s = 320 * (10*qPow(tau,3) - 15*qPow(tau,4) + 6*qPow(tau,5));
+            double tremor = (rand() % 3) - 1;
+            CursorSample sample;
+            sample.timestamp = t + (_jitter > 0 ? rand() % _jitter : 0);
+            sample.rawX = qRound(960 + s * qCos(angle) + tremor);
+            sample.rawY = qRound(860 - s * qSin(angle) + tremor);
+            sample.x = qRound(960 + s * qCos(angle + rotation));
+            sample.y = qRound(860 - s * qSin(angle + rotation));
+            samples.push_back(sample);
+            t += period;
+        }
+    }
+    return samples;
+}
+
+//Text lines of the previous versions
+static QByteArray EncodeText(const QVector<CursorSample> &_samples, bool _events)
+{
+    QByteArray text;
+    for(int i=0; i<_samples.size(); i++)
+    {
+        const CursorSample &s = _samples.at(i);
+        QString line;
+        if(_events)
+            line = QString::number(s.timestamp) + "\t" + QString::number(s.rawX) + "\t" +
+                    QString::number(s.rawY) + "\t" + QString::number(s.x) + "\t" + QString::number(s.y);
+        else
+            line = QString::number(s.x) + "\t" + QString::number(s.y);
+        text.append(line.toUtf8());
+        text.append('\n');
+    }
+    return text;
+}
+
+//Parses the text lines back, as the analysis scripts do
+static int DecodeText(const QByteArray &_text, QVector<CursorSample> &_out)
+{
+    _out.clear();
+    QList<QByteArray> lines = _text.split('\n');
+    for(int i=0; i<lines.size(); i++)
+    {
+        if(lines.at(i).isEmpty())
+            continue;
+        QList<QByteArray> fields = lines.at(i).split('\t');
+        CursorSample s;
+        s.timestamp = 0;
+        s.rawX = s.rawY = 0;
+        if(fields.size() == 5)
+        {
+            s.timestamp = fields.at(0).toLongLong();
+            s.rawX = fields.at(1).toInt();
+            s.rawY = fields.at(2).toInt();
+        }
+        s.x = fields.at(fields.size()-2).toInt();
+        s.y = fields.at(fields.size()-1).toInt();
+        _out.push_back(s);
+    }
+    return _out.size();
+}
+
+//Runs every format on one stream and prints one line per format
+static void Run(QTextStream &_out, const QString &_name, const QVector<CursorSample> &_samples,
+                int _blockSamples, bool _events)
+{
+    int n = _samples.size();
+    double rawBytes = (double)n * sizeof(CursorSample);
+    _out << _name << ": " << n << " samples\n";
+    _out << QString("  %1 %2 %3 %4 %5\n").arg("format", -22).arg("bytes/sample", 13)
+            .arg("ratio", 7).arg("encode MS/s", 12).arg("decode MS/s", 12);
+
+    //Text
+    qint64 start = MonotonicClock::Now();
+    QByteArray text = EncodeText(_samples, _events);
+    qint64 encodeTime = MonotonicClock::Now() - start;
+    QVector<CursorSample> parsed;
+    start = MonotonicClock::Now();
+    DecodeText(text, parsed);
+    qint64 decodeTime = MonotonicClock::Now() - start;
+    _out << QString("  %1 %2 %3 %4 %5\n").arg("text", -22)
+            .arg((double)text.size()/n, 13, 'f', 2).arg(rawBytes/text.size(), 7, 'f', 2)
+            .arg(n * 1000.0 / encodeTime, 12, 'f', 2).arg(n * 1000.0 / decodeTime, 12, 'f', 2);
+
+    //Codec, with and without timestamp delta coding
+    for(int mode=0; mode<2; mode++)
+    {
+        TrajectoryCodec codec(mode == 1);
+        QVector<uchar> encoded(TrajectoryCodec::MaxEncodedSize(_blockSamples) * (n / _blockSamples + 1));
+        QVector<int> blockBytes;
+        start = MonotonicClock::Now();
+        int bytes = 0;
+        for(int i=0; i<n; i+=_blockSamples)
+        {
+            int count = qMin(_blockSamples, n - i);
+            int b = codec.Encode(_samples.constData() + i, count, encoded.data() + bytes);
+            blockBytes.push_back(b);
+            bytes += b;
+        }
+        encodeTime = MonotonicClock::Now() - start;
+
+        //Decodes into one array per channel, reused for every block
+        TrajectoryBlock block;
+        QVector<CursorSample> decoded(n);
+        start = MonotonicClock::Now();
+        int offset = 0;
+        qint64 checksum = 0;
+        for(int i=0; i<blockBytes.size(); i++)
+        {
+            int count = TrajectoryCodec::Decode(encoded.constData() + offset, blockBytes.at(i), block);
+            for(int k=0; k<count; k++)
+                checksum += block.x.at(k);
+            offset += blockBytes.at(i);
+        }
+        decodeTime = MonotonicClock::Now() - start;
+        sink += checksum;
+
+        //Checks that the samples are identical
+        offset = 0;
+        int position = 0;
+        bool identical = true;
+        for(int i=0; i<blockBytes.size(); i++)
+        {
+            position += TrajectoryCodec::Decode(encoded.constData() + offset, blockBytes.at(i),
+                                                decoded.data() + position);
+            offset += blockBytes.at(i);
+        }
+        for(int i=0; i<n && identical; i++)
+            identical = decoded.at(i).timestamp == _samples.at(i).timestamp &&
+                    decoded.at(i).rawX == _samples.at(i).rawX && decoded.at(i).rawY == _samples.at(i).rawY &&
+                    decoded.at(i).x == _samples.at(i).x && decoded.at(i).y == _samples.at(i).y;
+
+        QString name = mode == 1 ? "codec (time delta)" : "codec (raw time)";
+        _out << QString("  %1 %2 %3 %4 %5").arg(name, -22)
+                .arg((double)bytes/n, 13, 'f', 2).arg(rawBytes/bytes, 7, 'f', 2)
+                .arg(n * 1000.0 / encodeTime, 12, 'f', 2).arg(n * 1000.0 / decodeTime, 12, 'f', 2)
+             << (identical ? "" : "  MISMATCH") << "\n";
+    }
+    _out << QString("  %1 %2 %3\n").arg("binary (CursorSample)", -22)
+            .arg((double)sizeof(CursorSample), 13, 'f', 2).arg(1.0, 7, 'f', 2);
+    _out.flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    int trials = argc > 1 ? atoi(argv[1]) : 200;
+    int blockSamples = argc > 2 ? atoi(argv[2]) : 256;
+    if(trials <= 0 || blockSamples <= 0)
+    {
+        out << "Usage: bl_sa_codecbench [trials] [block samples]\n";
+        return 1;
+    }
+
+    out << "Trials: " << trials << ", block: " << blockSamples << " samples\n";
+    out << "Text sizes include only the columns of the text files (x, y for the grid)\n";
+    //Uniform sampling grid at 100 Hz and mouse events at 1 kHz with 200 us jitter
+    Run(out, "Grid (100 Hz)", GenerateTrajectories(trials, 100, 0), blockSamples, false);
+    Run(out, "Events (1 kHz)", GenerateTrajectories(trials, 1000, 200000), blockSamples, true);
+    return 0;
+}
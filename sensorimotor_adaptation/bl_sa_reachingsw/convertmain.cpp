@@ -0,0 +1,167 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Converts archives of text files of the previous versions
+ * into session files (see legacyconverter.h). Every experiment found under
+ * the given directories is converted by a thread pool, then the session
+ * files are read back and checked.
+ * Usage: bl_sa_convert [-j threads] [-o output directory] [-f] <directory> ...
+ *   -o: the session files are written to the output directory, following
+ *       the structure of the archive (default: next to the text files)
+ *   -f: overwrites session files that already exist
+ * ----------------------------------------------------------------------------
+*/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QDir>
+#include <QFileInfo>
+#include "legacyconverter.h"
+#include "datafilecontroller.h"
+#include "asyncwriter.h"
+#include "monotonicclock.h"
+
+//An experiment to be converted and its outcome
+struct ConvertJob
+{
+    LegacyExperiment experiment;
+    QString output;
+    LegacyResult result;
+};
+
+//Converts one experiment (first pass) or checks its session file (second pass)
+class ConvertTask : public QRunnable
+{
+public:
+    ConvertTask(ConvertJob *_job, bool _verify)
+    {
+        this->job = _job;
+        this->verify = _verify;
+    }
+
+    void run()
+    {
+        if(this->verify)
+            LegacyConverter::Verify(this->job->output, this->job->result);
+        else
+            this->job->result = LegacyConverter::Convert(this->job->experiment, this->job->output);
+    }
+
+private:
+    ConvertJob *job;
+    bool verify;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    int threads = QThread::idealThreadCount();
+    QString outputDir;
+    bool overwrite = false;
+    QStringList roots;
+    QStringList arguments = a.arguments();
+    for(int i=1; i<arguments.size(); i++)
+    {
+        if(arguments.at(i) == "-j" && i+1 < arguments.size())
+            threads = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-o" && i+1 < arguments.size())
+            outputDir = arguments.at(++i);
+        else if(arguments.at(i) == "-f")
+            overwrite = true;
+        else
+            roots.push_back(arguments.at(i));
+    }
+    if(roots.isEmpty() || threads < 1)
+    {
+        out << "Usage: bl_sa_convert [-j threads] [-o output directory] [-f] <directory> ...\n";
+        return 1;
+    }
+
+    //Finds the experiments
+    qint64 start = MonotonicClock::Now();
+    QVector<ConvertJob> jobs;
+    int skipped = 0;
+    for(int r=0; r<roots.size(); r++)
+    {
+        QDir root(roots.at(r));
+        QVector<LegacyExperiment> experiments = LegacyConverter::Scan(roots.at(r));
+        for(int i=0; i<experiments.size(); i++)
+        {
+            ConvertJob job;
+            job.experiment = experiments.at(i);
+            job.output = experiments.at(i).prefix + "_session.dat";
+            if(!outputDir.isEmpty())
+            {
+                job.output = QDir(outputDir).filePath(root.relativeFilePath(job.output));
+                QDir().mkpath(QFileInfo(job.output).path());
+            }
+            if(!overwrite && QFile::exists(job.output))
+            {
+                skipped++;
+                continue;
+            }
+            jobs.push_back(job);
+        }
+    }
+    qint64 scanTime = MonotonicClock::Now() - start;
+    out << "Experiments: " << jobs.size() << " (" << skipped << " already converted), "
+        << "threads: " << threads << ", scan: " << QString::number(scanTime / 1e9, 'f', 3) << " s\n";
+    out.flush();
+
+    //Converts, then checks every session file once all of them are on disk
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    start = MonotonicClock::Now();
+    for(int i=0; i<jobs.size(); i++)
+        pool.start(new ConvertTask(&jobs[i], false));
+    pool.waitForDone();
+    DataFileController::WaitForWrites();
+    qint64 convertTime = MonotonicClock::Now() - start;
+    for(int i=0; i<jobs.size(); i++)
+        if(jobs.at(i).result.ok)
+            pool.start(new ConvertTask(&jobs[i], true));
+    pool.waitForDone();
+    qint64 totalTime = MonotonicClock::Now() - start;
+
+    //Report
+    int files = 0, failed = 0, warnings = 0;
+    qint64 bytes = 0, samples = 0, outputBytes = 0;
+    for(int i=0; i<jobs.size(); i++)
+    {
+        const ConvertJob &job = jobs.at(i);
+        files += job.result.files;
+        bytes += job.result.bytes;
+        samples += job.result.samples;
+        warnings += job.result.warnings.size();
+        if(!job.result.ok)
+        {
+            failed++;
+            out << job.experiment.prefix << ": ERROR " << job.result.error << "\n";
+        }
+        else
+            outputBytes += QFileInfo(job.output).size();
+        for(int k=0; k<job.result.warnings.size(); k++)
+            out << job.experiment.prefix << ": " << job.result.warnings.at(k) << "\n";
+    }
+    double seconds = totalTime / 1e9;
+    out << "Converted " << jobs.size() - failed << " of " << jobs.size() << " experiments, "
+        << files << " files, " << samples << " samples, " << warnings << " warnings\n";
+    out << "Input: " << QString::number(bytes / 1e6, 'f', 2) << " MB, output: "
+        << QString::number(outputBytes / 1e6, 'f', 2) << " MB\n";
+    out << "Time: " << QString::number(seconds, 'f', 3) << " s (conversion "
+        << QString::number(convertTime / 1e9, 'f', 3) << " s), "
+        << QString::number(files / seconds, 'f', 1) << " files/s, "
+        << QString::number(bytes / 1e6 / seconds, 'f', 1) << " MB/s\n";
+    out.flush();
+
+    AsyncWriter::Shutdown();
+    return failed > 0 ? 1 : 0;
+}
@@ -9,38 +9,78 @@
 
 CursorController::CursorController()
 {
-
+    this->Init();
 }
 
 CursorController::CursorController(int _perturbation)
 {
+    this->Init();
     this->setPerturbation(_perturbation);
 }
 
-//Method that rotates a given point according to the degree of the perturbation
-//in respect to the origin
-void CursorController::RotatePoint()
+//Default values of the fields
+void CursorController::Init()
 {
-    int _x = this->x();
-    int _y = this->y();
-
-    //Translates back to the origin
-    int ax = _x - this->originX();
-    int ay = _y - this->originY();
-
-    //Applies the rotation
-    double fax = (ax*cos(this->rad)) - (ay*sin(this->rad));
-    double fay = (ay*cos(this->rad)) + (ax*sin(this->rad));
-
-    //Translates the rotated point back to the original coordinates
-    double rx = round(fax+this->originX());
-    double ry = round(fay+this->originY());
+    this->m_perturbation = 0;
+    this->m_originX = 0;
+    this->m_originY = 0;
+    this->m_inputSource = NULL;
+    this->m_rawX = 0;
+    this->m_rawY = 0;
+    this->m_gain = 1.0;
+    this->m_width = 0;
+    this->m_height = 0;
+    this->m_feedbackX = 0;
+    this->m_feedbackY = 0;
+}
 
-    this->setX(rx);
-    this->setY(ry);
+//Applies the transform to the raw position with respect to the origin
+//The position is only rounded once, to the pixels of the feedback
+void CursorController::UpdateFeedback(qint64 _timestamp, bool _perturbed)
+{
+    double fx, fy;
+    this->m_transform.Apply(this->m_rawX, this->m_rawY, _timestamp, fx, fy);
+    if(_perturbed)
+    {
+        this->m_feedbackX = fx;
+        this->m_feedbackY = fy;
+    }
+    else
+    {
+        this->m_feedbackX = this->m_rawX;
+        this->m_feedbackY = this->m_rawY;
+    }
+    this->setX(qRound(this->m_feedbackX));
+    this->setY(qRound(this->m_feedbackY));
 }
 
-double CursorController::Deg2Rad(int _deg)
+//Reads one event of the input source
+//Relative counts are scaled by the gain and accumulated into the raw position,
+//which is limited to the screen
+bool CursorController::ReadInput(qint64 &_timestamp)
 {
-    return _deg * (M_PI/180.0);
+    if(this->m_inputSource == NULL)
+        return false;
+    InputEvent ev;
+    if(!this->m_inputSource->Read(ev))
+        return false;
+
+    this->m_rawX += ev.dx * this->m_gain;
+    this->m_rawY += ev.dy * this->m_gain;
+    if(this->m_width > 0)
+    {
+        if(this->m_rawX < 0)
+            this->m_rawX = 0;
+        else if(this->m_rawX > this->m_width)
+            this->m_rawX = this->m_width;
+    }
+    if(this->m_height > 0)
+    {
+        if(this->m_rawY < 0)
+            this->m_rawY = 0;
+        else if(this->m_rawY > this->m_height)
+            this->m_rawY = this->m_height;
+    }
+    _timestamp = ev.timestamp;
+    return true;
 }
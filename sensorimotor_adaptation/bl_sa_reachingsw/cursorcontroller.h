@@ -6,7 +6,10 @@
  * Author: Andrei Nakagawa, MSc
  * contact: andrei.ufu@gmail.com
  * ----------------------------------------------------------------------------
- * Description:
+ * Description: Position of the hand (raw) and of the visual feedback. The
+ * feedback is computed from the raw position by the visuomotor transform
+ * (FeedbackTransform, see visuomotortransform.h) in double precision and
+ * only rounded to pixels at the end.
  * ----------------------------------------------------------------------------
  * */
 
@@ -15,6 +18,20 @@
 
 #include <math.h>
 #include <QPoint>
+#include "inputsource.h" //Devices that provide the hand movement
+#include "visuomotortransform.h" //Hand to feedback transforms
+
+//Transform of the visual feedback: the error clamp is applied first, so a
+//rotation after it gives a clamp at an angle from its direction
+typedef TransformPipeline<ErrorClampStage, LinearStage, VelocityStage, OffsetStage> FeedbackTransform;
+//Index of each stage in FeedbackTransform::stage<N>()
+enum FeedbackStage
+{
+    ClampStage = 0,
+    MatrixStage = 1,
+    VelocityFieldStage = 2,
+    ShiftStage = 3
+};
 
 #define M_PI 3.14159265358979323846
 
@@ -33,14 +50,23 @@ public:
     //~CursorController();
 
     //Methods
-    void RotatePoint();
+    //Computes the visual feedback from the raw position
+    //_perturbed: applies the transform, otherwise the feedback is the raw
+    //position. The transform sees every event, so the velocity of the hand
+    //is known when the perturbation starts
+    void UpdateFeedback(qint64 _timestamp, bool _perturbed);
+    //Reads the next event of the input source and integrates its
+    //displacement into the raw position
+    //Returns false if there is no source or no pending event
+    bool ReadInput(qint64 &_timestamp);
 
     //Getters and setters
-    //perturbation
+    //perturbation: angle of the rotation (degrees)
+    //Only the rotation: the other linear transforms are set with transform()
     void setPerturbation(int perturbation)
     {
         m_perturbation = perturbation;
-        this->rad = this->Deg2Rad(perturbation);
+        m_transform.stage<MatrixStage>() = LinearStage::Rotation(perturbation);
     }
     int perturbation() const
     {
@@ -49,10 +75,12 @@ public:
     void setOriginX(int originX)
     {
         m_originX = originX;
+        m_transform.setOrigin(m_originX, m_originY);
     }
     void setOriginY(int originY)
     {
         m_originY = originY;
+        m_transform.setOrigin(m_originX, m_originY);
     }
     int originX() const
     {
@@ -63,6 +91,54 @@ public:
     {
         return m_originY;
     }
+    //Input source (NULL: the position comes from the system cursor)
+    void setInputSource(InputSource *inputSource)
+    {
+        m_inputSource = inputSource;
+    }
+    InputSource* inputSource() const
+    {
+        return m_inputSource;
+    }
+    //Position of the hand before any perturbation (pixels)
+    void setRawPosition(double rawX, double rawY)
+    {
+        m_rawX = rawX;
+        m_rawY = rawY;
+    }
+    double rawX() const
+    {
+        return m_rawX;
+    }
+    double rawY() const
+    {
+        return m_rawY;
+    }
+    //Transform from the hand to the visual feedback
+    FeedbackTransform& transform()
+    {
+        return m_transform;
+    }
+    //Position of the visual feedback before it is rounded (pixels)
+    double feedbackX() const
+    {
+        return m_feedbackX;
+    }
+    double feedbackY() const
+    {
+        return m_feedbackY;
+    }
+    //Pixels per count of the input source
+    void setGain(double gain)
+    {
+        m_gain = gain;
+    }
+    //Limits of the raw position (screen size)
+    void setBounds(int width, int height)
+    {
+        m_width = width;
+        m_height = height;
+    }
 
 
 private:
@@ -70,12 +146,18 @@ private:
     int m_perturbation;
     int m_originX;
     int m_originY;
-
-    //Fields
-    double rad;
+    InputSource *m_inputSource;
+    double m_rawX;
+    double m_rawY;
+    double m_gain;
+    int m_width;
+    int m_height;
+    FeedbackTransform m_transform;
+    double m_feedbackX;
+    double m_feedbackY;
 
     //Methods
-    double Deg2Rad(int _deg);
+    void Init();
 };
 
 #endif // CURSORCONTROLLER_H
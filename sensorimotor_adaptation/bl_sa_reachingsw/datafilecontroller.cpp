@@ -6,35 +6,117 @@
 */
 
 #include "datafilecontroller.h"
-#include "cursorcontroller.h"
 
 //Default constructor
 DataFileController::DataFileController(std::string _filename)
 {
     this->filename = _filename;
-    this->fileHandler.setFileName(QString::fromStdString(this->filename));
+    this->fileId = 0;
+    this->m_flushPolicy = FlushNone;
+    this->opened = false;
+}
+
+//Destructor
+//Queued data is still written: the file is closed by the I/O thread
+DataFileController::~DataFileController()
+{
+    if(this->opened)
+        this->Close();
 }
 
 //Open the file
-bool DataFileController::Open()
+//The file is opened by the I/O thread, after the commands already queued;
+//waits for it, so a file that cannot be created is reported here
+bool DataFileController::Open(bool _append)
 {
-    bool ret = this->fileHandler.open(QIODevice::WriteOnly);
-    if(ret)
-    {
-        this->fileStream.setDevice(&this->fileHandler);
-    }
-    return ret;
+    AsyncWriter *writer = AsyncWriter::instance();
+    this->fileId = writer->NewFileId();
+    if(!writer->OpenFile(this->fileId, QString::fromStdString(this->filename), _append))
+        return false;
+    this->batch = writer->AcquireBuffer();
+    this->opened = true;
+    return true;
 }
 
 //Saves the file
 bool DataFileController::Close()
 {
-    this->fileHandler.close();
+    if(!this->opened)
+        return false;
+    this->Submit();
+    AsyncWriter::Command command;
+    command.type = AsyncWriter::Close;
+    command.fileId = this->fileId;
+    command.append = false;
+    command.sync = this->m_flushPolicy != FlushNone;
+    AsyncWriter::instance()->Enqueue(command);
+    this->batch = QByteArray();
+    this->opened = false;
     return true;
 }
 
 //Writes data to the file
 void DataFileController::WriteData(QString _textline)
 {
-    this->fileStream << _textline << endl;
+    if(!this->opened)
+        return;
+    this->batch.append(_textline.toUtf8());
+    this->batch.append('\n');
+    if(this->batch.size() >= AsyncWriter::batchSize)
+        this->Submit();
+}
+
+//Writes binary data to the file
+void DataFileController::WriteBytes(const char *_data, qint64 _size)
+{
+    if(!this->opened)
+        return;
+    this->batch.append(_data, (int)_size);
+    if(this->batch.size() >= AsyncWriter::batchSize)
+        this->Submit();
+}
+
+//Forces the data written so far to the disk
+bool DataFileController::Flush()
+{
+    if(!this->opened)
+        return false;
+    this->Submit();
+    AsyncWriter::Command command;
+    command.type = AsyncWriter::Sync;
+    command.fileId = this->fileId;
+    command.append = false;
+    command.sync = true;
+    AsyncWriter::instance()->Enqueue(command);
+    return true;
+}
+
+//Hands the current batch to the I/O thread and starts a new one
+//Once written by the I/O thread, the data survives a crash of the application
+void DataFileController::Submit()
+{
+    if(!this->opened || this->batch.isEmpty())
+        return;
+    AsyncWriter *writer = AsyncWriter::instance();
+    AsyncWriter::Command command;
+    command.type = AsyncWriter::Write;
+    command.fileId = this->fileId;
+    command.append = false;
+    command.sync = false;
+    command.data = this->batch;
+    this->batch = QByteArray();
+    writer->Enqueue(command);
+    if(this->m_flushPolicy == FlushEveryBatch)
+    {
+        command.type = AsyncWriter::Sync;
+        command.data = QByteArray();
+        writer->Enqueue(command);
+    }
+    this->batch = writer->AcquireBuffer();
+}
+
+//Waits for every queued write
+void DataFileController::WaitForWrites()
+{
+    AsyncWriter::instance()->WaitForIdle();
 }
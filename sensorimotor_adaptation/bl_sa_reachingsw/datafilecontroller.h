@@ -6,7 +6,14 @@
  * Author: Andrei Nakagawa, MSc
  * contact: andrei.ufu@gmail.com
  * ----------------------------------------------------------------------------
- * Description:
+ * Description: Writes the experiment files. The writes are asynchronous:
+ * data is collected in batches that are written by the shared I/O thread
+ * (AsyncWriter), so writing and closing a file do not wait for the disk.
+ * Open() waits until the I/O thread has opened the file, so it can return
+ * false when the file cannot be created. Every call that hands data to the
+ * I/O thread (Submit, Flush, Close, and the writes that fill a batch) waits
+ * while the I/O queue is full: the controllers must not be used from the
+ * acquisition thread.
  * ----------------------------------------------------------------------------
  * */
 
@@ -14,8 +21,8 @@
 #define DATAFILECONTROLLER_H
 
 #include <QString>
-#include <QFile>
-#include <QTextStream>
+#include <QByteArray>
+#include "asyncwriter.h"
 
 class DataFileController
 {
@@ -24,22 +31,47 @@ public:
 
     //Constructors
     DataFileController(std::string _filename); //Default constructor
+    ~DataFileController();
 
     //Fields
     std::string filename;
 
+    //When the written data is forced to the disk (fsync)
+    enum FlushPolicy{
+        FlushNone=0, //Left to the operating system
+        FlushOnClose=1, //When the file is closed
+        FlushEveryBatch=2 //After every batch
+    };
+
     //Methods
-    bool Open(); //Method for opening the file
+    bool Open(bool _append = false); //Method for opening the file (optionally appending to it), false if it cannot be opened
     bool Close(); //Method for closing and saving the file
     void WriteData(QString _textline); //Method for writing data
+    void WriteBytes(const char *_data, qint64 _size); //Method for writing binary data
+    bool Flush(); //Method for forcing the data written so far to the disk
+    void Submit(); //Method for handing the data written so far to the I/O thread
+    //Waits until every queued write of every file has been executed
+    static void WaitForWrites();
+
+    //Getters and setters
+    void setFlushPolicy(FlushPolicy policy)
+    {
+        m_flushPolicy = policy;
+    }
+    FlushPolicy flushPolicy() const
+    {
+        return m_flushPolicy;
+    }
 
 public slots:
 
 
 private:
     //Fields
-    QFile fileHandler; //Handles file operations
-    QTextStream fileStream; //Stream for writing data to the file
+    quint64 fileId; //Identifies the file in the I/O thread
+    QByteArray batch; //Batch being filled
+    FlushPolicy m_flushPolicy;
+    bool opened;
 };
 
 #endif // DATAFILECONTROLLER_H
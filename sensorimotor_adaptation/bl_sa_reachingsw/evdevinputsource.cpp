@@ -0,0 +1,130 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "evdevinputsource.h"
+
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#endif
+
+//Default constructor
+EvdevInputSource::EvdevInputSource(std::string _device)
+{
+    this->device = _device;
+    this->fd = -1;
+    this->m_grab = false;
+    this->syncing = false;
+    this->accumX = 0;
+    this->accumY = 0;
+    this->m_droppedReports = 0;
+}
+
+//Destructor
+EvdevInputSource::~EvdevInputSource()
+{
+    this->Close();
+}
+
+//Opens the evdev node in non-blocking mode
+bool EvdevInputSource::Open()
+{
+#ifdef Q_OS_LINUX
+    this->fd = ::open(this->device.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if(this->fd < 0)
+    {
+        qDebug() << "Evdev: could not open" << QString::fromStdString(this->device)
+                 << ":" << strerror(errno);
+        return false;
+    }
+    //Kernel timestamps in CLOCK_MONOTONIC, the same clock as MonotonicClock
+    int clockId = CLOCK_MONOTONIC;
+    if(ioctl(this->fd, EVIOCSCLOCKID, &clockId) < 0)
+        qDebug() << "Evdev: could not select CLOCK_MONOTONIC timestamps";
+    if(this->m_grab && ioctl(this->fd, EVIOCGRAB, 1) < 0)
+        qDebug() << "Evdev: could not grab the device";
+    this->syncing = false;
+    this->accumX = 0;
+    this->accumY = 0;
+    return true;
+#else
+    qDebug() << "Evdev input is only available on Linux";
+    return false;
+#endif
+}
+
+//Closes the device
+void EvdevInputSource::Close()
+{
+#ifdef Q_OS_LINUX
+    if(this->fd >= 0)
+    {
+        if(this->m_grab)
+            ioctl(this->fd, EVIOCGRAB, 0);
+        ::close(this->fd);
+    }
+#endif
+    this->fd = -1;
+}
+
+//Reads the kernel events until a complete report (SYN_REPORT) is found
+//The relative counts of one report are delivered as a single event
+bool EvdevInputSource::Read(InputEvent &_event)
+{
+#ifdef Q_OS_LINUX
+    if(this->fd < 0)
+        return false;
+
+    struct input_event ev;
+    while(::read(this->fd, &ev, sizeof(ev)) == (ssize_t)sizeof(ev))
+    {
+        if(ev.type == EV_REL && !this->syncing)
+        {
+            if(ev.code == REL_X)
+                this->accumX += ev.value;
+            else if(ev.code == REL_Y)
+                this->accumY += ev.value;
+        }
+        else if(ev.type == EV_SYN && ev.code == SYN_DROPPED)
+        {
+            //The kernel buffer overflowed: the partial report is discarded
+            //and events are ignored until the next SYN_REPORT
+            this->syncing = true;
+            this->accumX = 0;
+            this->accumY = 0;
+            this->m_droppedReports++;
+        }
+        else if(ev.type == EV_SYN && ev.code == SYN_REPORT)
+        {
+            if(this->syncing)
+            {
+                this->syncing = false;
+                continue;
+            }
+            if(this->accumX == 0 && this->accumY == 0)
+                continue;
+            _event.timestamp = (qint64)ev.input_event_sec * 1000000000LL +
+                    (qint64)ev.input_event_usec * 1000LL;
+            _event.dx = this->accumX;
+            _event.dy = this->accumY;
+            this->accumX = 0;
+            this->accumY = 0;
+            return true;
+        }
+    }
+#else
+    Q_UNUSED(_event);
+#endif
+    return false;
+}
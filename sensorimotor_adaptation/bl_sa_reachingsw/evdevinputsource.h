@@ -0,0 +1,63 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Input source that reads a mouse directly from a Linux evdev
+ * node (/dev/input/eventN). The relative counts are not affected by pointer
+ * acceleration or by the screen borders, and each report carries the kernel
+ * timestamp (CLOCK_MONOTONIC).
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef EVDEVINPUTSOURCE_H
+#define EVDEVINPUTSOURCE_H
+
+#include <string>
+#include "inputsource.h"
+
+class EvdevInputSource : public InputSource
+{
+public:
+    //Constructor
+    EvdevInputSource(std::string _device);
+    ~EvdevInputSource();
+
+    //Fields
+    std::string device;
+
+    //Methods
+    bool Open();
+    void Close();
+    bool Read(InputEvent &_event);
+    int fileDescriptor() const
+    {
+        return fd;
+    }
+
+    //Getters and setters
+    //Grabs the device so its movement does not reach the system pointer
+    void setGrab(bool grab)
+    {
+        m_grab = grab;
+    }
+    //Number of times the kernel reported lost events (SYN_DROPPED)
+    quint64 droppedReports() const
+    {
+        return m_droppedReports;
+    }
+
+private:
+    //Fields
+    int fd;
+    bool m_grab;
+    bool syncing; //Discarding events after a SYN_DROPPED
+    int accumX; //Counts accumulated until the next SYN_REPORT
+    int accumY;
+    quint64 m_droppedReports;
+};
+
+#endif // EVDEVINPUTSOURCE_H
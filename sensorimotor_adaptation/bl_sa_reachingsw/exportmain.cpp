@@ -0,0 +1,91 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Exports session files to MAT v5 and NumPy (see
+ * sessionexporter.h).
+ * Usage: bl_sa_export [-mat] [-npy] <prefix>_session.dat ...
+ * Without options both formats are written: <prefix>.mat and
+ * <prefix>_grid.npy, _events.npy, _trials.npy, _header.json
+ * ----------------------------------------------------------------------------
+*/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QFileInfo>
+#include "sessionfilereader.h"
+#include "sessionexporter.h"
+#include "monotonicclock.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    bool mat = false;
+    bool npy = false;
+    QStringList files;
+    QStringList arguments = a.arguments();
+    for(int i=1; i<arguments.size(); i++)
+    {
+        if(arguments.at(i) == "-mat")
+            mat = true;
+        else if(arguments.at(i) == "-npy")
+            npy = true;
+        else
+            files.push_back(arguments.at(i));
+    }
+    if(files.isEmpty())
+    {
+        out << "Usage: bl_sa_export [-mat] [-npy] <prefix>_session.dat ...\n";
+        return 1;
+    }
+    if(!mat && !npy)
+        mat = npy = true;
+
+    int failed = 0;
+    for(int i=0; i<files.size(); i++)
+    {
+        //Output prefix: the name of the session file without "_session.dat"
+        QString prefix = files.at(i);
+        if(prefix.endsWith("_session.dat"))
+            prefix.chop(12);
+        else if(prefix.endsWith(".dat"))
+            prefix.chop(4);
+
+        qint64 start = MonotonicClock::Now();
+        SessionFileReader reader(files.at(i).toStdString());
+        if(!reader.Open())
+        {
+            out << files.at(i) << ": not a session file\n";
+            failed++;
+            continue;
+        }
+        if(!reader.complete())
+            out << files.at(i) << ": session was not closed, exporting the complete blocks\n";
+
+        SessionExporter exporter(&reader);
+        bool ok = true;
+        if(mat)
+            ok = exporter.ExportMat((prefix + ".mat").toStdString());
+        if(ok && npy)
+            ok = exporter.ExportNpy(prefix.toStdString());
+        if(!ok)
+        {
+            out << files.at(i) << ": " << exporter.errorString() << "\n";
+            failed++;
+            continue;
+        }
+
+        double seconds = (MonotonicClock::Now() - start) / 1e9;
+        double megabytes = QFileInfo(files.at(i)).size() / 1e6;
+        out << files.at(i) << ": " << exporter.trials() << " trials, "
+            << QString::number(megabytes, 'f', 2) << " MB in " << QString::number(seconds, 'f', 3)
+            << " s (" << QString::number(megabytes / seconds, 'f', 1) << " MB/s)\n";
+        out.flush();
+    }
+    return failed > 0 ? 1 : 0;
+}
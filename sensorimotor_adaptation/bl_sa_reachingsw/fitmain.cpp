@@ -0,0 +1,556 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Fits the models of ../analysis/script_models.m (see
+ * adaptationmodel.h) to the trials of a cohort, with the same model code
+ * as the task. The parameters of each subject and model minimize the sum of
+ * the squared differences between the simulated and the measured
+ * adaptation (rotation minus the initial direction error of each trial, in
+ * the trial information of the session files).
+ * Each fit runs from several starts: the first is the best point of a grid
+ * over [0, 1] for every parameter, the others are pseudo-random points.
+ * From each start, a pattern search scores the 3^p neighbours of the point
+ * in one call of AdaptationModel::Score() (vectorized over the candidates),
+ * moves to the best one and halves the step when the point is the best.
+ * The starts of every subject and model are the tasks of a work-stealing
+ * pool, and the fit is repeated for each number of threads to report the
+ * wall time and the speedup (the results must not depend on it).
+ * Synthetic subjects are simulated with the parameters of the script,
+ * with optional measurement noise, to check that the fit recovers them.
+ * Each model uses the delay of the error of the script (1 trial for the
+ * two-state model, 0 for the others) unless -delay sets one for all.
+ * The least-squares fit of the task (AdaptationEstimator::Fit, the values
+ * of the trial information after the last trial) is reported next to each
+ * fit, to compare the two methods.
+ * Usage: bl_sa_fit [-model simple|single|two|all] [-delay N] [-grid N]
+ *                  [-starts N] [-threads 1,2,4] [-synthetic N]
+ *                  [-truth simple|single|two] [-noise degrees] [-seed N]
+ *                  [-csv file] <prefix>_session.dat ...
+ * ----------------------------------------------------------------------------
+*/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <cmath>
+#include <string.h>
+#include "sessionfilereader.h"
+#include "adaptationmodel.h"
+#include "adaptationestimator.h"
+#include "workstealingpool.h"
+#include "monotonicclock.h"
+
+//Trials of a subject
+struct FitSubject
+{
+    QString name;
+    QVector<double> vPerturbation;
+    QVector<double> vAdaptation;
+    //Feedback was shown and there was a movement (the error drives the learning)
+    QVector<bool> vErrorSeen;
+    //The adaptation was measured (there was a movement)
+    QVector<bool> vMeasured;
+};
+
+//Result of one start
+struct FitResult
+{
+    AdaptationParameters parameters;
+    double sse;
+    int evaluations;
+};
+
+//Pseudo-random numbers in [0, 1) (64-bit LCG, as in OfcSubject)
+static double Uniform(quint64 &_state)
+{
+    _state = _state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//Value of a "key: value" line, empty if there is none
+static QString InfoValue(const QString &_text, const QString &_key)
+{
+    QStringList lines = _text.split('\n');
+    for(int i=0; i<lines.size(); i++)
+    {
+        if(lines.at(i).startsWith(_key + ":"))
+            return lines.at(i).mid(_key.length() + 1).trimmed();
+    }
+    return QString();
+}
+
+static bool ParseModel(const QString &_name, AdaptationModel::Model &_model)
+{
+    if(_name == "simple")
+        _model = AdaptationModel::Simple;
+    else if(_name == "single")
+        _model = AdaptationModel::SingleState;
+    else if(_name == "two")
+        _model = AdaptationModel::TwoState;
+    else
+        return false;
+    return true;
+}
+
+//Free parameters of a model, as a point in [0, 1]^p
+static int Dimensions(AdaptationModel::Model _model)
+{
+    return _model == AdaptationModel::TwoState ? 4 : (_model == AdaptationModel::SingleState ? 2 : 1);
+}
+
+static AdaptationParameters FromPoint(AdaptationModel::Model _model, const double *_point)
+{
+    AdaptationParameters parameters = {1, 0, 0, 0, 0, 0};
+    switch(_model)
+    {
+    case AdaptationModel::Simple:
+        parameters.learningRate = _point[0];
+        break;
+    case AdaptationModel::SingleState:
+        parameters.retention = _point[0];
+        parameters.learningRate = _point[1];
+        break;
+    default:
+        parameters.retention = 0;
+        parameters.fastRetention = _point[0];
+        parameters.fastRate = _point[1];
+        parameters.slowRetention = _point[2];
+        parameters.slowRate = _point[3];
+        break;
+    }
+    return parameters;
+}
+
+//Trials of a session file, from the trial information
+//A trial recorded again after a resume replaces the first recording
+static bool LoadSession(const QString &_file, FitSubject &_subject, QString &_error)
+{
+    SessionFileReader reader(_file.toStdString());
+    if(!reader.Open())
+    {
+        _error = "could not read the file";
+        return false;
+    }
+    _subject.name = QFileInfo(_file).completeBaseName();
+    QVector<int> vSessions, vTrials;
+    for(int i=0; i<reader.records(); i++)
+    {
+        const TrialIndexEntry &entry = reader.entry(i);
+        if(entry.stream != StreamTrialInfo)
+            continue;
+        QString info = reader.Text(i);
+        QString error = InfoValue(info, "Initial direction error (degrees)");
+        if(error.isEmpty())
+        {
+            _error = "the trials have no kinematic features (recorded by a previous version)";
+            return false;
+        }
+        bool moved = InfoValue(info, "Movement") == "True";
+        bool feedback = InfoValue(info, "Feedback") == "True";
+        double perturbation = InfoValue(info, "Perturbation degree").toDouble();
+        int index = -1;
+        for(int k=0; k<vSessions.size() && index < 0; k++)
+            if(vSessions.at(k) == (int)entry.session && vTrials.at(k) == (int)entry.trial)
+                index = k;
+        if(index < 0)
+        {
+            index = vSessions.size();
+            vSessions.push_back(entry.session);
+            vTrials.push_back(entry.trial);
+            _subject.vPerturbation.push_back(0);
+            _subject.vAdaptation.push_back(0);
+            _subject.vErrorSeen.push_back(false);
+            _subject.vMeasured.push_back(false);
+        }
+        _subject.vPerturbation[index] = perturbation;
+        _subject.vAdaptation[index] = moved ? perturbation - error.toDouble() : 0;
+        _subject.vErrorSeen[index] = moved && feedback;
+        _subject.vMeasured[index] = moved;
+    }
+    reader.Close();
+    if(_subject.vAdaptation.isEmpty())
+    {
+        _error = "the file has no trials";
+        return false;
+    }
+    return true;
+}
+
+//Subject simulated with the parameters of the script: the perturbation of
+//the script (30 degrees from trial 101 to 200 of 400) and Gaussian noise
+//on the measured adaptation
+static FitSubject Synthetic(int _index, AdaptationModel::Model _truth, int _delay, double _noise, quint64 _seed)
+{
+    const int trials = 400;
+    FitSubject subject;
+    subject.name = "synthetic" + QString::number(_index + 1);
+    subject.vPerturbation.resize(trials);
+    subject.vAdaptation.resize(trials);
+    subject.vErrorSeen.resize(trials);
+    subject.vMeasured.resize(trials);
+    for(int i=0; i<trials; i++)
+    {
+        subject.vPerturbation[i] = i >= 100 && i < 200 ? 30 : 0;
+        subject.vErrorSeen[i] = true;
+        subject.vMeasured[i] = true;
+    }
+    AdaptationModel::Simulate(_truth, AdaptationModel::ScriptParameters(_truth), subject.vPerturbation.constData(),
+                              trials, subject.vAdaptation.data(), _delay);
+    quint64 state = _seed + 7919ULL * (_index + 1);
+    for(int i=0; i<trials && _noise > 0; i++)
+    {
+        //Box-Muller
+        double u = qMax(Uniform(state), 1e-300);
+        double v = Uniform(state);
+        subject.vAdaptation[i] += _noise * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+    }
+    return subject;
+}
+
+static void Score(const FitSubject &_subject, AdaptationModel::Model _model, int _delay,
+                  const AdaptationCandidates &_candidates, QVector<double> &_sse)
+{
+    _sse.resize(_candidates.size());
+    AdaptationModel::Score(_model, _candidates, _subject.vPerturbation.constData(), _subject.vAdaptation.constData(),
+                           _subject.vAdaptation.size(), _sse.data(), _delay,
+                           _subject.vErrorSeen.constData(), _subject.vMeasured.constData());
+}
+
+//Best point of a grid of _points values of every parameter in [0, 1]
+static void GridSearch(const FitSubject &_subject, AdaptationModel::Model _model, int _delay, int _points,
+                       double *_best, int &_evaluations)
+{
+    int dimensions = Dimensions(_model);
+    int count = 1;
+    for(int d=0; d<dimensions; d++)
+        count *= _points;
+    AdaptationCandidates candidates;
+    candidates.resize(count);
+    double point[4];
+    for(int i=0; i<count; i++)
+    {
+        for(int d=0, rest=i; d<dimensions; d++, rest/=_points)
+            point[d] = (rest % _points) / (double)(_points - 1);
+        candidates.set(i, FromPoint(_model, point));
+    }
+    QVector<double> vSse;
+    Score(_subject, _model, _delay, candidates, vSse);
+    _evaluations += count;
+    int best = 0;
+    for(int i=1; i<count; i++)
+        if(vSse.at(i) < vSse.at(best))
+            best = i;
+    for(int d=0, rest=best; d<dimensions; d++, rest/=_points)
+        _best[d] = (rest % _points) / (double)(_points - 1);
+}
+
+//Pattern search from _start with the initial _step
+static FitResult PatternSearch(const FitSubject &_subject, AdaptationModel::Model _model, int _delay,
+                               const double *_start, double _step)
+{
+    int dimensions = Dimensions(_model);
+    int neighbours = 1;
+    for(int d=0; d<dimensions; d++)
+        neighbours *= 3;
+    //The point itself: every offset is 0 (digit 1)
+    int center = (neighbours - 1) / 2;
+    double point[4];
+    for(int d=0; d<dimensions; d++)
+        point[d] = _start[d];
+
+    AdaptationCandidates candidates;
+    candidates.resize(neighbours);
+    QVector<double> vSse;
+    FitResult result;
+    result.evaluations = 0;
+    double step = _step;
+    for(int iteration=0; iteration<100000 && step > 1e-9; iteration++)
+    {
+        double neighbour[4];
+        for(int i=0; i<neighbours; i++)
+        {
+            for(int d=0, rest=i; d<dimensions; d++, rest/=3)
+                neighbour[d] = qBound(0.0, point[d] + (rest % 3 - 1) * step, 1.0);
+            candidates.set(i, FromPoint(_model, neighbour));
+        }
+        Score(_subject, _model, _delay, candidates, vSse);
+        result.evaluations += neighbours;
+        int best = center;
+        for(int i=0; i<neighbours; i++)
+            if(vSse.at(i) < vSse.at(best))
+                best = i;
+        if(best == center)
+            step /= 2;
+        else
+        {
+            for(int d=0, rest=best; d<dimensions; d++, rest/=3)
+                point[d] = qBound(0.0, point[d] + (rest % 3 - 1) * step, 1.0);
+        }
+    }
+    result.parameters = FromPoint(_model, point);
+    AdaptationCandidates last;
+    last.resize(1);
+    last.set(0, result.parameters);
+    Score(_subject, _model, _delay, last, vSse);
+    result.sse = vSse.at(0);
+    //The fast process is the one with the smaller retention
+    if(_model == AdaptationModel::TwoState && result.parameters.fastRetention > result.parameters.slowRetention)
+    {
+        qSwap(result.parameters.fastRetention, result.parameters.slowRetention);
+        qSwap(result.parameters.fastRate, result.parameters.slowRate);
+    }
+    return result;
+}
+
+static QString Describe(AdaptationModel::Model _model, const AdaptationParameters &_parameters)
+{
+    if(_model == AdaptationModel::TwoState)
+        return "Af " + QString::number(_parameters.fastRetention, 'f', 4) + " Bf " + QString::number(_parameters.fastRate, 'f', 4) +
+                " As " + QString::number(_parameters.slowRetention, 'f', 4) + " Bs " + QString::number(_parameters.slowRate, 'f', 4);
+    return "A " + QString::number(_parameters.retention, 'f', 4) + " B " + QString::number(_parameters.learningRate, 'f', 4);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    QVector<AdaptationModel::Model> vModels;
+    AdaptationModel::Model truth = AdaptationModel::TwoState;
+    //-1: the delay of the script for each model
+    int delay = -1;
+    int gridPoints = 11;
+    int starts = 8;
+    int synthetic = 0;
+    double noise = 0;
+    quint64 seed = 1;
+    QString csvFile;
+    QVector<int> vThreads;
+    QStringList files;
+    bool valid = true;
+    QStringList arguments = a.arguments();
+    for(int i=1; i<arguments.size() && valid; i++)
+    {
+        bool hasValue = i+1 < arguments.size();
+        if(arguments.at(i) == "-model" && hasValue)
+        {
+            QString name = arguments.at(++i);
+            AdaptationModel::Model model;
+            if(name == "all")
+                vModels << AdaptationModel::Simple << AdaptationModel::SingleState << AdaptationModel::TwoState;
+            else if(ParseModel(name, model))
+                vModels.push_back(model);
+            else
+                valid = false;
+        }
+        else if(arguments.at(i) == "-truth" && hasValue)
+            valid = ParseModel(arguments.at(++i), truth);
+        else if(arguments.at(i) == "-delay" && hasValue)
+        {
+            delay = arguments.at(++i).toInt();
+            valid = delay >= 0;
+        }
+        else if(arguments.at(i) == "-grid" && hasValue)
+            gridPoints = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-starts" && hasValue)
+            starts = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-synthetic" && hasValue)
+            synthetic = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-noise" && hasValue)
+            noise = arguments.at(++i).toDouble();
+        else if(arguments.at(i) == "-seed" && hasValue)
+            seed = arguments.at(++i).toULongLong();
+        else if(arguments.at(i) == "-csv" && hasValue)
+            csvFile = arguments.at(++i);
+        else if(arguments.at(i) == "-threads" && hasValue)
+        {
+            QStringList counts = arguments.at(++i).split(',');
+            for(int k=0; k<counts.size(); k++)
+                vThreads.push_back(counts.at(k).toInt());
+        }
+        else if(!arguments.at(i).startsWith("-"))
+            files.push_back(arguments.at(i));
+        else
+            valid = false;
+    }
+    for(int k=0; k<vThreads.size(); k++)
+        valid = valid && vThreads.at(k) > 0;
+    if(!valid || (files.isEmpty() && synthetic <= 0) || gridPoints < 2 || starts < 1 || delay > 7)
+    {
+        out << "Usage: bl_sa_fit [-model simple|single|two|all] [-delay N] [-grid N] [-starts N]"
+            << " [-threads 1,2,4] [-synthetic N] [-truth simple|single|two] [-noise degrees] [-seed N]"
+            << " [-csv file] <prefix>_session.dat ...\n";
+        return 1;
+    }
+    if(vModels.isEmpty())
+        vModels << AdaptationModel::Simple << AdaptationModel::SingleState << AdaptationModel::TwoState;
+    //Powers of two up to the number of cores
+    if(vThreads.isEmpty())
+    {
+        int cores = QThread::idealThreadCount();
+        for(int n=1; n<cores; n*=2)
+            vThreads.push_back(n);
+        vThreads.push_back(qMax(1, cores));
+    }
+
+    //Subjects
+    QVector<FitSubject> vSubjects;
+    for(int i=0; i<files.size(); i++)
+    {
+        FitSubject subject;
+        QString error;
+        if(!LoadSession(files.at(i), subject, error))
+        {
+            out << files.at(i) << ": " << error << "\n";
+            return 1;
+        }
+        vSubjects.push_back(subject);
+    }
+    if(synthetic > 0)
+    {
+        int truthDelay = delay >= 0 ? delay : AdaptationModel::ScriptDelay(truth);
+        out << "Synthetic subjects: " << synthetic << ", " << AdaptationModel::Name(truth) << " model, "
+            << Describe(truth, AdaptationModel::ScriptParameters(truth)) << ", delay " << truthDelay
+            << ", noise " << noise << " degrees\n";
+        for(int i=0; i<synthetic; i++)
+            vSubjects.push_back(Synthetic(i, truth, truthDelay, noise, seed));
+    }
+
+    //One task per start of each subject and model
+    int models = vModels.size();
+    int tasks = vSubjects.size() * models * starts;
+    QVector<FitResult> vResults(tasks);
+    std::function<void(int)> task = [&](int _task)
+    {
+        int start = _task % starts;
+        int model = (_task / starts) % models;
+        const FitSubject &subject = vSubjects.at(_task / (starts * models));
+        AdaptationModel::Model kind = vModels.at(model);
+        int kindDelay = delay >= 0 ? delay : AdaptationModel::ScriptDelay(kind);
+        int dimensions = Dimensions(kind);
+        double point[4];
+        int evaluations = 0;
+        double step = 0.25;
+        if(start == 0)
+        {
+            GridSearch(subject, kind, kindDelay, gridPoints, point, evaluations);
+            step = 1.0 / (gridPoints - 1);
+        }
+        else
+        {
+            quint64 state = seed * 1000003ULL + (quint64)_task;
+            for(int d=0; d<dimensions; d++)
+                point[d] = Uniform(state);
+        }
+        FitResult result = PatternSearch(subject, kind, kindDelay, point, step);
+        result.evaluations += evaluations;
+        vResults[_task] = result;
+    };
+
+    //The fit of every number of threads
+    out << "Fitting " << vSubjects.size() << " subjects, " << models << " models, " << starts
+        << " starts (" << tasks << " tasks)\n";
+    QVector<FitResult> vFirst;
+    double firstWall = 0;
+    qint64 evaluations = 0;
+    double updates = 0;
+    for(int r=0; r<vThreads.size(); r++)
+    {
+        WorkStealingPool pool(vThreads.at(r));
+        qint64 start = MonotonicClock::Now();
+        pool.Run(tasks, task);
+        double wall = (MonotonicClock::Now() - start) / 1e9;
+        bool same = true;
+        if(r == 0)
+        {
+            vFirst = vResults;
+            firstWall = wall;
+            for(int i=0; i<tasks; i++)
+            {
+                evaluations += vResults.at(i).evaluations;
+                updates += vResults.at(i).evaluations * (double)vSubjects.at(i / (starts * models)).vAdaptation.size();
+            }
+        }
+        else
+        {
+            for(int i=0; i<tasks && same; i++)
+                same = memcmp(&vFirst.at(i).parameters, &vResults.at(i).parameters, sizeof(AdaptationParameters)) == 0 &&
+                        vFirst.at(i).sse == vResults.at(i).sse;
+        }
+        //Speedup and efficiency relative to the first number of threads
+        double speedup = firstWall / wall;
+        out << "Threads " << vThreads.at(r) << ": " << QString::number(wall, 'f', 3) << " s, speedup "
+            << QString::number(speedup, 'f', 2) << ", efficiency "
+            << QString::number(100 * speedup * vThreads.at(0) / vThreads.at(r), 'f', 0) << "%, steals "
+            << pool.steals() << (same ? "" : ", RESULTS DIFFER") << "\n";
+        if(!same)
+            return 1;
+    }
+    out << QString::number(evaluations / 1e6, 'f', 2) << " M candidates scored, "
+        << QString::number(updates / firstWall / 1e9, 'f', 2) << " G trial updates/s with "
+        << vThreads.at(0) << " thread(s)\n";
+
+    //Best start of each subject and model
+    QFile csv(csvFile);
+    QTextStream csvStream(&csv);
+    if(!csvFile.isEmpty())
+    {
+        if(!csv.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            out << "Could not create " << csvFile << "\n";
+            return 1;
+        }
+        csvStream << "subject,model,retention,learning rate,fast retention,fast rate,slow retention,slow rate,sse,trials\n";
+    }
+    //Direction errors of the trials, for the least-squares fit
+    QVector< QVector<double> > vErrors(vSubjects.size());
+    for(int s=0; s<vSubjects.size(); s++)
+    {
+        const FitSubject &subject = vSubjects.at(s);
+        vErrors[s].resize(subject.vAdaptation.size());
+        for(int i=0; i<subject.vAdaptation.size(); i++)
+            vErrors[s][i] = subject.vPerturbation.at(i) - subject.vAdaptation.at(i);
+    }
+    for(int s=0; s<vSubjects.size(); s++)
+    {
+        const FitSubject &subject = vSubjects.at(s);
+        for(int m=0; m<models; m++)
+        {
+            const FitResult *best = NULL;
+            for(int k=0; k<starts; k++)
+            {
+                const FitResult &result = vFirst.at((s * models + m) * starts + k);
+                if(best == NULL || result.sse < best->sse)
+                    best = &result;
+            }
+            AdaptationModel::Model kind = vModels.at(m);
+            //Least squares on the measured states, as the task does
+            int kindDelay = delay >= 0 ? delay : AdaptationModel::ScriptDelay(kind);
+            AdaptationParameters leastSquares;
+            bool identified = AdaptationEstimator::Fit(kind, subject.vPerturbation.constData(), vErrors.at(s).constData(),
+                                                       subject.vErrorSeen.constData(), subject.vAdaptation.size(),
+                                                       leastSquares, kindDelay, subject.vMeasured.constData());
+            out << subject.name << ": " << AdaptationModel::Name(kind) << " model " << Describe(kind, best->parameters)
+                << ", SSE " << QString::number(best->sse, 'g', 6) << " (task least squares "
+                << (identified ? Describe(kind, leastSquares) : QString("not identified")) << ")\n";
+            if(!csvFile.isEmpty())
+            {
+                const AdaptationParameters &p = best->parameters;
+                csvStream << subject.name << "," << AdaptationModel::Name(kind) << ","
+                          << QString::number(p.retention, 'g', 10) << "," << QString::number(p.learningRate, 'g', 10) << ","
+                          << QString::number(p.fastRetention, 'g', 10) << "," << QString::number(p.fastRate, 'g', 10) << ","
+                          << QString::number(p.slowRetention, 'g', 10) << "," << QString::number(p.slowRate, 'g', 10) << ","
+                          << QString::number(best->sse, 'g', 10) << "," << subject.vAdaptation.size() << "\n";
+            }
+        }
+    }
+    if(!csvFile.isEmpty())
+        csv.close();
+    return 0;
+}
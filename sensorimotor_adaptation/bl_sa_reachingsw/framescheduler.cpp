@@ -0,0 +1,135 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "framescheduler.h"
+#include "monotonicclock.h"
+
+#include <time.h>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWindow>
+
+FrameScheduler::FrameScheduler(QWidget *_widget)
+{
+    this->widget = _widget;
+    this->pending = false;
+    this->lastFrame = 0;
+    this->frameStart = 0;
+
+    //Refresh rate of the screen where the window is, 60 Hz if unknown
+    QScreen *screen = NULL;
+    if(this->widget->windowHandle() != NULL)
+        screen = this->widget->windowHandle()->screen();
+    if(screen == NULL)
+        screen = QGuiApplication::primaryScreen();
+    this->setRefreshRate(screen != NULL ? screen->refreshRate() : 60);
+
+    //Waits for the next frame when a change arrives too early
+    this->timer = new QTimer(this);
+    this->timer->setSingleShot(true);
+    this->timer->setTimerType(Qt::PreciseTimer);
+    connect(this->timer,SIGNAL(timeout()),this,SLOT(frameDue()));
+
+    this->ResetStats();
+}
+
+void FrameScheduler::setRefreshRate(double _refreshRate)
+{
+    if(_refreshRate <= 0)
+        _refreshRate = 60;
+    this->m_refreshRate = _refreshRate;
+    this->m_framePeriod = qRound64(1e9 / _refreshRate);
+}
+
+//Schedules a frame: right away if the last one is older than a refresh
+//period, otherwise when that period has passed
+//Changes that arrive while a frame is scheduled are drawn by it
+void FrameScheduler::Invalidate()
+{
+    this->m_stats.requests++;
+    if(this->pending)
+    {
+        this->m_stats.coalesced++;
+        return;
+    }
+    this->pending = true;
+
+    qint64 wait = this->lastFrame + this->m_framePeriod - MonotonicClock::Now();
+    if(wait <= 0)
+        this->widget->update();
+    else
+        this->timer->start((int)((wait + 999999) / 1000000));
+}
+
+void FrameScheduler::frameDue()
+{
+    this->widget->update();
+}
+
+//Paint events sent by the window system (expose, resize) are frames too,
+//and draw any change that was waiting
+void FrameScheduler::BeginFrame()
+{
+    this->timer->stop();
+    this->pending = false;
+    this->frameStart = MonotonicClock::Now();
+    this->lastFrame = this->frameStart;
+}
+
+void FrameScheduler::EndFrame()
+{
+    qint64 paintTime = MonotonicClock::Now() - this->frameStart;
+    this->m_stats.frames++;
+    this->m_stats.paintTime += paintTime;
+    if(paintTime > this->m_stats.maxPaintTime)
+        this->m_stats.maxPaintTime = paintTime;
+}
+
+void FrameScheduler::ResetStats()
+{
+    this->m_stats.requests = 0;
+    this->m_stats.coalesced = 0;
+    this->m_stats.frames = 0;
+    this->m_stats.paintTime = 0;
+    this->m_stats.maxPaintTime = 0;
+    this->m_stats.elapsed = 0;
+    this->m_stats.cpuTime = 0;
+    this->statsStart = MonotonicClock::Now();
+    this->cpuStart = ThreadCpuTime();
+}
+
+FrameScheduler::Stats FrameScheduler::stats() const
+{
+    Stats stats = this->m_stats;
+    stats.elapsed = MonotonicClock::Now() - this->statsStart;
+    stats.cpuTime = ThreadCpuTime() - this->cpuStart;
+    return stats;
+}
+
+QString FrameScheduler::Summary() const
+{
+    Stats s = this->stats();
+    double seconds = s.elapsed / 1e9;
+    QString summary;
+    summary += "Frames: " + QString::number(s.frames);
+    summary += " (" + QString::number(seconds > 0 ? s.frames / seconds : 0, 'f', 1) + "/s, display ";
+    summary += QString::number(this->m_refreshRate, 'f', 1) + " Hz)";
+    summary += ", requests " + QString::number(s.requests) + ", coalesced " + QString::number(s.coalesced);
+    summary += ", paint mean " + QString::number(s.frames > 0 ? s.paintTime / 1e3 / s.frames : 0, 'f', 1);
+    summary += " us max " + QString::number(s.maxPaintTime / 1e3, 'f', 1) + " us";
+    summary += ", GUI thread CPU " + QString::number(s.elapsed > 0 ? 100.0 * s.cpuTime / s.elapsed : 0, 'f', 1) + "%";
+    return summary;
+}
+
+//CPU time used by the calling thread (ns)
+qint64 FrameScheduler::ThreadCpuTime()
+{
+    struct timespec ts;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return (qint64)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
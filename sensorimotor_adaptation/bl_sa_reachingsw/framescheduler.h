@@ -0,0 +1,95 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Decides when the task window is repainted. The window is only
+ * repainted after something on screen has changed (Invalidate()), and at
+ * most once per refresh of the display: every change that arrives before
+ * the next frame is due is drawn by that same frame. When nothing changes
+ * the GUI thread sleeps, leaving the CPU to the acquisition thread.
+ * Used only on the GUI thread.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QObject>
+#include <QWidget>
+#include <QTimer>
+#include <QString>
+
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    //Frame counters
+    struct Stats
+    {
+        quint64 requests; //Calls to Invalidate()
+        quint64 coalesced; //Requests drawn by a frame that was already scheduled
+        quint64 frames; //Frames painted
+        qint64 paintTime; //Time spent painting (ns)
+        qint64 maxPaintTime; //Longest frame (ns)
+        qint64 elapsed; //Time since the counters were reset (ns)
+        qint64 cpuTime; //CPU time used by the GUI thread in that time (ns)
+    };
+
+    //Constructor
+    //_widget: window that is repainted
+    FrameScheduler(QWidget *_widget);
+
+    //Methods
+    //Something on screen has changed: schedules a frame
+    void Invalidate();
+    //Called by the paint event of the window around the drawing
+    void BeginFrame();
+    void EndFrame();
+    //Clears the counters
+    void ResetStats();
+
+    //Getters and setters
+    //Refresh rate of the display (Hz), read from the screen of the window
+    void setRefreshRate(double _refreshRate);
+    double refreshRate() const
+    {
+        return m_refreshRate;
+    }
+    //Minimum interval between frames (ns)
+    qint64 framePeriod() const
+    {
+        return m_framePeriod;
+    }
+    Stats stats() const;
+    //One-line summary of the counters
+    QString Summary() const;
+
+private slots:
+    void frameDue();
+
+private:
+    //Fields
+    QWidget *widget;
+    QTimer *timer;
+    double m_refreshRate;
+    qint64 m_framePeriod;
+    //A frame has been requested and not yet painted
+    bool pending;
+    //Start of the last frame
+    qint64 lastFrame;
+    //Start of the frame being painted
+    qint64 frameStart;
+    Stats m_stats;
+    qint64 statsStart;
+    qint64 cpuStart;
+
+    //Methods
+    static qint64 ThreadCpuTime();
+};
+
+#endif // FRAMESCHEDULER_H
@@ -12,6 +12,8 @@
 
 #include "guiobject.h"
 
+#include <cmath>
+
 //Default constructor
 GUIObject::GUIObject()
 {
@@ -19,6 +21,7 @@ GUIObject::GUIObject()
     this->height = 20;
     this->pen = new QPen(Qt::blue);
     this->point = new QPointF(0.0,0.0);
+    this->paintColor = NULL;
     this->type = this->Ellipse;
 }
 
@@ -26,51 +29,67 @@ GUIObject::GUIObject()
 GUIObject::~GUIObject()
 {
     //Frees the allocated pointers
-    free(this->point); //QPointF
-    free(this->pen); //QPen
-    free(this->paintColor); //QColor
+    //They were created with new, so they are released with delete
+    delete this->point; //QPointF
+    delete this->pen; //QPen
+    delete this->paintColor; //QColor
 }
 
 //Method that determines whether another GUIObject
 //has collided with the current object
 bool GUIObject::HasCollided(GUIObject* _obj)
 {
-    //Measuring the Euclidean Distance
-    double distance = this->EuclideanDistance(_obj);
     //The object has collided if the distance between
     //the two objects is inferior to the sum of
     //the objects' radius
-    if(distance <= this->width+_obj->width)
-        return true;
-    else
-        return false;
+    //Squared values are compared, so no square root is needed
+    double reach = this->width + _obj->width;
+    return this->SquaredDistance(_obj) <= reach*reach;
 }
 
 //Method that determines whether another GUIObject
 //has collided with the center of the current object
 bool GUIObject::HasCollidedCenter(GUIObject *_obj)
 {
-    //Measuring the Euclidean Distance
-    double distance = this->EuclideanDistance(_obj);
-    if(distance <= _obj->width/2.0)
-        return true;
-    else
-        return false;
+    double radius = _obj->width/2.0;
+    return this->SquaredDistance(_obj) <= radius*radius;
 }
 
-//Determines whether another GUIOBject is inside the
-//current object
+//Determines whether the center of another GUIObject is inside the
+//current object, with the shape that is drawn on the screen:
+//Ellipse: centered on "point", with semi-axes "width" and "height"
+//(QPainter::drawEllipse(center, rx, ry))
+//Rectangle: "point" is the top-left corner (QPainter::drawRect())
 bool GUIObject::IsInside(GUIObject* _obj)
 {
-    //TODO: Implement this method
-   return false;
+    double x = _obj->point->x() - this->point->x();
+    double y = _obj->point->y() - this->point->y();
+    switch(this->type)
+    {
+    case Ellipse:
+    {
+        //(x/w)^2 + (y/h)^2 <= 1, without divisions
+        double w2 = (double)this->width * this->width;
+        double h2 = (double)this->height * this->height;
+        return x*x*h2 + y*y*w2 <= w2*h2;
+    }
+    case Rectangle:
+        return x >= 0 && x <= this->width && y >= 0 && y <= this->height;
+    }
+    return false;
+}
+
+//Squared euclidean distance between the current object and another GUIObject
+double GUIObject::SquaredDistance(GUIObject* _obj)
+{
+    double x = (double)this->point->x() - (double)_obj->point->x();
+    double y = (double)this->point->y() - (double)_obj->point->y();
+    return x*x + y*y;
 }
 
 //Method that measures the Euclidean distance between
 //the current object and another GUIObject
 double GUIObject::EuclideanDistance(GUIObject* _obj)
 {
-    double x = (double)this->point->x() - (double)_obj->point->x();
-    double y = (double)this->point->y() - (double)_obj->point->y();
-    return std::sqrt(std::pow(x,2) + std::pow(y,2));
+    return std::sqrt(this->SquaredDistance(_obj));
 }
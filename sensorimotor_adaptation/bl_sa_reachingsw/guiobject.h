@@ -32,12 +32,15 @@ public:
     //Determines whether another GUIObject has
     //collided with the center of the current object
     bool HasCollidedCenter(GUIObject *_obj);
-    //Determines whether another GUIOBject is inside the
-    //current object
+    //Determines whether the center of another GUIObject is inside
+    //the current object (ellipse or rectangle, as drawn)
     bool IsInside(GUIObject* _obj);
     //Measures the euclidean distance between
     //the current object and another GUIObject
-    double EuclideanDistance(GUIObject *_obj);    
+    double EuclideanDistance(GUIObject *_obj);
+    //Squared euclidean distance (no square root), used by the
+    //collision tests
+    double SquaredDistance(GUIObject *_obj);
 
     //Properties
     //Determines the parameters of the QPen object
@@ -0,0 +1,49 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Interface for the devices that provide the hand movement.
+ * A source delivers relative displacements (counts) with the monotonic time
+ * at which they happened. CursorController integrates them into a position.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef INPUTSOURCE_H
+#define INPUTSOURCE_H
+
+#include <QtGlobal>
+
+//Relative movement reported by an input source
+struct InputEvent
+{
+    qint64 timestamp; //Monotonic timestamp (ns)
+    int dx; //Displacement in X (counts)
+    int dy; //Displacement in Y (counts)
+};
+
+class InputSource
+{
+public:
+    virtual ~InputSource() {}
+
+    //Methods
+    //Opens the device
+    virtual bool Open() = 0;
+    //Closes the device
+    virtual void Close() = 0;
+    //Reads the next pending event without blocking
+    //Returns false if there are no pending events
+    virtual bool Read(InputEvent &_event) = 0;
+    //File descriptor that becomes readable when new events arrive
+    //Sources that are not backed by a device return -1 and must be polled
+    virtual int fileDescriptor() const
+    {
+        return -1;
+    }
+};
+
+#endif // INPUTSOURCE_H
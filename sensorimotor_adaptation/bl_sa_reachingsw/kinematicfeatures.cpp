@@ -0,0 +1,163 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "kinematicfeatures.h"
+
+#include <QtMath>
+#include <cmath>
+
+//Angle from the direction (_ax, _ay) to (_bx, _by), between -180 and 180 degrees
+static double AngleBetween(double _ax, double _ay, double _bx, double _by)
+{
+    double angle = atan2(_by, _bx) - atan2(_ay, _ax);
+    return atan2(sin(angle), cos(angle)) * 180.0 / M_PI;
+}
+
+//Default constructor
+KinematicFeatures::KinematicFeatures(qint64 _period)
+{
+    this->m_onsetSpeed = 100;
+    this->setPeriod(_period);
+    this->Begin(0, 0, 0);
+}
+
+//The speed is measured over about 20 ms
+void KinematicFeatures::setPeriod(qint64 _period)
+{
+    this->period = _period;
+    this->lag = qBound(1, (int)qRound(20000000.0 / _period), (int)maxLag - 1);
+}
+
+void KinematicFeatures::Begin(qint64 _startTime, double _targetX, double _targetY)
+{
+    this->startTime = _startTime;
+    this->targetX = _targetX;
+    this->targetY = _targetY;
+    this->startX = 0;
+    this->startY = 0;
+    this->samples = 0;
+    this->onsetTime = -1;
+    this->lastMovingTime = -1;
+    this->peakVelocity = 0;
+    this->peakX = 0;
+    this->peakY = 0;
+    this->pathLength = 0;
+}
+
+void KinematicFeatures::Push(const CursorSample &_sample)
+{
+    if(this->samples == 0)
+    {
+        this->startX = _sample.x;
+        this->startY = _sample.y;
+    }
+    else
+    {
+        double dx = _sample.x - this->last.x;
+        double dy = _sample.y - this->last.y;
+        this->pathLength += sqrt(dx*dx + dy*dy);
+    }
+    this->last = _sample;
+    this->ring[this->samples % maxLag] = _sample;
+    this->samples++;
+    if(this->samples <= this->lag)
+        return;
+
+    //Speed over the last lag periods
+    const CursorSample &before = this->ring[(this->samples - 1 - this->lag) % maxLag];
+    double dx = _sample.x - before.x;
+    double dy = _sample.y - before.y;
+    double speed = sqrt(dx*dx + dy*dy) * 1e9 / (this->lag * this->period);
+    if(speed > this->m_onsetSpeed)
+    {
+        if(this->onsetTime < 0)
+            this->onsetTime = before.timestamp;
+        this->lastMovingTime = _sample.timestamp;
+    }
+    if(speed > this->peakVelocity)
+    {
+        this->peakVelocity = speed;
+        this->peakX = _sample.x;
+        this->peakY = _sample.y;
+    }
+}
+
+TrialFeatures KinematicFeatures::Result() const
+{
+    TrialFeatures features;
+    features.session = 0;
+    features.trial = 0;
+    features.target = 0;
+    features.moved = this->onsetTime >= 0;
+    features.reactionTime = features.moved ? (this->onsetTime - this->startTime) / 1e6 : 0;
+    features.movementTime = features.moved ? (this->lastMovingTime - this->onsetTime) / 1e6 : 0;
+    features.peakVelocity = this->peakVelocity;
+    features.pathLength = this->pathLength;
+    double tx = this->targetX - this->startX;
+    double ty = this->targetY - this->startY;
+    features.initialDirectionError = features.moved ?
+                AngleBetween(tx, ty, this->peakX - this->startX, this->peakY - this->startY) : 0;
+    if(this->samples > 0)
+    {
+        double ex = this->last.x - this->targetX;
+        double ey = this->last.y - this->targetY;
+        features.endpointError = sqrt(ex*ex + ey*ey);
+        features.endpointDirectionError = AngleBetween(tx, ty, this->last.x - this->startX, this->last.y - this->startY);
+    }
+    else
+    {
+        features.endpointError = 0;
+        features.endpointDirectionError = 0;
+    }
+    return features;
+}
+
+QString KinematicFeatures::Describe(const TrialFeatures &_features)
+{
+    QString text;
+    text += QString("Movement: ") + (_features.moved ? "True" : "False") + "\n";
+    text += "Reaction time (ms): " + QString::number(_features.reactionTime, 'f', 1) + "\n";
+    text += "Movement time (ms): " + QString::number(_features.movementTime, 'f', 1) + "\n";
+    text += "Peak velocity (pixels/s): " + QString::number(_features.peakVelocity, 'f', 1) + "\n";
+    text += "Initial direction error (degrees): " + QString::number(_features.initialDirectionError, 'f', 2) + "\n";
+    text += "Endpoint error (pixels): " + QString::number(_features.endpointError, 'f', 1) + "\n";
+    text += "Endpoint direction error (degrees): " + QString::number(_features.endpointDirectionError, 'f', 2) + "\n";
+    text += "Path length (pixels): " + QString::number(_features.pathLength, 'f', 1) + "\n";
+    return text;
+}
+
+QString KinematicFeatures::Table(const QVector<TrialFeatures> &_trials)
+{
+    QString table = "Session\tTrial\tTarget\tReaction time (ms)\tMovement time (ms)\tPeak velocity (pixels/s)\t"
+                    "Initial direction error (degrees)\tEndpoint error (pixels)\t"
+                    "Endpoint direction error (degrees)\tPath length (pixels)\n";
+    double sum[7] = {0, 0, 0, 0, 0, 0, 0};
+    int moved = 0;
+    for(int i=0; i<_trials.size(); i++)
+    {
+        const TrialFeatures &f = _trials.at(i);
+        double values[7] = {f.reactionTime, f.movementTime, f.peakVelocity, f.initialDirectionError,
+                            f.endpointError, f.endpointDirectionError, f.pathLength};
+        table += QString::number(f.session) + "\t" + QString::number(f.trial) + "\t" + QString::number(f.target + 1);
+        //Without a movement, there is no onset to time nor direction at the peak velocity
+        for(int k=0; k<7; k++)
+            table += "\t" + (f.moved || (k != 0 && k != 1 && k != 3) ?
+                                 QString::number(values[k], 'f', 2) : QString("NaN"));
+        table += "\n";
+        if(f.moved)
+        {
+            moved++;
+            for(int k=0; k<7; k++)
+                sum[k] += values[k];
+        }
+    }
+    table += "Mean\t\t";
+    for(int k=0; k<7; k++)
+        table += "\t" + (moved > 0 ? QString::number(sum[k] / moved, 'f', 2) : QString("NaN"));
+    table += "\n";
+    return table;
+}
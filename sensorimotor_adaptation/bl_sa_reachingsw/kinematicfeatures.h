@@ -0,0 +1,104 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Kinematic features of a trial, computed while it is recorded.
+ * Each grid sample of the visual feedback updates the features, and only a
+ * few samples are kept (the speed is measured over about 20 ms), so the
+ * memory does not depend on the length of the trial and the features are
+ * ready as soon as the trial ends:
+ * - reaction time: start of the trial to the onset of the movement (the
+ *   speed exceeds the onset threshold)
+ * - movement time: onset to the last sample above the threshold
+ * - peak velocity, and the initial direction error at the peak velocity
+ *   (angle from the target to the feedback, seen from the start position)
+ * - endpoint error: distance and angle from the target to the last sample
+ * - path length of the feedback
+ * Table() formats the features of the trials of a session, with their mean.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef KINEMATICFEATURES_H
+#define KINEMATICFEATURES_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include "samplebuffer.h" //CursorSample
+
+//Features of one trial
+struct TrialFeatures
+{
+    int session;
+    int trial;
+    int target;
+    bool moved; //The speed has exceeded the onset threshold
+    double reactionTime; //ms
+    double movementTime; //ms
+    double peakVelocity; //pixels/s
+    double initialDirectionError; //degrees
+    double endpointError; //pixels
+    double endpointDirectionError; //degrees
+    double pathLength; //pixels
+};
+
+class KinematicFeatures
+{
+public:
+    //Constructor
+    //_period: interval of the grid (ns)
+    KinematicFeatures(qint64 _period = 10000000);
+
+    //Methods
+    //Starts a trial: the first grid sample is at _startTime
+    void Begin(qint64 _startTime, double _targetX, double _targetY);
+    //Adds a grid sample
+    void Push(const CursorSample &_sample);
+    //Features of the trial so far (session, trial and target are not set)
+    TrialFeatures Result() const;
+    //"Name: value" lines of the features, as in the trial information
+    static QString Describe(const TrialFeatures &_features);
+    //Table of the trials of a session (tab-separated), with the mean of the
+    //trials with a movement
+    static QString Table(const QVector<TrialFeatures> &_trials);
+
+    //Getters and setters
+    void setPeriod(qint64 _period);
+    //Speed that marks the onset of the movement (pixels/s)
+    void setOnsetSpeed(double _speed)
+    {
+        m_onsetSpeed = _speed;
+    }
+    double onsetSpeed() const
+    {
+        return m_onsetSpeed;
+    }
+
+private:
+    //Last samples, for the speed
+    enum { maxLag = 8 };
+    CursorSample ring[maxLag];
+    int lag;
+    qint64 period;
+    double m_onsetSpeed;
+    //State of the trial
+    qint64 startTime;
+    double targetX;
+    double targetY;
+    double startX;
+    double startY;
+    int samples;
+    qint64 onsetTime;
+    qint64 lastMovingTime;
+    double peakVelocity;
+    double peakX;
+    double peakY;
+    double pathLength;
+    CursorSample last;
+};
+
+#endif // KINEMATICFEATURES_H
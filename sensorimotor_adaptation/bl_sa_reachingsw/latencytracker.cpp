@@ -0,0 +1,170 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "latencytracker.h"
+
+#include <cmath>
+
+LatencyTracker::LatencyTracker(int _maxFrames)
+{
+    this->maxFrames = _maxFrames;
+    this->vFrames.reserve(_maxFrames);
+    this->inputPending = false;
+    this->state = Idle;
+    this->Reset();
+}
+
+//A frame that is going through the pipeline is counted after the reset
+void LatencyTracker::Reset()
+{
+    this->m_frames = 0;
+    this->m_incomplete = 0;
+    this->m_maxLatency = 0;
+    this->sumLatency = 0;
+    for(int i=0; i<this->stages; i++)
+    {
+        this->sumStage[i] = 0;
+        this->maxStage[i] = 0;
+    }
+    for(int i=0; i<this->latencyBins; i++)
+        this->latencyHistogram[i] = 0;
+    //Keeps the memory reserved by the constructor
+    this->vFrames.resize(0);
+}
+
+//Only the first movement after the last frame is kept
+void LatencyTracker::InputEvent(qint64 _input, qint64 _move)
+{
+    if(this->inputPending)
+        return;
+    this->inputPending = true;
+    this->pendingInput = _input;
+    this->pendingMove = _move;
+}
+
+bool LatencyTracker::SceneUpdated(qint64 _time)
+{
+    if(!this->inputPending)
+        return false;
+    //The previous frame was never flushed
+    if(this->state != Idle)
+        this->m_incomplete++;
+    this->inputPending = false;
+    this->current.input = this->pendingInput;
+    this->current.move = this->pendingMove;
+    this->current.scene = _time;
+    this->state = Scene;
+    return true;
+}
+
+void LatencyTracker::PaintEnded(qint64 _time)
+{
+    if(this->state != Scene)
+        return;
+    this->current.paint = _time;
+    this->state = Painted;
+}
+
+void LatencyTracker::FrameFlushed(qint64 _time)
+{
+    if(this->state != Painted)
+        return;
+    this->current.flush = _time;
+    this->state = Idle;
+    this->AddFrame(this->current);
+}
+
+void LatencyTracker::AddFrame(const Frame &_frame)
+{
+    qint64 stage[stages] = {_frame.move - _frame.input, _frame.scene - _frame.move,
+                            _frame.paint - _frame.scene, _frame.flush - _frame.paint};
+    for(int i=0; i<this->stages; i++)
+    {
+        this->sumStage[i] += stage[i];
+        if(stage[i] > this->maxStage[i])
+            this->maxStage[i] = stage[i];
+    }
+
+    qint64 latency = _frame.flush - _frame.input;
+    this->m_frames++;
+    this->sumLatency += latency;
+    if(latency > this->m_maxLatency)
+        this->m_maxLatency = latency;
+    int bin = latency < 0 ? 0 : (int)(latency / this->binWidth);
+    if(bin >= this->latencyBins)
+        bin = this->latencyBins - 1;
+    this->latencyHistogram[bin]++;
+
+    if(this->vFrames.size() < this->maxFrames)
+        this->vFrames.push_back(_frame);
+}
+
+//Upper edge of the histogram bin where the fraction is reached
+qint64 LatencyTracker::Percentile(double _fraction) const
+{
+    if(this->m_frames == 0)
+        return 0;
+    quint64 target = (quint64)ceil(_fraction * this->m_frames);
+    quint64 count = 0;
+    for(int i=0; i<this->latencyBins; i++)
+    {
+        count += this->latencyHistogram[i];
+        if(count >= target)
+            return (qint64)(i+1) * this->binWidth;
+    }
+    return this->m_maxLatency;
+}
+
+QString LatencyTracker::Summary() const
+{
+    QString s;
+    s += "frames " + QString::number(this->m_frames);
+    s += "; input-to-display latency mean (ms) " +
+            QString::number(this->m_frames > 0 ? this->sumLatency/this->m_frames/1e6 : 0.0,'f',2);
+    s += "; p50/p95/p99/max (ms) " + QString::number(this->Percentile(0.5)/1e6,'f',2) +
+            "/" + QString::number(this->Percentile(0.95)/1e6,'f',2) +
+            "/" + QString::number(this->Percentile(0.99)/1e6,'f',2) +
+            "/" + QString::number(this->m_maxLatency/1e6,'f',2);
+    s += "; incomplete " + QString::number(this->m_incomplete);
+    return s;
+}
+
+//Full report written next to the data of each trial
+QString LatencyTracker::Report() const
+{
+    static const char *names[stages] = {"Input event to MouseMove()", "MouseMove() to updateGUI()",
+                                        "updateGUI() to end of paint", "End of paint to flush"};
+    QString r;
+    r += "Input-to-display latency\n";
+    r += "-------------------------------------\n";
+    r += "Frames: " + QString::number(this->m_frames) + "\n";
+    r += "Frames not flushed: " + QString::number(this->m_incomplete) + "\n";
+    r += "Mean latency (us): " + QString::number(this->m_frames > 0 ? this->sumLatency/this->m_frames/1000.0 : 0.0,'f',1) + "\n";
+    r += "Latency p50/p95/p99/max (us): " + QString::number(this->Percentile(0.5)/1000) + "/" +
+            QString::number(this->Percentile(0.95)/1000) + "/" +
+            QString::number(this->Percentile(0.99)/1000) + "/" +
+            QString::number(this->m_maxLatency/1000) + "\n";
+    for(int i=0; i<this->stages; i++)
+        r += QString(names[i]) + " mean/max (us): " +
+                QString::number(this->m_frames > 0 ? this->sumStage[i]/this->m_frames/1000.0 : 0.0,'f',1) + "/" +
+                QString::number(this->maxStage[i]/1000.0,'f',1) + "\n";
+    r += "-------------------------------------\n";
+    r += "Latency histogram (bin start in us, count)\n";
+    for(int i=0; i<this->latencyBins; i++)
+        if(this->latencyHistogram[i] > 0)
+            r += QString::number(i*this->binWidth/1000) + "\t" + QString::number(this->latencyHistogram[i]) + "\n";
+    r += "-------------------------------------\n";
+    r += "Frames (monotonic ns): input, MouseMove(), updateGUI(), end of paint, flush\n";
+    for(int i=0; i<this->vFrames.size(); i++)
+    {
+        const Frame &f = this->vFrames.at(i);
+        r += QString::number(f.input) + "\t" + QString::number(f.move) + "\t" +
+                QString::number(f.scene) + "\t" + QString::number(f.paint) + "\t" +
+                QString::number(f.flush) + "\n";
+    }
+    return r;
+}
@@ -0,0 +1,115 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Latency between a movement of the mouse and the frame that
+ * shows the new position of the feedback cursor. Every frame that shows a
+ * new position is followed through the pipeline:
+ *   input:  time of the input event (evdev: kernel time; system cursor:
+ *           time of the mouse event, see ProtocolController::eventTime())
+ *   move:   the event is processed (MouseMove())
+ *   scene:  the position is copied to the scene (updateGUI())
+ *   paint:  the frame has been drawn (end of the paint event)
+ *   flush:  the frame has been handed to the window system (end of the
+ *           update request, when the backing store is flushed)
+ * When several events arrive before a frame, the oldest one is used, so the
+ * latency is the longest wait of any movement shown by that frame.
+ * Used only on the GUI thread. Memory is allocated by the constructor.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef LATENCYTRACKER_H
+#define LATENCYTRACKER_H
+
+#include <QString>
+#include <QVector>
+
+class LatencyTracker
+{
+public:
+    //Timestamps (monotonic, ns) of one frame
+    struct Frame
+    {
+        qint64 input;
+        qint64 move;
+        qint64 scene;
+        qint64 paint;
+        qint64 flush;
+    };
+
+    //Constructor
+    //_maxFrames: frames kept individually for the report (the histogram
+    //and the statistics include every frame)
+    LatencyTracker(int _maxFrames = 16384);
+
+    //Methods
+    //Clears every counter (start of a trial)
+    void Reset();
+    //The feedback cursor has moved: input event at _input, processed at _move
+    void InputEvent(qint64 _input, qint64 _move);
+    //The scene of the next frame was updated at _time
+    //Returns true if the frame shows a movement that was not shown yet
+    bool SceneUpdated(qint64 _time);
+    //The frame has been drawn
+    void PaintEnded(qint64 _time);
+    //The frame has been handed to the window system
+    void FrameFlushed(qint64 _time);
+    //Latency (input to flush, ns) below which the given fraction (0-1) of
+    //the frames are
+    qint64 Percentile(double _fraction) const;
+    //One-line summary
+    QString Summary() const;
+    //Summary, mean and maximum of each stage, histogram and every frame
+    QString Report() const;
+
+    //Getters
+    int frames() const
+    {
+        return m_frames;
+    }
+    //Frames that were drawn but never flushed (e.g. painted by an expose event)
+    int incomplete() const
+    {
+        return m_incomplete;
+    }
+    qint64 maxLatency() const
+    {
+        return m_maxLatency;
+    }
+
+    //Histogram of the latency: bins of 250 us from 0 to 100 ms
+    //The last bin counts the values beyond the range
+    static const int binWidth = 250000;
+    static const int latencyBins = 400;
+    //Stages: input-move, move-scene, scene-paint, paint-flush
+    static const int stages = 4;
+
+private:
+    //Fields
+    //First movement not yet taken by a frame
+    bool inputPending;
+    qint64 pendingInput;
+    qint64 pendingMove;
+    //Frame going through the pipeline
+    enum FrameState{Idle=0, Scene=1, Painted=2};
+    FrameState state;
+    Frame current;
+    int m_frames;
+    int m_incomplete;
+    qint64 m_maxLatency;
+    double sumLatency;
+    double sumStage[stages];
+    qint64 maxStage[stages];
+    quint32 latencyHistogram[latencyBins];
+    QVector<Frame> vFrames;
+    int maxFrames;
+
+    //Methods
+    void AddFrame(const Frame &_frame);
+};
+
+#endif // LATENCYTRACKER_H
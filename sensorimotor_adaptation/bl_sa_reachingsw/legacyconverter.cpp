@@ -0,0 +1,377 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "legacyconverter.h"
+#include "sessionfilewriter.h"
+#include "sessionfilereader.h"
+
+#include <algorithm>
+#include <string.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+
+//Samples in each block of the converted session files
+static const int blockSamples = 256;
+
+//Orders the trials by session and trial
+static bool TrialLessThan(const LegacyTrialFiles &_a, const LegacyTrialFiles &_b)
+{
+    if(_a.session != _b.session)
+        return _a.session < _b.session;
+    return _a.trial < _b.trial;
+}
+
+//Value of a "Name: value" line of the header, empty if it does not exist
+static QString HeaderValue(const QString &_header, const QString &_name)
+{
+    QStringList lines = _header.split('\n');
+    for(int i=0; i<lines.size(); i++)
+        if(lines.at(i).startsWith(_name + ":"))
+            return lines.at(i).mid(_name.size() + 1).trimmed();
+    return QString();
+}
+
+//Finds every <prefix>_header.txt and its trial files
+QVector<LegacyExperiment> LegacyConverter::Scan(const QString &_root)
+{
+    QVector<LegacyExperiment> experiments;
+    QDirIterator it(_root, QStringList() << "*_header.txt", QDir::Files, QDirIterator::Subdirectories);
+    while(it.hasNext())
+    {
+        QString headerFile = it.next();
+        QFileInfo info(headerFile);
+        QString base = info.fileName();
+        base.chop(11); //"_header.txt"
+
+        LegacyExperiment experiment;
+        experiment.header = headerFile;
+        experiment.prefix = info.dir().filePath(base);
+
+        //<base>_data_S_T.txt
+        QString dataPrefix = base + "_data_";
+        QStringList files = info.dir().entryList(QStringList() << dataPrefix + "*_*.txt", QDir::Files);
+        for(int i=0; i<files.size(); i++)
+        {
+            QString numbers = files.at(i).mid(dataPrefix.size());
+            numbers.chop(4); //".txt"
+            QStringList parts = numbers.split('_');
+            bool okSession = false, okTrial = false;
+            LegacyTrialFiles trial;
+            if(parts.size() == 2)
+            {
+                trial.session = parts.at(0).toInt(&okSession);
+                trial.trial = parts.at(1).toInt(&okTrial);
+            }
+            if(!okSession || !okTrial)
+                continue;
+            QString suffix = "_" + numbers + ".txt";
+            trial.data = info.dir().filePath(files.at(i));
+            trial.events = experiment.prefix + "_events" + suffix;
+            if(!QFile::exists(trial.events))
+                trial.events.clear();
+            trial.timing = experiment.prefix + "_timing" + suffix;
+            if(!QFile::exists(trial.timing))
+                trial.timing.clear();
+            experiment.trials.push_back(trial);
+        }
+        std::sort(experiment.trials.begin(), experiment.trials.end(), TrialLessThan);
+        experiments.push_back(experiment);
+    }
+    return experiments;
+}
+
+//Reads a number without using the locale: the decimal separator is always '.'
+const char* LegacyConverter::ParseNumber(const char *_p, const char *_end, qint64 &_value)
+{
+    while(_p < _end && (*_p == ' ' || *_p == '\t'))
+        _p++;
+    bool negative = false;
+    if(_p < _end && (*_p == '-' || *_p == '+'))
+    {
+        negative = *_p == '-';
+        _p++;
+    }
+    qint64 value = 0;
+    int digits = 0;
+    while(_p < _end && *_p >= '0' && *_p <= '9')
+    {
+        if(++digits > 18)
+            return NULL;
+        value = value*10 + (*_p - '0');
+        _p++;
+    }
+    if(_p < _end && *_p == '.')
+    {
+        _p++;
+        //Rounds half away from zero
+        if(_p < _end && *_p >= '5' && *_p <= '9')
+            value++;
+        while(_p < _end && *_p >= '0' && *_p <= '9')
+        {
+            digits++;
+            _p++;
+        }
+    }
+    if(digits == 0)
+        return NULL;
+    _value = negative ? -value : value;
+    return _p;
+}
+
+//Reads a trial file through a memory map
+bool LegacyConverter::ParseTrialFile(const QString &_filename, int _columns, qint64 _period,
+                                     QVector<CursorSample> &_samples, int &_badLines, qint64 &_bytes)
+{
+    _samples.clear();
+    _badLines = 0;
+    QFile file(_filename);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+    _bytes = file.size();
+    if(_bytes == 0)
+        return true;
+    const char *data = (const char*)file.map(0, _bytes);
+    if(data == NULL)
+        return false;
+
+    const char *p = data;
+    const char *end = data + _bytes;
+    qint64 values[5];
+    while(p < end)
+    {
+        const char *lineEnd = (const char*)memchr(p, '\n', end - p);
+        if(lineEnd == NULL)
+            lineEnd = end;
+        const char *q = p;
+        bool ok = true;
+        for(int c=0; c<_columns && ok; c++)
+        {
+            q = ParseNumber(q, lineEnd, values[c]);
+            ok = q != NULL;
+        }
+        if(ok)
+        {
+            while(q < lineEnd && (*q == ' ' || *q == '\t' || *q == '\r'))
+                q++;
+            ok = q == lineEnd;
+        }
+
+        if(ok)
+        {
+            CursorSample sample;
+            if(_columns == 5)
+            {
+                sample.timestamp = values[0];
+                sample.rawX = values[1];
+                sample.rawY = values[2];
+                sample.x = values[3];
+                sample.y = values[4];
+            }
+            else
+            {
+                sample.timestamp = _samples.size() * _period;
+                sample.rawX = sample.x = values[0];
+                sample.rawY = sample.y = values[1];
+            }
+            _samples.push_back(sample);
+        }
+        else
+        {
+            //Blank lines are ignored
+            const char *b = p;
+            while(b < lineEnd && (*b == ' ' || *b == '\t' || *b == '\r'))
+                b++;
+            if(b != lineEnd)
+                _badLines++;
+        }
+        p = lineEnd + 1;
+    }
+    file.unmap((uchar*)data);
+    return true;
+}
+
+//Writes the samples of a trial in blocks
+static void WriteBlocks(SessionFileWriter &_writer, int _session, int _trial, SessionStream _stream,
+                        const QVector<CursorSample> &_samples)
+{
+    int sequence = 0;
+    int i = 0;
+    do
+    {
+        int count = qMin(blockSamples, _samples.size() - i);
+        bool final = i + count >= _samples.size();
+        _writer.WriteSamples(_session, _trial, _stream, 0, _samples.constData() + i, count,
+                             sequence++, final);
+        i += count;
+    }
+    while(i < _samples.size());
+}
+
+//Converts one experiment
+LegacyResult LegacyConverter::Convert(const LegacyExperiment &_experiment, const QString &_output)
+{
+    LegacyResult result;
+    result.ok = false;
+    result.files = 0;
+    result.bytes = 0;
+    result.samples = 0;
+
+    QFile headerFile(_experiment.header);
+    if(!headerFile.open(QIODevice::ReadOnly))
+    {
+        result.error = "could not read " + _experiment.header;
+        return result;
+    }
+    QByteArray headerBytes = headerFile.readAll();
+    headerFile.close();
+    result.files++;
+    result.bytes += headerBytes.size();
+    QString header = QString::fromUtf8(headerBytes);
+
+    //Sampling period of the grid
+    bool ok = false;
+    double frequency = HeaderValue(header, "Sampling frequency (Hz)").toDouble(&ok);
+    if(!ok || frequency <= 0)
+    {
+        frequency = 100;
+        result.warnings << "no sampling frequency in the header, using 100 Hz";
+    }
+    qint64 period = qRound64(1e9 / frequency);
+
+    //Trials expected in each session
+    QVector<int> expected;
+    QStringList counts = HeaderValue(header, "Number of trials").split(';');
+    for(int i=0; i<counts.size(); i++)
+    {
+        int n = counts.at(i).trimmed().toInt(&ok);
+        if(ok)
+            expected.push_back(n);
+    }
+    if(expected.isEmpty())
+        result.warnings << "no number of trials in the header";
+
+    header += "-------------------------------------\n";
+    header += "Converted from the text files of " + QFileInfo(_experiment.prefix).fileName() + "\n";
+    header += "Timestamps of the samples: sample index x sampling period\n";
+    header += "Raw position: not recorded, same as the visual feedback\n";
+
+    SessionFileWriter writer(_output.toStdString());
+    writer.setCompression(true);
+    if(!writer.Open(header))
+    {
+        result.error = "could not create " + _output;
+        return result;
+    }
+
+    QVector<CursorSample> samples;
+    QVector<CursorSample> events;
+    for(int i=0; i<_experiment.trials.size(); i++)
+    {
+        const LegacyTrialFiles &files = _experiment.trials.at(i);
+        QString name = QString::number(files.session) + "_" + QString::number(files.trial);
+        int badLines = 0;
+        qint64 bytes = 0;
+        if(!ParseTrialFile(files.data, 2, period, samples, badLines, bytes))
+        {
+            result.warnings << "trial " + name + ": could not read " + files.data;
+            continue;
+        }
+        result.files++;
+        result.bytes += bytes;
+        if(badLines > 0)
+            result.warnings << "trial " + name + ": " + QString::number(badLines) + " lines are not valid";
+        if(samples.isEmpty())
+            result.warnings << "trial " + name + ": no samples";
+        if(files.session < 1 || files.session > expected.size() ||
+                files.trial < 1 || files.trial > expected.at(files.session-1))
+            result.warnings << "trial " + name + ": not in the protocol of the header";
+
+        events.clear();
+        if(!files.events.isEmpty())
+        {
+            if(ParseTrialFile(files.events, 5, period, events, badLines, bytes))
+            {
+                result.files++;
+                result.bytes += bytes;
+                if(badLines > 0)
+                    result.warnings << "trial " + name + ": " + QString::number(badLines) + " event lines are not valid";
+            }
+            else
+                result.warnings << "trial " + name + ": could not read " + files.events;
+        }
+
+        WriteBlocks(writer, files.session, files.trial, StreamGrid, samples);
+        if(!files.events.isEmpty())
+            WriteBlocks(writer, files.session, files.trial, StreamEvents, events);
+        if(!files.timing.isEmpty())
+        {
+            QFile timing(files.timing);
+            if(timing.open(QIODevice::ReadOnly))
+            {
+                QByteArray text = timing.readAll();
+                result.files++;
+                result.bytes += text.size();
+                writer.WriteText(files.session, files.trial, StreamTiming, 0, QString::fromUtf8(text));
+            }
+        }
+
+        LegacyTrialCount count;
+        count.session = files.session;
+        count.trial = files.trial;
+        count.samples = samples.size();
+        count.events = files.events.isEmpty() ? -1 : events.size();
+        result.trials.push_back(count);
+        result.samples += samples.size();
+    }
+
+    //Trials of the protocol without a file
+    for(int s=0; s<expected.size(); s++)
+    {
+        for(int t=1; t<=expected.at(s); t++)
+        {
+            bool found = false;
+            for(int i=0; i<result.trials.size() && !found; i++)
+                found = result.trials.at(i).session == s+1 && result.trials.at(i).trial == t;
+            if(!found)
+                result.warnings << "trial " + QString::number(s+1) + "_" + QString::number(t) + ": missing";
+        }
+    }
+
+    writer.Close();
+    result.ok = true;
+    return result;
+}
+
+//Checks the session file against the samples that were converted
+bool LegacyConverter::Verify(const QString &_output, LegacyResult &_result)
+{
+    SessionFileReader reader(_output.toStdString());
+    if(!reader.Open() || !reader.complete())
+    {
+        _result.ok = false;
+        _result.error = "could not read back " + _output;
+        return false;
+    }
+    QVector<CursorSample> samples;
+    for(int i=0; i<_result.trials.size(); i++)
+    {
+        const LegacyTrialCount &count = _result.trials.at(i);
+        bool ok = reader.Samples(count.session, count.trial, StreamGrid, samples) == count.samples;
+        if(count.events >= 0)
+            ok = ok && reader.Samples(count.session, count.trial, StreamEvents, samples) == count.events;
+        if(!ok)
+        {
+            _result.ok = false;
+            _result.error = "trial " + QString::number(count.session) + "_" + QString::number(count.trial) +
+                    ": the session file does not have the samples of the text files";
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Converts the text files of the previous versions into session
+ * files (see sessionformat.h). An experiment is a <prefix>_header.txt and
+ * its trial files <prefix>_data_S_T.txt (visual feedback X and Y of each
+ * sample), and, when they exist, <prefix>_events_S_T.txt and
+ * <prefix>_timing_S_T.txt.
+ * The text files have no timestamps: the samples of the grid get the time
+ * of their index times the sampling period given in the header, and the
+ * raw position (not recorded) is set to the visual feedback.
+ * Numbers are read with a parser that does not depend on the locale.
+ * Convert() has no shared state, so experiments can be converted in
+ * parallel.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef LEGACYCONVERTER_H
+#define LEGACYCONVERTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "samplebuffer.h" //CursorSample
+
+//Text files of one trial
+struct LegacyTrialFiles
+{
+    int session;
+    int trial;
+    QString data;
+    QString events; //Empty if there is no events file
+    QString timing; //Empty if there is no timing file
+};
+
+//Text files of one experiment
+struct LegacyExperiment
+{
+    QString prefix; //Path of the files without "_header.txt"
+    QString header;
+    QVector<LegacyTrialFiles> trials; //Sorted by session and trial
+};
+
+//Samples converted for one trial, checked against the session file
+struct LegacyTrialCount
+{
+    int session;
+    int trial;
+    int samples;
+    int events;
+};
+
+//Outcome of the conversion of one experiment
+struct LegacyResult
+{
+    bool ok;
+    int files; //Text files read
+    qint64 bytes; //Bytes read
+    qint64 samples;
+    QVector<LegacyTrialCount> trials;
+    QStringList warnings;
+    QString error;
+};
+
+class LegacyConverter
+{
+public:
+    //Methods
+    //Finds every experiment under _root (recursively)
+    static QVector<LegacyExperiment> Scan(const QString &_root);
+    //Converts an experiment into the session file _output
+    static LegacyResult Convert(const LegacyExperiment &_experiment, const QString &_output);
+    //Reads the session file back and checks the number of samples of
+    //every trial. Must be called after the session file was written
+    //(DataFileController::WaitForWrites())
+    static bool Verify(const QString &_output, LegacyResult &_result);
+    //Reads a trial file of _columns numbers per line
+    //Data files (2 columns): X, Y; event files (5 columns): time (ns), raw X,
+    //raw Y, X, Y. Returns false if the file cannot be read; lines that are
+    //not valid are counted in _badLines
+    static bool ParseTrialFile(const QString &_filename, int _columns, qint64 _period,
+                               QVector<CursorSample> &_samples, int &_badLines, qint64 &_bytes);
+    //Reads a number at _p: optional sign, digits, optional decimal point
+    //Decimals are rounded. Returns the position after the number, or NULL
+    static const char* ParseNumber(const char *_p, const char *_end, qint64 &_value);
+};
+
+#endif // LEGACYCONVERTER_H
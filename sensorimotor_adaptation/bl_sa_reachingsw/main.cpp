@@ -1,11 +1,40 @@
 #include "mainwindow.h"
+#include "asyncwriter.h"
+#include "protocolcompiler.h"
 #include <QApplication>
+#include <QMessageBox>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+    //Protocol of the experiment: bl_sa_reachingsw [protocol file]
+    //Without a file the defaults of ProtocolDefinition are used
+    //The file is checked before anything is shown
+    ProtocolDefinition protocol;
+    if(a.arguments().size() > 1)
+    {
+        QString error;
+        if(!ProtocolCompiler::Load(a.arguments().at(1), protocol, error))
+        {
+            QMessageBox::critical(0, "Protocol", error);
+            return 1;
+        }
+    }
+    MainWindow w(0, protocol);
     w.show();
 
-    return a.exec();
+    int ret = a.exec();
+    //Closes the task windows that are still open: each one stops its
+    //acquisition thread and closes its session file
+    QWidgetList windows = QApplication::topLevelWidgets();
+    for(int i=0; i<windows.size(); i++)
+    {
+        if(windows.at(i) != &w && windows.at(i)->testAttribute(Qt::WA_DeleteOnClose))
+            windows.at(i)->close();
+    }
+    //Deletes the windows closed so far (their deletion was deferred)
+    QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+    //Writes every file that is still queued before leaving
+    AsyncWriter::Shutdown();
+    return ret;
 }
@@ -5,9 +5,10 @@
 
 #include "reachingwindow.h"
 
-MainWindow::MainWindow(QWidget *parent) :
+MainWindow::MainWindow(QWidget *parent, const ProtocolDefinition &_protocol) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    protocol(_protocol)
 {
     ui->setupUi(this);
 }
@@ -19,7 +20,9 @@ MainWindow::~MainWindow()
 
 void MainWindow::on_actionReaching_triggered()
 {
-    ReachingWindow *rw = new ReachingWindow();    
+    ReachingWindow *rw = new ReachingWindow(0, this->protocol);
+    //Deleted when closed, which stops the acquisition and closes the files
+    rw->setAttribute(Qt::WA_DeleteOnClose);
     rw->show();
 
     //QScreen *screen = QGuiApplication::screens()[1]; // specify which screen to use;
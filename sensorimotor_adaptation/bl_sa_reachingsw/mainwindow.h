@@ -15,6 +15,7 @@
 
 #include <QMainWindow>
 #include <QTimer>
+#include "protocolcompiler.h" //Protocol of the experiment
 
 namespace Ui {
 class MainWindow;
@@ -25,7 +26,7 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = 0);        
+    explicit MainWindow(QWidget *parent = 0, const ProtocolDefinition &_protocol = ProtocolDefinition());
     ~MainWindow();
 
 private slots:
@@ -33,6 +34,7 @@ private slots:
 
 private:
     Ui::MainWindow *ui;
+    ProtocolDefinition protocol;
 };
 
 #endif // MAINWINDOW_H
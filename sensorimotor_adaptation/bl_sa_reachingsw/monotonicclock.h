@@ -0,0 +1,32 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Monotonic time base shared by every timestamp in the software.
+ * On Linux this is CLOCK_MONOTONIC, the same clock used by evdev and
+ * clock_nanosleep, so timestamps from different sources can be compared.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef MONOTONICCLOCK_H
+#define MONOTONICCLOCK_H
+
+#include <chrono>
+#include <QtGlobal>
+
+class MonotonicClock
+{
+public:
+    //Returns the current monotonic time in nanoseconds
+    static qint64 Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+#endif // MONOTONICCLOCK_H
@@ -0,0 +1,87 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "movementenddetector.h"
+
+#include <cmath>
+
+//Default constructor
+MovementEndDetector::MovementEndDetector(int _windowSamples, qint64 _period)
+{
+    this->m_speedThreshold = 4;
+    this->originX = 0;
+    this->originY = 0;
+    this->m_originDistance = 0;
+    this->setWindow(_windowSamples, _period);
+}
+
+void MovementEndDetector::setWindow(int _windowSamples, qint64 _period)
+{
+    this->m_window = qMax(2, _windowSamples);
+    this->period = _period;
+    this->vSteps.resize(this->m_window);
+    this->vInside.resize(this->m_window);
+    this->setSpeedThreshold(this->m_speedThreshold);
+    this->Reset();
+}
+
+void MovementEndDetector::setSpeedThreshold(double _speed)
+{
+    this->m_speedThreshold = _speed;
+    //The window spans one period less than its number of samples
+    this->maxPath = qRound64(_speed * (this->m_window - 1) * this->period / 1e9 * 1024);
+}
+
+void MovementEndDetector::Reset()
+{
+    this->head = 0;
+    this->count = 0;
+    this->path = 0;
+    this->inside = 0;
+}
+
+//The oldest step of the ring leads to a sample that has already left the
+//window, so it is not part of the path
+qint64 MovementEndDetector::windowPath() const
+{
+    if(this->count < this->m_window)
+        return this->path;
+    return this->path - this->vSteps.at(this->head);
+}
+
+bool MovementEndDetector::Push(const CursorSample &_sample)
+{
+    qint32 step = 0;
+    if(this->count > 0)
+    {
+        double dx = _sample.x - this->previous.x;
+        double dy = _sample.y - this->previous.y;
+        step = qRound(sqrt(dx*dx + dy*dy) * 1024);
+    }
+    this->previous = _sample;
+    double ox = _sample.rawX - this->originX;
+    double oy = _sample.rawY - this->originY;
+    bool closeToOrigin = (ox*ox + oy*oy) <= this->m_originDistance * this->m_originDistance;
+
+    //Replaces the oldest sample of the window
+    if(this->count == this->m_window)
+    {
+        this->path -= this->vSteps.at(this->head);
+        if(this->vInside.at(this->head))
+            this->inside--;
+    }
+    else
+        this->count++;
+    this->vSteps[this->head] = step;
+    this->vInside[this->head] = closeToOrigin;
+    this->path += step;
+    if(closeToOrigin)
+        this->inside++;
+    this->head = (this->head + 1) % this->m_window;
+
+    return this->count == this->m_window && this->inside == 0 && this->windowPath() <= this->maxPath;
+}
@@ -0,0 +1,97 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Detects the end of a movement on the samples of the uniform
+ * grid, one sample at a time. The movement has ended when, over the last
+ * window of samples (the dwell time), the mean speed of the visual feedback
+ * is below a threshold and the cursor has stayed away from the origin.
+ * The speed is the length of the path inside the window, so moving back
+ * and forth is not taken as stationary. The path and the number of samples
+ * inside the origin are running sums over a ring of the window, so each
+ * sample costs O(1) and the end is found at the first sample that
+ * completes a stationary window.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef MOVEMENTENDDETECTOR_H
+#define MOVEMENTENDDETECTOR_H
+
+#include <QtGlobal>
+#include <QVector>
+#include "samplebuffer.h" //CursorSample
+
+class MovementEndDetector
+{
+public:
+    //Constructor
+    //_windowSamples: samples of the dwell time
+    //_period: interval of the grid (ns)
+    MovementEndDetector(int _windowSamples = 50, qint64 _period = 10000000);
+
+    //Methods
+    //Starts a new movement
+    void Reset();
+    //Adds a grid sample, returns true if the movement has ended at it
+    bool Push(const CursorSample &_sample);
+
+    //Getters and setters
+    //Sets the dwell time, in samples (allocates the window)
+    void setWindow(int _windowSamples, qint64 _period);
+    int window() const
+    {
+        return m_window;
+    }
+    //Largest mean speed of the visual feedback that is stationary (pixels/s)
+    void setSpeedThreshold(double _speed);
+    double speedThreshold() const
+    {
+        return m_speedThreshold;
+    }
+    //Raw cursor positions closer than _distance to the origin do not count
+    //as the end of the movement
+    void setOrigin(double _x, double _y, double _distance)
+    {
+        originX = _x;
+        originY = _y;
+        m_originDistance = _distance;
+    }
+    double originDistance() const
+    {
+        return m_originDistance;
+    }
+    //Length of the path in the current window (pixels)
+    double pathLength() const
+    {
+        return windowPath() / 1024.0;
+    }
+
+private:
+    //Fields
+    int m_window;
+    qint64 period;
+    double m_speedThreshold;
+    //Path allowed in a window (1/1024 pixel)
+    qint64 maxPath;
+    double originX;
+    double originY;
+    double m_originDistance;
+    //Ring of the window: step from the previous sample (1/1024 pixel, so
+    //the running sum is exact) and whether the sample is close to the origin
+    QVector<qint32> vSteps;
+    QVector<bool> vInside;
+    int head;
+    int count;
+    qint64 path;
+    int inside;
+    CursorSample previous;
+
+    //Methods
+    qint64 windowPath() const;
+};
+
+#endif // MOVEMENTENDDETECTOR_H
@@ -0,0 +1,438 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "ofcsubject.h"
+
+#include <QtMath>
+#include <cmath>
+
+//Small dense matrices of the controller (at most 5x5)
+struct OfcMatrix
+{
+    int rows, cols;
+    double v[5][5];
+
+    OfcMatrix(int _rows, int _cols) : rows(_rows), cols(_cols)
+    {
+        for(int i=0; i<5; i++)
+            for(int j=0; j<5; j++)
+                this->v[i][j] = 0;
+    }
+};
+
+static OfcMatrix operator*(const OfcMatrix &a, const OfcMatrix &b)
+{
+    OfcMatrix r(a.rows, b.cols);
+    for(int i=0; i<a.rows; i++)
+        for(int k=0; k<a.cols; k++)
+            for(int j=0; j<b.cols; j++)
+                r.v[i][j] += a.v[i][k] * b.v[k][j];
+    return r;
+}
+
+static OfcMatrix operator+(const OfcMatrix &a, const OfcMatrix &b)
+{
+    OfcMatrix r(a.rows, a.cols);
+    for(int i=0; i<a.rows; i++)
+        for(int j=0; j<a.cols; j++)
+            r.v[i][j] = a.v[i][j] + b.v[i][j];
+    return r;
+}
+
+static OfcMatrix operator-(const OfcMatrix &a, const OfcMatrix &b)
+{
+    OfcMatrix r(a.rows, a.cols);
+    for(int i=0; i<a.rows; i++)
+        for(int j=0; j<a.cols; j++)
+            r.v[i][j] = a.v[i][j] - b.v[i][j];
+    return r;
+}
+
+static OfcMatrix operator*(double s, const OfcMatrix &a)
+{
+    OfcMatrix r(a.rows, a.cols);
+    for(int i=0; i<a.rows; i++)
+        for(int j=0; j<a.cols; j++)
+            r.v[i][j] = s * a.v[i][j];
+    return r;
+}
+
+static OfcMatrix Transpose(const OfcMatrix &a)
+{
+    OfcMatrix r(a.cols, a.rows);
+    for(int i=0; i<a.rows; i++)
+        for(int j=0; j<a.cols; j++)
+            r.v[j][i] = a.v[i][j];
+    return r;
+}
+
+static double Trace(const OfcMatrix &a)
+{
+    double t = 0;
+    for(int i=0; i<a.rows; i++)
+        t += a.v[i][i];
+    return t;
+}
+
+//Gauss-Jordan with partial pivoting
+static OfcMatrix Inverse(const OfcMatrix &a)
+{
+    int n = a.rows;
+    OfcMatrix m = a;
+    OfcMatrix r(n, n);
+    for(int i=0; i<n; i++)
+        r.v[i][i] = 1;
+    for(int c=0; c<n; c++)
+    {
+        int pivot = c;
+        for(int i=c+1; i<n; i++)
+            if(fabs(m.v[i][c]) > fabs(m.v[pivot][c]))
+                pivot = i;
+        for(int j=0; j<n; j++)
+        {
+            std::swap(m.v[c][j], m.v[pivot][j]);
+            std::swap(r.v[c][j], r.v[pivot][j]);
+        }
+        double d = m.v[c][c];
+        for(int j=0; j<n; j++)
+        {
+            m.v[c][j] /= d;
+            r.v[c][j] /= d;
+        }
+        for(int i=0; i<n; i++)
+        {
+            if(i == c)
+                continue;
+            double f = m.v[i][c];
+            for(int j=0; j<n; j++)
+            {
+                m.v[i][j] -= f * m.v[c][j];
+                r.v[i][j] -= f * r.v[c][j];
+            }
+        }
+    }
+    return r;
+}
+
+//Parameters of modeling_simulation/ofc_todorov_2005.sce
+OfcParameters::OfcParameters()
+{
+    this->dt = 0.001;
+    this->movementTime = 0.4;
+    this->distance = 320;
+    //0.2 m, the target of the script
+    this->pixelsPerMeter = 1600;
+    this->mass = 1;
+    this->tau1 = 0.04;
+    this->tau2 = 0.04;
+    this->velocityWeight = 0.2;
+    this->forceWeight = 0.02;
+    this->effort = 0.00001;
+    this->controlNoise = 0.5;
+    //0.5 * diag([0.02, 0.2, 1])
+    this->positionNoise = 0.01;
+    this->velocityNoise = 0.1;
+    this->forceNoise = 0.5;
+    //Single-state model of analysis/script_models.m
+    this->retention = 0.99;
+    this->learningRate = 0.1;
+    this->seed = 1;
+}
+
+OfcSubject::OfcSubject(const OfcParameters &_parameters)
+{
+    this->parameters = _parameters;
+    this->state = _parameters.seed;
+    this->steps = qMax(1, qRound(_parameters.movementTime / _parameters.dt));
+    this->step = this->steps;
+
+    //Point mass with second-order muscle
+    double dt = _parameters.dt;
+    for(int i=0; i<5; i++)
+    {
+        this->B[i] = 0;
+        for(int j=0; j<5; j++)
+            this->A[i][j] = i == j ? 1 : 0;
+    }
+    this->A[0][1] = dt;
+    this->A[1][2] = dt / _parameters.mass;
+    this->A[2][2] = 1 - dt / _parameters.tau2;
+    this->A[2][3] = dt / _parameters.tau2;
+    this->A[3][3] = 1 - dt / _parameters.tau1;
+    this->B[3] = dt / _parameters.tau1;
+
+    //Both axes use the gains of the movement: with the noise of the script
+    //the estimator of an axis without movement would never correct its
+    //estimate (no control, so no signal-dependent noise)
+    this->m_iterations = this->ComputeGains(_parameters.distance / _parameters.pixelsPerMeter, this->gains);
+
+    this->startX = 0;
+    this->startY = 0;
+    this->ux = 1;
+    this->uy = 0;
+    this->targetAngle = 0;
+    this->targetDistance = 0;
+    this->errorMeasured = true;
+    this->m_initialError = 0;
+    this->m_aim = 0;
+    this->Place(0, 0);
+}
+
+//Port of todorovOFC(): alternates the Kalman filter (forward) and the
+//controller (backward) until the expected cost stops changing
+//Without state-dependent noise and with C0 = E0 = SX0 = 0
+int OfcSubject::ComputeGains(double _amplitude, Gains &_gains)
+{
+    const int maxIterations = 500;
+    const double minError = 1e-15;
+    int n = this->steps;
+
+    OfcMatrix A(5, 5), B(5, 1), H(3, 5), D0(3, 3), X0(5, 1), Q(5, 5), F(3, 5);
+    for(int i=0; i<5; i++)
+    {
+        B.v[i][0] = this->B[i];
+        for(int j=0; j<5; j++)
+            A.v[i][j] = this->A[i][j];
+    }
+    for(int i=0; i<3; i++)
+        H.v[i][i] = 1;
+    D0.v[0][0] = this->parameters.positionNoise;
+    D0.v[1][1] = this->parameters.velocityNoise;
+    D0.v[2][2] = this->parameters.forceNoise;
+    X0.v[4][0] = _amplitude;
+    //Final cost: position error, velocity and force
+    F.v[0][0] = 1;
+    F.v[0][4] = -1;
+    F.v[1][1] = this->parameters.velocityWeight;
+    F.v[2][2] = this->parameters.forceWeight;
+    Q = Transpose(F) * F;
+    double R = this->parameters.effort / n;
+    double C = this->parameters.controlNoise;
+    OfcMatrix DD = D0 * Transpose(D0);
+
+    QVector<OfcMatrix> vL(n, OfcMatrix(1, 5));
+    QVector<OfcMatrix> vK(n, OfcMatrix(5, 3));
+    double previousCost = 0;
+    int it;
+    for(it=1; it<=maxIterations; it++)
+    {
+        //Estimator
+        OfcMatrix Ske(5, 5);
+        OfcMatrix Skx = X0 * Transpose(X0);
+        OfcMatrix Skxe(5, 5);
+        for(int k=0; k<n; k++)
+        {
+            const OfcMatrix &L = vL.at(k);
+            vK[k] = A * Ske * Transpose(H) * Inverse(H * Ske * Transpose(H) + DD);
+            const OfcMatrix &K = vK.at(k);
+            OfcMatrix ABL = A - B * L;
+            OfcMatrix AKH = A - K * H;
+            OfcMatrix BC = C * B;
+            OfcMatrix newE = AKH * Ske * Transpose(A) + BC * L * Skx * Transpose(L) * Transpose(BC);
+            Skx = K * H * Ske * Transpose(A) + ABL * Skx * Transpose(ABL)
+                    + ABL * Skxe * Transpose(H) * Transpose(K) + K * H * Transpose(Skxe) * Transpose(ABL);
+            Ske = newE;
+            Skxe = ABL * Skxe * Transpose(AKH);
+        }
+
+        //Controller
+        OfcMatrix Sx = Q;
+        OfcMatrix Se(5, 5);
+        double cost = 0;
+        for(int k=n-1; k>=0; k--)
+        {
+            const OfcMatrix &K = vK.at(k);
+            cost += Trace(Se * K * DD * Transpose(K));
+            double temp = R + (Transpose(B) * Sx * B).v[0][0] + C * C * (Transpose(B) * (Sx + Se) * B).v[0][0];
+            vL[k] = (1.0 / temp) * (Transpose(B) * Sx * A);
+            const OfcMatrix &L = vL.at(k);
+            OfcMatrix AKH = A - K * H;
+            OfcMatrix newE = Transpose(A) * Sx * B * L + Transpose(AKH) * Se * AKH;
+            Sx = Transpose(A) * Sx * (A - B * L);
+            Se = newE;
+        }
+        cost += (Transpose(X0) * Sx * X0).v[0][0];
+
+        //The script compares Cost(it) with itself, so it never stops early
+        if(it > 1 && fabs(cost - previousCost) < minError)
+            break;
+        previousCost = cost;
+    }
+
+    _gains.vL.resize(n * 5);
+    _gains.vK.resize(n * 15);
+    for(int k=0; k<n; k++)
+    {
+        for(int j=0; j<5; j++)
+        {
+            _gains.vL[k * 5 + j] = vL.at(k).v[0][j];
+            for(int i=0; i<3; i++)
+                _gains.vK[k * 15 + j * 3 + i] = vK.at(k).v[j][i];
+        }
+    }
+    return qMin(it, maxIterations);
+}
+
+void OfcSubject::Place(double _x, double _y)
+{
+    this->m_handX = _x;
+    this->m_handY = _y;
+    this->startX = _x;
+    this->startY = _y;
+    for(int a=0; a<2; a++)
+    {
+        for(int i=0; i<5; i++)
+        {
+            this->axis[a].x[i] = 0;
+            this->axis[a].xhat[i] = 0;
+        }
+    }
+    this->step = this->steps;
+}
+
+void OfcSubject::StartMovement(double _targetX, double _targetY, bool _adapt)
+{
+    double dx = _targetX - this->m_handX;
+    double dy = _targetY - this->m_handY;
+    this->targetAngle = atan2(dy, dx);
+    this->targetDistance = sqrt(dx * dx + dy * dy);
+    this->errorMeasured = !_adapt;
+    this->m_initialError = 0;
+
+    //Aims at the target rotated by -aim
+    double angle = this->targetAngle;
+    if(_adapt)
+        angle -= this->m_aim * M_PI / 180.0;
+    double nx = cos(angle);
+    double ny = sin(angle);
+
+    //The state of the previous movement is carried to the new axes: the
+    //hand may still be moving and its estimate keeps its error
+    double scale = 1.0 / this->parameters.pixelsPerMeter;
+    double estimateX = (this->startX - this->m_handX) * scale
+            + this->axis[0].xhat[0] * this->ux - this->axis[1].xhat[0] * this->uy;
+    double estimateY = (this->startY - this->m_handY) * scale
+            + this->axis[0].xhat[0] * this->uy + this->axis[1].xhat[0] * this->ux;
+    for(int i=1; i<4; i++)
+    {
+        double wx = this->axis[0].x[i] * this->ux - this->axis[1].x[i] * this->uy;
+        double wy = this->axis[0].x[i] * this->uy + this->axis[1].x[i] * this->ux;
+        double ex = this->axis[0].xhat[i] * this->ux - this->axis[1].xhat[i] * this->uy;
+        double ey = this->axis[0].xhat[i] * this->uy + this->axis[1].xhat[i] * this->ux;
+        this->axis[0].x[i] = wx * nx + wy * ny;
+        this->axis[1].x[i] = -wx * ny + wy * nx;
+        this->axis[0].xhat[i] = ex * nx + ey * ny;
+        this->axis[1].xhat[i] = -ex * ny + ey * nx;
+    }
+    this->axis[0].x[0] = 0;
+    this->axis[1].x[0] = 0;
+    this->axis[0].xhat[0] = estimateX * nx + estimateY * ny;
+    this->axis[1].xhat[0] = -estimateX * ny + estimateY * nx;
+    this->axis[0].x[4] = this->axis[0].xhat[4] = this->targetDistance * scale;
+    this->axis[1].x[4] = this->axis[1].xhat[4] = 0;
+
+    this->startX = this->m_handX;
+    this->startY = this->m_handY;
+    this->ux = nx;
+    this->uy = ny;
+    this->step = 0;
+}
+
+void OfcSubject::Step(double _observedX, double _observedY, double &_handX, double &_handY)
+{
+    //After the movement the hand is held where it has stopped
+    if(this->step >= this->steps)
+    {
+        for(int a=0; a<2; a++)
+        {
+            for(int i=1; i<4; i++)
+                this->axis[a].x[i] = this->axis[a].xhat[i] = 0;
+        }
+        _handX = this->m_handX;
+        _handY = this->m_handY;
+        return;
+    }
+    int k = this->step;
+    double scale = 1.0 / this->parameters.pixelsPerMeter;
+    double ox = (_observedX - this->startX) * scale;
+    double oy = (_observedY - this->startY) * scale;
+    this->StepAxis(this->axis[0], k, ox * this->ux + oy * this->uy);
+    this->StepAxis(this->axis[1], k, -ox * this->uy + oy * this->ux);
+    this->step++;
+
+    //Initial direction of the observed movement
+    if(!this->errorMeasured)
+    {
+        double px = _observedX - this->startX;
+        double py = _observedY - this->startY;
+        if(sqrt(px * px + py * py) >= this->targetDistance / 3.0)
+        {
+            double error = atan2(py, px) - this->targetAngle;
+            this->m_initialError = atan2(sin(error), cos(error)) * 180.0 / M_PI;
+            this->errorMeasured = true;
+        }
+    }
+
+    double p = this->axis[0].x[0];
+    double q = this->axis[1].x[0];
+    this->m_handX = this->startX + (p * this->ux - q * this->uy) * this->parameters.pixelsPerMeter;
+    this->m_handY = this->startY + (p * this->uy + q * this->ux) * this->parameters.pixelsPerMeter;
+    _handX = this->m_handX;
+    _handY = this->m_handY;
+}
+
+//One step of runSimulationOFC() for one axis
+void OfcSubject::StepAxis(Axis &_axis, int _k, double _observed)
+{
+    const double *L = this->gains.vL.constData() + _k * 5;
+    const double *K = this->gains.vK.constData() + _k * 15;
+
+    double u = 0;
+    for(int i=0; i<5; i++)
+        u -= L[i] * _axis.xhat[i];
+    double un = u + this->parameters.controlNoise * u * this->Gaussian();
+
+    //Innovation: seen position, sensed velocity and force
+    double innovation[3];
+    innovation[0] = _observed + this->parameters.positionNoise * this->Gaussian() - _axis.xhat[0];
+    innovation[1] = _axis.x[1] + this->parameters.velocityNoise * this->Gaussian() - _axis.xhat[1];
+    innovation[2] = _axis.x[2] + this->parameters.forceNoise * this->Gaussian() - _axis.xhat[2];
+
+    double x[5], xhat[5];
+    for(int i=0; i<5; i++)
+    {
+        x[i] = this->B[i] * un;
+        xhat[i] = this->B[i] * u;
+        for(int j=0; j<5; j++)
+        {
+            x[i] += this->A[i][j] * _axis.x[j];
+            xhat[i] += this->A[i][j] * _axis.xhat[j];
+        }
+        for(int j=0; j<3; j++)
+            xhat[i] += K[i * 3 + j] * innovation[j];
+    }
+    for(int i=0; i<5; i++)
+    {
+        _axis.x[i] = x[i];
+        _axis.xhat[i] = xhat[i];
+    }
+}
+
+void OfcSubject::Adapt(double _errorDegrees)
+{
+    this->m_aim = this->parameters.retention * this->m_aim + this->parameters.learningRate * _errorDegrees;
+}
+
+//64-bit LCG (Knuth) and Box-Muller transform
+double OfcSubject::Gaussian()
+{
+    this->state = this->state * 6364136223846793005ULL + 1442695040888963407ULL;
+    double u1 = 1.0 - (this->state >> 11) / 9007199254740992.0;
+    this->state = this->state * 6364136223846793005ULL + 1442695040888963407ULL;
+    double u2 = (this->state >> 11) / 9007199254740992.0;
+    return sqrt(-2.0 * log(u1)) * cos(2 * M_PI * u2);
+}
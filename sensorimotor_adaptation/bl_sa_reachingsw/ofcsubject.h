@@ -0,0 +1,149 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Synthetic subject for the task. The hand is the point mass of
+ * Todorov (2005), "Stochastic optimal control and estimation methods adapted
+ * to the noise characteristics of the sensorimotor system", moved by the
+ * optimal feedback controller and the optimal estimator of
+ * modeling_simulation/ofc_todorov_2005.sce (signal-dependent control noise,
+ * noisy observations of position, velocity and force).
+ * Each movement is controlled along two axes: towards the aim point and
+ * perpendicular to it, with the same gains, computed once by the
+ * constructor for movements of the given distance and duration. After the
+ * movement time the hand is held where it has stopped. The position observed by
+ * the estimator is the visual feedback (the cursor), so a perturbation of
+ * the feedback is corrected during the movement as the subject sees it;
+ * velocity and force are sensed from the hand.
+ * Between movements the aim is adapted with the single-state model of
+ * analysis/script_models.m: aim(n+1) = retention*aim(n) + rate*error(n).
+ * Positions are in pixels outside the class and in meters inside it.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef OFCSUBJECT_H
+#define OFCSUBJECT_H
+
+#include <QtGlobal>
+#include <QVector>
+
+struct OfcParameters
+{
+    OfcParameters();
+
+    double dt; //Time step (s), one input event per step
+    double movementTime; //Duration of the movements (s)
+    double distance; //Distance of the movements (pixels)
+    double pixelsPerMeter;
+    double mass; //kg
+    double tau1; //Time constants of the muscle (s)
+    double tau2;
+    double velocityWeight; //Final cost of velocity and force
+    double forceWeight;
+    double effort; //Cost of the control
+    double controlNoise; //Signal-dependent noise (fraction of the control)
+    double positionNoise; //Observation noise
+    double velocityNoise;
+    double forceNoise;
+    double retention; //Single-state model of adaptation
+    double learningRate;
+    quint64 seed;
+};
+
+class OfcSubject
+{
+public:
+    //Constructor: computes the controller and the estimator
+    OfcSubject(const OfcParameters &_parameters = OfcParameters());
+
+    //Methods
+    //Starts a movement from the hand position to the target; the hand aims
+    //at the target rotated by -aim() around the start
+    //_adapt: the aim is used (reaches); returns to the origin go straight
+    void StartMovement(double _targetX, double _targetY, bool _adapt);
+    //One time step: _observedX/Y is the position the subject sees (the
+    //visual feedback, or the hand itself when there is no feedback)
+    //Returns the new position of the hand
+    void Step(double _observedX, double _observedY, double &_handX, double &_handY);
+    //End of a reach: updates the aim with the error of the reach (degrees),
+    //usually initialError(), or 0 when the feedback was not shown
+    void Adapt(double _errorDegrees);
+    //Sets the hand (and its estimate) at rest at a position
+    void Place(double _x, double _y);
+
+    //Getters
+    double handX() const
+    {
+        return m_handX;
+    }
+    double handY() const
+    {
+        return m_handY;
+    }
+    //Compensation of the perturbation learned so far (degrees)
+    double aim() const
+    {
+        return m_aim;
+    }
+    //Angle from the target to the observed position when it has covered a
+    //third of the distance, as seen from the start of the movement (degrees)
+    double initialError() const
+    {
+        return m_initialError;
+    }
+    //The movement has reached its final time
+    bool movementEnded() const
+    {
+        return step >= steps;
+    }
+    //Iterations until the controller and the estimator converged
+    int iterations() const
+    {
+        return m_iterations;
+    }
+
+private:
+    //Gains of the movement for each time step
+    //L: 1x5 (control), K: 5x3 (estimator)
+    struct Gains
+    {
+        QVector<double> vL;
+        QVector<double> vK;
+    };
+    //State of each axis (relative to the start): position, velocity, force, muscle activation, target
+    struct Axis
+    {
+        double x[5];
+        double xhat[5];
+    };
+
+    //Fields
+    OfcParameters parameters;
+    double A[5][5];
+    double B[5];
+    Gains gains;
+    Axis axis[2];
+    int steps;
+    int step;
+    double startX, startY; //pixels
+    double ux, uy; //Direction of the movement
+    double targetAngle; //Direction of the target (radians)
+    double targetDistance; //pixels
+    bool errorMeasured;
+    double m_initialError;
+    double m_handX, m_handY;
+    double m_aim;
+    int m_iterations;
+    quint64 state; //Random numbers
+
+    //Methods
+    int ComputeGains(double _amplitude, Gains &_gains);
+    void StepAxis(Axis &_axis, int _k, double _observed);
+    double Gaussian();
+};
+
+#endif // OFCSUBJECT_H
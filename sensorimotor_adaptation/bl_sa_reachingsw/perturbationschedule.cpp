@@ -0,0 +1,182 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "perturbationschedule.h"
+
+#include <cmath>
+
+PerturbationSchedule::PerturbationSchedule()
+{
+    this->stepPeriod = 1;
+    this->seed = 1;
+    this->state = 1;
+    this->unperturbed.degrees = 0;
+    this->unperturbed.perturbed = false;
+    this->unperturbed.catchTrial = false;
+    this->unperturbed.onset = 0;
+    this->unperturbed.firstMatrix = 0;
+    this->unperturbed.matrixCount = 1;
+    //Identity: used by the unperturbed trials
+    this->vMatrices.push_back(LinearStage());
+}
+
+PerturbationSchedule::Block PerturbationSchedule::MakeBlock(BlockType _type, int _trials, double _startDegrees)
+{
+    Block block;
+    block.type = _type;
+    block.trials = _trials;
+    block.startDegrees = _startDegrees;
+    block.endDegrees = _startDegrees;
+    block.walkStep = 0;
+    block.walkLimit = 0;
+    block.catchFraction = 0;
+    block.onset = 0;
+    block.onsetRamp = 0;
+    return block;
+}
+
+PerturbationSchedule::Block PerturbationSchedule::Washout(int _trials)
+{
+    return MakeBlock(NoPerturbation, _trials, 0);
+}
+
+PerturbationSchedule::Block PerturbationSchedule::ConstantBlock(int _trials, double _degrees)
+{
+    return MakeBlock(Constant, _trials, _degrees);
+}
+
+PerturbationSchedule::Block PerturbationSchedule::RampBlock(int _trials, double _startDegrees, double _endDegrees)
+{
+    Block block = MakeBlock(Ramp, _trials, _startDegrees);
+    block.endDegrees = _endDegrees;
+    return block;
+}
+
+PerturbationSchedule::Block PerturbationSchedule::RandomWalkBlock(int _trials, double _startDegrees, double _step, double _limit)
+{
+    Block block = MakeBlock(RandomWalk, _trials, _startDegrees);
+    block.walkStep = _step;
+    block.walkLimit = _limit;
+    return block;
+}
+
+void PerturbationSchedule::Clear()
+{
+    this->vBlocks.clear();
+    this->vTrials.clear();
+    this->vMatrices.resize(1);
+}
+
+void PerturbationSchedule::Add(const Block &_block)
+{
+    this->vBlocks.push_back(_block);
+}
+
+//Expands every block into its trials, then every perturbed trial into the
+//matrices of its onset ramp (the last one is the full angle)
+void PerturbationSchedule::Expand(const LinearStage &_base, qint64 _stepPeriod, quint32 _seed)
+{
+    this->vTrials.clear();
+    this->vMatrices.resize(1);
+    this->stepPeriod = _stepPeriod > 0 ? _stepPeriod : 1;
+    this->seed = _seed;
+    this->state = _seed;
+
+    for(int b=0; b<this->vBlocks.size(); b++)
+    {
+        const Block &block = this->vBlocks.at(b);
+        double walk = block.startDegrees;
+        int rampSteps = (int)(block.onsetRamp * 1000000LL / this->stepPeriod);
+        for(int i=0; i<block.trials; i++)
+        {
+            Trial trial;
+            switch(block.type)
+            {
+            case Constant:
+                trial.degrees = block.startDegrees;
+                break;
+            case Ramp:
+                trial.degrees = block.trials > 1 ?
+                            block.startDegrees + (block.endDegrees - block.startDegrees) * i / (block.trials - 1) :
+                            block.endDegrees;
+                break;
+            case RandomWalk:
+                if(i > 0)
+                    walk += block.walkStep * this->Gaussian();
+                if(block.walkLimit > 0)
+                    walk = qBound(-block.walkLimit, walk, block.walkLimit);
+                trial.degrees = walk;
+                break;
+            default:
+                trial.degrees = 0;
+                break;
+            }
+            //The generator is used by every trial, so the catch trials do not
+            //change the angles of the random walk
+            trial.catchTrial = this->Uniform() < block.catchFraction;
+            trial.perturbed = block.type != NoPerturbation && !trial.catchTrial;
+            trial.onset = block.onset * 1000000LL;
+
+            if(!trial.perturbed)
+            {
+                trial.firstMatrix = 0;
+                trial.matrixCount = 1;
+            }
+            else
+            {
+                trial.firstMatrix = this->vMatrices.size();
+                trial.matrixCount = rampSteps + 1;
+                for(int k=1; k<=rampSteps; k++)
+                    this->vMatrices.push_back(LinearStage::Rotation(trial.degrees * k / (rampSteps + 1)) * _base);
+                this->vMatrices.push_back(LinearStage::Rotation(trial.degrees) * _base);
+            }
+            this->vTrials.push_back(trial);
+        }
+    }
+}
+
+QString PerturbationSchedule::Describe() const
+{
+    static const char *names[] = {"Washout", "Constant", "Ramp", "Random walk"};
+    QString s;
+    int first = 1;
+    for(int b=0; b<this->vBlocks.size(); b++)
+    {
+        const Block &block = this->vBlocks.at(b);
+        s += "Trials " + QString::number(first) + "-" + QString::number(first + block.trials - 1) + ": " + names[block.type];
+        if(block.type == Constant)
+            s += " " + QString::number(block.startDegrees) + " degrees";
+        else if(block.type == Ramp)
+            s += " from " + QString::number(block.startDegrees) + " to " + QString::number(block.endDegrees) + " degrees";
+        else if(block.type == RandomWalk)
+            s += " from " + QString::number(block.startDegrees) + " degrees, step " + QString::number(block.walkStep) +
+                    ", limit " + QString::number(block.walkLimit);
+        if(block.catchFraction > 0)
+            s += ", catch trials " + QString::number(block.catchFraction);
+        if(block.onset > 0 || block.onsetRamp > 0)
+            s += ", onset " + QString::number(block.onset) + " ms, onset ramp " + QString::number(block.onsetRamp) + " ms";
+        s += "\n";
+        first += block.trials;
+    }
+    s += "Schedule seed: " + QString::number(this->seed) + "\n";
+    return s;
+}
+
+//Linear congruential generator, the same on every platform
+double PerturbationSchedule::Uniform()
+{
+    this->state = this->state * 1664525U + 1013904223U;
+    return (this->state >> 8) / 16777216.0;
+}
+
+//Box-Muller transform
+double PerturbationSchedule::Gaussian()
+{
+    double u1 = 1.0 - this->Uniform();
+    double u2 = this->Uniform();
+    return sqrt(-2.0 * log(u1)) * cos(2 * 3.14159265358979323846 * u2);
+}
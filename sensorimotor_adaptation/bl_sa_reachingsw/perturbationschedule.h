@@ -0,0 +1,138 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Perturbation of every trial of the experiment. The protocol
+ * is described as a list of blocks of trials (no perturbation / washout,
+ * constant rotation, ramp, random walk), each one with optional catch
+ * trials and an onset within the trial. Expand() turns the description
+ * into flat tables when the experiment starts:
+ *   - one entry per trial: angle, catch trial, onset
+ *   - the matrices of every trial (LinearStage, see visuomotortransform.h),
+ *     one per sampling period of the onset ramp
+ * so the feedback only indexes a table on each event: no trigonometry and
+ * no random numbers after Expand(). Random values come from a fixed
+ * generator, so a seed always gives the same experiment.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef PERTURBATIONSCHEDULE_H
+#define PERTURBATIONSCHEDULE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include "visuomotortransform.h"
+
+class PerturbationSchedule
+{
+public:
+    enum BlockType
+    {
+        NoPerturbation = 0, //Baseline or washout
+        Constant = 1, //Same angle in every trial
+        Ramp = 2, //Angle changes linearly from the first to the last trial
+        RandomWalk = 3 //Angle changes by a random step every trial
+    };
+
+    //Description of a block of trials
+    struct Block
+    {
+        BlockType type;
+        int trials;
+        double startDegrees; //Constant: angle. Ramp and random walk: first angle
+        double endDegrees; //Ramp: angle of the last trial
+        double walkStep; //Random walk: standard deviation of the step (degrees)
+        double walkLimit; //Random walk: the angle stays within +-walkLimit
+        double catchFraction; //Fraction of catch trials (no perturbation)
+        int onset; //Time after the start of the trial (ms)
+        int onsetRamp; //Time the angle takes to grow to its value (ms)
+
+        //Modifiers: RampBlock(30, 0, -40).CatchTrials(0.1).Onset(200, 100)
+        Block& CatchTrials(double _fraction)
+        {
+            catchFraction = _fraction;
+            return *this;
+        }
+        Block& Onset(int _onset, int _onsetRamp = 0)
+        {
+            onset = _onset;
+            onsetRamp = _onsetRamp;
+            return *this;
+        }
+    };
+
+    //Blocks
+    static Block Washout(int _trials);
+    static Block ConstantBlock(int _trials, double _degrees);
+    static Block RampBlock(int _trials, double _startDegrees, double _endDegrees);
+    static Block RandomWalkBlock(int _trials, double _startDegrees, double _step, double _limit);
+
+    //Perturbation of one trial
+    struct Trial
+    {
+        double degrees; //Angle after the onset ramp
+        bool perturbed; //False: baseline, washout and catch trials
+        bool catchTrial;
+        qint64 onset; //ns after the start of the trial
+        int firstMatrix; //Index of the first matrix of the trial
+        int matrixCount; //1 + number of steps of the onset ramp
+    };
+
+    //Constructor
+    PerturbationSchedule();
+
+    //Methods
+    void Clear();
+    void Add(const Block &_block);
+    //Builds the tables
+    //_base: transform applied before the rotation of every perturbed trial
+    //(gain, mirror), _stepPeriod: step of the onset ramps (ns)
+    void Expand(const LinearStage &_base, qint64 _stepPeriod, quint32 _seed);
+    //Trial with the given index (0: first trial of the experiment)
+    //Trials beyond the schedule are not perturbed
+    const Trial& trial(int _index) const
+    {
+        return (_index >= 0 && _index < vTrials.size()) ? vTrials.at(_index) : unperturbed;
+    }
+    //Matrix of the trial _elapsed ns after its start
+    const LinearStage& Matrix(const Trial &_trial, qint64 _elapsed) const
+    {
+        qint64 step = (_elapsed - _trial.onset) / stepPeriod;
+        if(step < 0)
+            step = 0;
+        else if(step >= _trial.matrixCount)
+            step = _trial.matrixCount - 1;
+        return vMatrices.at(_trial.firstMatrix + (int)step);
+    }
+    //Blocks, one line each, for the header
+    QString Describe() const;
+
+    //Getters
+    int count() const
+    {
+        return vTrials.size();
+    }
+
+private:
+    //Fields
+    QVector<Block> vBlocks;
+    QVector<Trial> vTrials;
+    QVector<LinearStage> vMatrices;
+    qint64 stepPeriod;
+    quint32 seed;
+    Trial unperturbed;
+    //State of the random numbers of the expansion
+    quint32 state;
+
+    //Methods
+    static Block MakeBlock(BlockType _type, int _trials, double _startDegrees);
+    double Uniform();
+    double Gaussian();
+};
+
+#endif // PERTURBATIONSCHEDULE_H
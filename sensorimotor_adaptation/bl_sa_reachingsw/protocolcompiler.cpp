@@ -0,0 +1,402 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "protocolcompiler.h"
+
+#include <QFile>
+#include <QStringList>
+
+ProtocolDefinition::ProtocolDefinition()
+{
+    this->fileprefix = "andrei_mesa_piloto1";
+    this->samplingFrequency = 100;
+    this->realtimeAcquisition = false;
+    this->acquisitionCpu = -1;
+    this->inputGain = 1.0;
+    this->targetParadigm = TargetSet::SingleTarget;
+    this->numberTargets = 1;
+    this->targetSeed = 1;
+    this->distanceTarget = 320;
+    this->objHeight = 40;
+    this->objWidth = 40;
+    this->cursorWidth = 15;
+    this->cursorHeight = 15;
+    this->samplesToStop = 50; //500 ms
+    this->stopSpeed = 4;
+    this->stopDistance = 0;
+    this->onsetSpeed = 100;
+    this->restInterval = 1500;
+    this->perturbationGain = 1.0;
+    this->perturbationMirror = false;
+    this->mirrorAxisDegree = 90;
+    this->perturbationCurl = 0;
+    this->perturbationOffsetX = 0;
+    this->perturbationOffsetY = 0;
+    this->errorClamp = false;
+    this->scheduleSeed = 1;
+    this->saveTextFiles = true;
+    this->resumeSession = true;
+    this->verbose = false;
+    this->photodiodePatch = false;
+    this->photodiodeSize = 40;
+
+    //Four sessions of one trial without perturbation
+    for(int i=0; i<4; i++)
+    {
+        SessionDefinition session;
+        session.trials = 1;
+        session.feedback = true;
+        session.rest = this->restInterval;
+        session.sessionBreak = this->restInterval;
+        session.perturbation = PerturbationSchedule::Washout(1);
+        this->vSessions.push_back(session);
+    }
+}
+
+int ProtocolDefinition::numberTrials() const
+{
+    int n = 0;
+    for(int i=0; i<this->vSessions.size(); i++)
+        n += this->vSessions.at(i).trials;
+    return n;
+}
+
+//Values of the file
+static bool ToBool(const QString &_value, bool &_ok)
+{
+    QString v = _value.toLower();
+    _ok = (v == "true" || v == "false" || v == "1" || v == "0");
+    return v == "true" || v == "1";
+}
+
+bool ProtocolCompiler::Load(const QString &_path, ProtocolDefinition &_protocol, QString &_error)
+{
+    QFile file(_path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        _error = "Could not read " + _path;
+        return false;
+    }
+    if(!Parse(QString::fromUtf8(file.readAll()), _protocol, _error))
+    {
+        _error = _path + ", " + _error;
+        return false;
+    }
+    _protocol.path = _path;
+    return true;
+}
+
+//The sessions are read after every other key, so a "rest:" anywhere in the
+//file is the default of every session
+bool ProtocolCompiler::Parse(const QString &_text, ProtocolDefinition &_protocol, QString &_error)
+{
+    QStringList lines = _text.split('\n');
+    QVector<int> sessionLines;
+    for(int i=0; i<lines.size(); i++)
+    {
+        QString line = lines.at(i);
+        int comment = line.indexOf('#');
+        if(comment >= 0)
+            line.truncate(comment);
+        line = line.trimmed();
+        if(line.isEmpty())
+            continue;
+
+        int colon = line.indexOf(':');
+        if(colon <= 0)
+        {
+            _error = "line " + QString::number(i+1) + ": expected \"key: value\"";
+            return false;
+        }
+        QString key = line.left(colon).trimmed().toLower();
+        QString value = line.mid(colon+1).trimmed();
+        bool ok = true;
+
+        if(key == "session")
+            sessionLines.push_back(i);
+        else if(key == "prefix")
+        {
+            _protocol.fileprefix = value;
+            ok = !value.isEmpty();
+        }
+        else if(key == "sampling frequency")
+            _protocol.samplingFrequency = value.toInt(&ok);
+        else if(key == "realtime acquisition")
+            _protocol.realtimeAcquisition = ToBool(value, ok);
+        else if(key == "acquisition cpu")
+            _protocol.acquisitionCpu = value.toInt(&ok);
+        else if(key == "input device")
+            _protocol.inputDevice = value;
+        else if(key == "input replay")
+            _protocol.inputReplayFile = value;
+        else if(key == "input gain")
+            _protocol.inputGain = value.toDouble(&ok);
+        else if(key == "target paradigm")
+        {
+            QString v = value.toLower();
+            if(v == "single")
+                _protocol.targetParadigm = TargetSet::SingleTarget;
+            else if(v == "center-out")
+                _protocol.targetParadigm = TargetSet::CenterOut;
+            else if(v == "random")
+                _protocol.targetParadigm = TargetSet::RandomTarget;
+            else
+                ok = false;
+        }
+        else if(key == "targets")
+            _protocol.numberTargets = value.toInt(&ok);
+        else if(key == "target seed")
+            _protocol.targetSeed = value.toUInt(&ok);
+        else if(key == "target distance")
+            _protocol.distanceTarget = value.toInt(&ok);
+        else if(key == "target width")
+            _protocol.objWidth = value.toInt(&ok);
+        else if(key == "target height")
+            _protocol.objHeight = value.toInt(&ok);
+        else if(key == "cursor width")
+            _protocol.cursorWidth = value.toInt(&ok);
+        else if(key == "cursor height")
+            _protocol.cursorHeight = value.toInt(&ok);
+        else if(key == "samples to stop")
+            _protocol.samplesToStop = value.toInt(&ok);
+        else if(key == "stop speed")
+            _protocol.stopSpeed = value.toDouble(&ok);
+        else if(key == "stop distance")
+            _protocol.stopDistance = value.toInt(&ok);
+        else if(key == "onset speed")
+            _protocol.onsetSpeed = value.toDouble(&ok);
+        else if(key == "rest")
+            _protocol.restInterval = value.toInt(&ok);
+        else if(key == "perturbation gain")
+            _protocol.perturbationGain = value.toDouble(&ok);
+        else if(key == "mirror axis")
+        {
+            _protocol.perturbationMirror = value.toLower() != "none";
+            if(_protocol.perturbationMirror)
+                _protocol.mirrorAxisDegree = value.toDouble(&ok);
+        }
+        else if(key == "curl field")
+            _protocol.perturbationCurl = value.toDouble(&ok);
+        else if(key == "offset x")
+            _protocol.perturbationOffsetX = value.toDouble(&ok);
+        else if(key == "offset y")
+            _protocol.perturbationOffsetY = value.toDouble(&ok);
+        else if(key == "error clamp")
+            _protocol.errorClamp = ToBool(value, ok);
+        else if(key == "schedule seed")
+            _protocol.scheduleSeed = value.toUInt(&ok);
+        else if(key == "text files")
+            _protocol.saveTextFiles = ToBool(value, ok);
+        else if(key == "resume")
+            _protocol.resumeSession = ToBool(value, ok);
+        else if(key == "verbose")
+            _protocol.verbose = ToBool(value, ok);
+        else if(key == "photodiode patch")
+            _protocol.photodiodePatch = ToBool(value, ok);
+        else if(key == "photodiode size")
+            _protocol.photodiodeSize = value.toInt(&ok);
+        else
+        {
+            _error = "line " + QString::number(i+1) + ": unknown key \"" + key + "\"";
+            return false;
+        }
+        if(!ok)
+        {
+            _error = "line " + QString::number(i+1) + ": invalid value \"" + value + "\" for \"" + key + "\"";
+            return false;
+        }
+    }
+
+    //A file without sessions keeps the default sessions
+    if(!sessionLines.isEmpty())
+    {
+        _protocol.vSessions.clear();
+        for(int i=0; i<sessionLines.size(); i++)
+        {
+            int line = sessionLines.at(i);
+            QString text = lines.at(line);
+            int comment = text.indexOf('#');
+            if(comment >= 0)
+                text.truncate(comment);
+            SessionDefinition session;
+            QString error;
+            if(!ParseSession(text.mid(text.indexOf(':')+1), _protocol, session, error))
+            {
+                _error = "line " + QString::number(line+1) + ": " + error;
+                return false;
+            }
+            _protocol.vSessions.push_back(session);
+        }
+    }
+    return Validate(_protocol, _error);
+}
+
+//trials=N [feedback=true|false] [rest=ms] [break=ms]
+//[perturbation=none|constant|ramp|randomwalk] [degrees=] [from=] [to=]
+//[step=] [limit=] [catch=] [onset=ms] [onsetramp=ms]
+bool ProtocolCompiler::ParseSession(const QString &_value, const ProtocolDefinition &_protocol,
+                                    SessionDefinition &_session, QString &_error)
+{
+    _session.trials = 0;
+    _session.feedback = true;
+    _session.rest = _protocol.restInterval;
+    _session.sessionBreak = -1;
+    QString type = "none";
+    double degrees = 0, from = 0, to = 0, step = 0, limit = 0, catchFraction = 0;
+    int onset = 0, onsetRamp = 0;
+
+    QStringList fields = _value.simplified().split(' ');
+    for(int i=0; i<fields.size(); i++)
+    {
+        if(fields.at(i).isEmpty())
+            continue;
+        int equal = fields.at(i).indexOf('=');
+        if(equal <= 0)
+        {
+            _error = "expected \"name=value\" instead of \"" + fields.at(i) + "\"";
+            return false;
+        }
+        QString name = fields.at(i).left(equal).toLower();
+        QString value = fields.at(i).mid(equal+1);
+        bool ok = true;
+        if(name == "trials")
+            _session.trials = value.toInt(&ok);
+        else if(name == "feedback")
+            _session.feedback = ToBool(value, ok);
+        else if(name == "rest")
+            _session.rest = value.toInt(&ok);
+        else if(name == "break")
+            _session.sessionBreak = value.toInt(&ok);
+        else if(name == "perturbation")
+        {
+            type = value.toLower();
+            ok = (type == "none" || type == "constant" || type == "ramp" || type == "randomwalk");
+        }
+        else if(name == "degrees")
+            degrees = value.toDouble(&ok);
+        else if(name == "from")
+            from = value.toDouble(&ok);
+        else if(name == "to")
+            to = value.toDouble(&ok);
+        else if(name == "step")
+            step = value.toDouble(&ok);
+        else if(name == "limit")
+            limit = value.toDouble(&ok);
+        else if(name == "catch")
+            catchFraction = value.toDouble(&ok);
+        else if(name == "onset")
+            onset = value.toInt(&ok);
+        else if(name == "onsetramp")
+            onsetRamp = value.toInt(&ok);
+        else
+        {
+            _error = "unknown session field \"" + name + "\"";
+            return false;
+        }
+        if(!ok)
+        {
+            _error = "invalid value \"" + value + "\" for \"" + name + "\"";
+            return false;
+        }
+    }
+    if(_session.sessionBreak < 0)
+        _session.sessionBreak = _session.rest;
+
+    if(type == "constant")
+        _session.perturbation = PerturbationSchedule::ConstantBlock(_session.trials, degrees);
+    else if(type == "ramp")
+        _session.perturbation = PerturbationSchedule::RampBlock(_session.trials, from, to);
+    else if(type == "randomwalk")
+        _session.perturbation = PerturbationSchedule::RandomWalkBlock(_session.trials, from, step, limit);
+    else
+        _session.perturbation = PerturbationSchedule::Washout(_session.trials);
+    _session.perturbation.CatchTrials(catchFraction).Onset(onset, onsetRamp);
+    return true;
+}
+
+bool ProtocolCompiler::Validate(const ProtocolDefinition &_protocol, QString &_error)
+{
+    if(_protocol.fileprefix.isEmpty())
+        _error = "the prefix is empty";
+    else if(_protocol.samplingFrequency < 100 || _protocol.samplingFrequency > 2000)
+        _error = "the sampling frequency must be between 100 and 2000 Hz";
+    else if(_protocol.inputGain <= 0)
+        _error = "the input gain must be positive";
+    else if(_protocol.numberTargets < 1 || _protocol.numberTargets > TargetSet::maxTargets)
+        _error = "the number of targets must be between 1 and " + QString::number(TargetSet::maxTargets);
+    else if(_protocol.targetParadigm == TargetSet::SingleTarget && _protocol.numberTargets != 1)
+        _error = "the single target paradigm has one target";
+    else if(_protocol.distanceTarget <= 0 || _protocol.objWidth <= 0 || _protocol.objHeight <= 0 ||
+            _protocol.cursorWidth <= 0 || _protocol.cursorHeight <= 0 || _protocol.photodiodeSize <= 0)
+        _error = "distances and sizes must be positive";
+    else if(_protocol.samplesToStop < 2)
+        _error = "samples to stop must be at least 2";
+    else if(_protocol.stopSpeed < 0 || _protocol.stopDistance < 0)
+        _error = "the stop speed and distance cannot be negative";
+    else if(_protocol.onsetSpeed <= 0)
+        _error = "the onset speed must be positive";
+    else if(_protocol.restInterval < 0)
+        _error = "the rest cannot be negative";
+    else if(_protocol.perturbationGain == 0)
+        _error = "the perturbation gain cannot be 0";
+    else if(_protocol.vSessions.isEmpty())
+        _error = "the protocol has no sessions";
+    if(!_error.isEmpty())
+        return false;
+
+    for(int i=0; i<_protocol.vSessions.size(); i++)
+    {
+        const SessionDefinition &session = _protocol.vSessions.at(i);
+        if(session.trials < 1)
+            _error = "has no trials";
+        else if(session.rest < 0 || session.sessionBreak < 0)
+            _error = "the rest cannot be negative";
+        else if(session.perturbation.catchFraction < 0 || session.perturbation.catchFraction > 1)
+            _error = "the fraction of catch trials must be between 0 and 1";
+        else if(session.perturbation.onset < 0 || session.perturbation.onsetRamp < 0)
+            _error = "the onset cannot be negative";
+        else if(session.perturbation.type == PerturbationSchedule::RandomWalk && session.perturbation.walkStep <= 0)
+            _error = "the random walk needs a positive step";
+        if(!_error.isEmpty())
+        {
+            _error = "session " + QString::number(i+1) + ": " + _error;
+            return false;
+        }
+    }
+    return true;
+}
+
+//Every table is built here, once
+QVector<TrialDescriptor> ProtocolCompiler::Compile(const ProtocolDefinition &_protocol, const TargetSet &_targets,
+                                                   PerturbationSchedule &_schedule, const LinearStage &_base,
+                                                   qint64 _stepPeriod)
+{
+    _schedule.Clear();
+    for(int i=0; i<_protocol.vSessions.size(); i++)
+        _schedule.Add(_protocol.vSessions.at(i).perturbation);
+    _schedule.Expand(_base, _stepPeriod, _protocol.scheduleSeed);
+
+    QVector<TrialDescriptor> trials;
+    trials.reserve(_protocol.numberTrials());
+    for(int s=0; s<_protocol.vSessions.size(); s++)
+    {
+        const SessionDefinition &session = _protocol.vSessions.at(s);
+        for(int t=0; t<session.trials; t++)
+        {
+            TrialDescriptor trial;
+            int index = trials.size();
+            trial.session = s+1;
+            trial.trial = t;
+            trial.target = _targets.TargetForTrial(_protocol.targetParadigm, index, _protocol.targetSeed);
+            trial.perturbation = _schedule.trial(index);
+            trial.feedback = session.feedback;
+            trial.rest = (t == session.trials-1) ? session.sessionBreak : session.rest;
+            trials.push_back(trial);
+        }
+    }
+    return trials;
+}
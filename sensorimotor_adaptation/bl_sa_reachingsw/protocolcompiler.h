@@ -0,0 +1,160 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Protocol of an experiment loaded from a text file. The file
+ * is read and validated when the application starts (Load()), and the
+ * protocol is compiled into one TrialDescriptor per trial when the task
+ * starts (Compile()): target, perturbation, feedback and rest of every
+ * trial are then read from a table, so nothing is parsed or computed at
+ * the boundaries between trials.
+ * Format: one "key: value" per line, '#' starts a comment, and one
+ * "session:" line per session with "name=value" fields, e.g.
+ *   prefix: subject01
+ *   target paradigm: center-out
+ *   targets: 8
+ *   session: trials=40 feedback=true
+ *   session: trials=80 perturbation=ramp from=0 to=-40 catch=0.1
+ *   session: trials=40 perturbation=none break=120000
+ * See protocols/example.txt for every key. Keys that are not in the file
+ * keep the values of ProtocolDefinition().
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef PROTOCOLCOMPILER_H
+#define PROTOCOLCOMPILER_H
+
+#include <QString>
+#include <QVector>
+#include "targetset.h"
+#include "perturbationschedule.h"
+
+//One session of the protocol
+struct SessionDefinition
+{
+    int trials;
+    bool feedback; //The visual feedback is shown
+    int rest; //Rest after each trial (ms)
+    int sessionBreak; //Rest after the last trial of the session (ms)
+    PerturbationSchedule::Block perturbation;
+};
+
+//Every parameter of an experiment
+//The defaults are the protocol that was defined in the source code
+struct ProtocolDefinition
+{
+    ProtocolDefinition();
+
+    //File the protocol was loaded from (empty: defaults)
+    QString path;
+    //Filename prefix
+    QString fileprefix;
+    //Sampling frequency (Hz), AcquisitionThread supports 100 Hz to 2 kHz
+    int samplingFrequency;
+    //Runs the acquisition thread with SCHED_FIFO priority
+    bool realtimeAcquisition;
+    //CPU where the acquisition thread is pinned (-1: no pinning)
+    int acquisitionCpu;
+    //Evdev node of the mouse, e.g. "/dev/input/event3"
+    //Empty: the system cursor is used
+    QString inputDevice;
+    //File replayed as input when no device is given (empty: disabled)
+    QString inputReplayFile;
+    //Pixels per count of the input device
+    double inputGain;
+    //How the target of each trial is chosen (see TargetSet)
+    TargetSet::Paradigm targetParadigm;
+    int numberTargets;
+    //Seed of the order of the targets (RandomTarget)
+    quint32 targetSeed;
+    //Distance from center to target (pixels)
+    int distanceTarget;
+    //Size of the origin and of the targets
+    int objHeight;
+    int objWidth;
+    //Size of the cursor
+    int cursorWidth;
+    int cursorHeight;
+    //End of the movement (see MovementEndDetector): the feedback has been
+    //stationary for samplesToStop samples, with a mean speed below
+    //stopSpeed (pixels/s), and the cursor farther than stopDistance from
+    //the center of the origin (0: cursor width + target width)
+    int samplesToStop;
+    double stopSpeed;
+    int stopDistance;
+    //Onset of the movement for the kinematic features (see
+    //KinematicFeatures): speed of the feedback above onsetSpeed (pixels/s)
+    double onsetSpeed;
+    //Rest after each trial (ms), default of the sessions
+    int restInterval;
+    //Transforms of the perturbed trials (see visuomotortransform.h)
+    double perturbationGain;
+    bool perturbationMirror;
+    double mirrorAxisDegree;
+    double perturbationCurl;
+    double perturbationOffsetX;
+    double perturbationOffsetY;
+    bool errorClamp;
+    //Seed of the random walks and catch trials of the schedule
+    quint32 scheduleSeed;
+    //Also saves the text files of the previous versions (default: true, the
+    //analysis scripts read them)
+    bool saveTextFiles;
+    //Continues an experiment whose session file already exists
+    bool resumeSession;
+    //Prints the reports of every trial (qDebug); they are also saved in the
+    //trial info of the session file
+    bool verbose;
+    //Square for a photodiode in the bottom-left corner
+    bool photodiodePatch;
+    int photodiodeSize;
+    QVector<SessionDefinition> vSessions;
+
+    //Getters
+    int numberSessions() const
+    {
+        return vSessions.size();
+    }
+    int numberTrials() const;
+};
+
+//Everything that changes from one trial to the next
+struct TrialDescriptor
+{
+    int session; //1: first session
+    int trial; //0: first trial of the session
+    int target; //Index in the TargetSet
+    PerturbationSchedule::Trial perturbation;
+    bool feedback;
+    int rest; //Rest after the trial (ms)
+};
+
+class ProtocolCompiler
+{
+public:
+    //Methods
+    //Reads a protocol file, starting from the defaults
+    //Returns false, and the line with the problem in _error, if the file
+    //cannot be read or is not valid
+    static bool Load(const QString &_path, ProtocolDefinition &_protocol, QString &_error);
+    //Same, from the text of a file
+    static bool Parse(const QString &_text, ProtocolDefinition &_protocol, QString &_error);
+    //Checks the values of the protocol
+    static bool Validate(const ProtocolDefinition &_protocol, QString &_error);
+    //Expands the perturbation of every session into _schedule and returns
+    //the descriptors of every trial of the experiment
+    //_base and _stepPeriod: see PerturbationSchedule::Expand()
+    static QVector<TrialDescriptor> Compile(const ProtocolDefinition &_protocol, const TargetSet &_targets,
+                                            PerturbationSchedule &_schedule, const LinearStage &_base,
+                                            qint64 _stepPeriod);
+
+private:
+    static bool ParseSession(const QString &_value, const ProtocolDefinition &_protocol,
+                             SessionDefinition &_session, QString &_error);
+};
+
+#endif // PROTOCOLCOMPILER_H
@@ -15,9 +15,11 @@
 
 #include <QDebug>
 
-ProtocolController::ProtocolController(QWidget *p)
+ProtocolController::ProtocolController(QWidget *p, const ProtocolDefinition &_protocol)
 {
     this->parent = p;
+    //Loaded and validated when the application started
+    this->protocol = _protocol;
     //Sets the background color of the form
     //Default: black
     this->parent->setStyleSheet("background-color: black;");
@@ -28,21 +30,6 @@ ProtocolController::ProtocolController(QWidget *p)
     this->parent->setCursor(Qt::BlankCursor);
     //Enables mouse tracking
     this->parent->setMouseTracking(true);
-
-    this->numberTrialsperSession.push_back(1);
-    this->numberTrialsperSession.push_back(1);
-    this->numberTrialsperSession.push_back(1);
-    this->numberTrialsperSession.push_back(1);
-
-    this->perturbationSession.push_back(false);
-    this->perturbationSession.push_back(false);
-    this->perturbationSession.push_back(false);
-    this->perturbationSession.push_back(false);
-
-    this->vectorCursorFeedback.push_back(true);
-    this->vectorCursorFeedback.push_back(true);
-    this->vectorCursorFeedback.push_back(true);
-    this->vectorCursorFeedback.push_back(true);
 }
 
 void ProtocolController::Initialize()
@@ -53,53 +40,141 @@ void ProtocolController::Initialize()
         this->centerX = this->parent->geometry().width()/2;
         this->centerY = this->parent->geometry().height()/2;
 
-        //Defines the position of the origin
-        this->originX = this->centerX;
-        this->originY = this->centerY + this->distanceTarget;
-
-        //Defines the position of the target
-        this->targetX = this->centerX;
-        this->targetY = this->centerY - this->distanceTarget;
+        //Defines the position of the origin and of the targets
+        //One target: the origin is below the center and the target above it
+        //Several targets: the origin is at the center and the targets are
+        //around it. The hit radius is the same used for the origin
+        //(see SceneStore::HasCollidedCenter)
+        if(this->protocol.targetParadigm == TargetSet::SingleTarget)
+        {
+            this->originX = this->centerX;
+            this->originY = this->centerY + this->protocol.distanceTarget;
+            this->targetSet.Add(this->centerX, this->centerY - this->protocol.distanceTarget, this->protocol.objWidth/2.0);
+            this->targetSet.Build();
+        }
+        else
+        {
+            this->originX = this->centerX;
+            this->originY = this->centerY;
+            this->targetSet.CreateCircle(this->centerX, this->centerY, this->protocol.distanceTarget,
+                                         this->protocol.numberTargets, this->protocol.objWidth/2.0);
+        }
+        this->currentTarget = 0;
+        this->targetX = this->targetSet.center(0).x();
+        this->targetY = this->targetSet.center(0).y();
 
         //Sets the cursor to the center of the screen
-        QCursor::setPos(this->centerX,this->centerY);
-
-        //Creates a new mutex
-        this->mutex = new QMutex();
-        //Creates a new thread
-        this->workerThread = new QThread;
-        //Starts the thread
-        this->workerThread->start();
-        //Creates a new timer
-        this->timer = new QTimer(0);
-        //Precise timer is prefered
-        this->timer->setTimerType(Qt::PreciseTimer);
-        //Finds the timer interval (ms) according to the sampling frequency
-        int interval = (int)(1000 * (1.0 / ((double)this->samplingFrequency)));
-        this->timer->setInterval(interval);
-        //Connects the timer to the processing event
-        connect(this->timer,SIGNAL(timeout()),this,SLOT(timerTick()));
-        //Moves the protocol controller to a different Thread
-        this->timer->moveToThread(workerThread);
+        if(!this->m_headless && !this->m_simulated)
+            QCursor::setPos(this->centerX,this->centerY);
+
+        //Creates the ring that carries the cursor samples from the
+        //mouse events to the sampling tick
+        this->sampleBuffer = new SampleBuffer(this->sampleBufferSize);
+        this->lastSample.timestamp = this->now();
+        this->lastSample.rawX = this->centerX;
+        this->lastSample.rawY = this->centerY;
+        this->lastSample.x = this->centerX;
+        this->lastSample.y = this->centerY;
+        //Creates the acquisition thread
+        //The sampling period is kept by absolute deadlines on its own thread,
+        //so it does not depend on the GUI event loop
+        this->acquisitionThread = new AcquisitionThread();
+        this->acquisitionThread->setFrequency(this->protocol.samplingFrequency);
+        this->acquisitionThread->setRealtimePriority(this->protocol.realtimeAcquisition);
+        this->acquisitionThread->setCpuAffinity(this->protocol.acquisitionCpu);
+        //The tick is processed directly on the acquisition thread
+        connect(this->acquisitionThread,SIGNAL(tick()),this,SLOT(timerTick()),
+                Qt::DirectConnection);
+        //Interpolates the input events onto the sampling grid
+        this->resampler = new Resampler(this->acquisitionThread->period());
+        //The end of a trial is handled back on the GUI thread
+        //Simulated: there is only one thread, the trial is saved at once
+        connect(this,SIGNAL(trialEnded()),this,SLOT(finishTrial()),
+                this->m_simulated ? Qt::DirectConnection : Qt::QueuedConnection);
+
+        //Repaints the window when the cursor, the colors or the feedback
+        //change, at most once per refresh of the display
+        this->m_frameScheduler = new FrameScheduler(this->parent);
+        //Follows every movement of the cursor until it is on the screen
+        this->m_latencyTracker = new LatencyTracker();
 
         //Connects an event to the rest timer
-        this->timerRest = new QTimer(0);
-        this->timerRest->setInterval(this->restInterval);
+        this->timerRest = new QTimer(this);
         connect(this->timerRest,SIGNAL(timeout()),this,SLOT(timerRestTick()));
 
-        //Connects events to the timer
-        connect(this,SIGNAL(start()),this->timer,SLOT(start()),
-                Qt::QueuedConnection);
-        connect(this,SIGNAL(stop()),this->timer,SLOT(stop()),
-                Qt::QueuedConnection);
-
         //Initializes the cursor controller
         this->cursorController = new CursorController();
-        if(this->perturbation)
+        this->cursorController->setOriginX(this->originX);
+        this->cursorController->setOriginY(this->originY);
+        //Gain first, then the mirror reversal and the rotation of the trial
+        //(the rotation comes from the schedule)
+        LinearStage base = LinearStage::Gain(this->protocol.perturbationGain, this->protocol.perturbationGain);
+        if(this->protocol.perturbationMirror)
+            base = LinearStage::Mirror(this->protocol.mirrorAxisDegree) * base;
+        FeedbackTransform &transform = this->cursorController->transform();
+        transform.stage<VelocityFieldStage>() = VelocityStage::Curl(this->protocol.perturbationCurl);
+        transform.stage<ShiftStage>() = OffsetStage(this->protocol.perturbationOffsetX, this->protocol.perturbationOffsetY);
+        transform.stage<ClampStage>().setEnabled(this->protocol.errorClamp);
+
+        //Target, perturbation, feedback and rest of every trial
+        //The onset ramps change the angle once per sampling period
+        this->vTrials = ProtocolCompiler::Compile(this->protocol, this->targetSet, this->perturbationSchedule,
+                                                  base, this->acquisitionThread->period());
+        //End of the movement: sliding window of the dwell time, sized once
+        //The cursor must be outside the origin (same criterion as
+        //GUIObject::HasCollided by default, on the raw cursor position)
+        this->movementEnd.setWindow(this->protocol.samplesToStop, this->acquisitionThread->period());
+        this->movementEnd.setSpeedThreshold(this->protocol.stopSpeed);
+        this->movementEnd.setOrigin(this->originX, this->originY, this->protocol.stopDistance > 0 ?
+                                        this->protocol.stopDistance :
+                                        this->protocol.cursorWidth + this->protocol.objWidth);
+        //Kinematic features, updated on every sample of the trial
+        this->kinematics.setPeriod(this->acquisitionThread->period());
+        this->kinematics.setOnsetSpeed(this->protocol.onsetSpeed);
+        int maxTrials = 0;
+        for(int i=0; i<this->protocol.numberSessions(); i++)
+            maxTrials = qMax(maxTrials, this->protocol.vSessions.at(i).trials);
+        this->vSessionFeatures.reserve(maxTrials);
+        this->cursorController->setBounds(this->parent->width(),this->parent->height());
+
+        //Opens the input device, if one was chosen
+        //Otherwise the system cursor (QCursor) is used
+        //Headless and simulated: the cursor is moved by MoveCursor()
+        this->inputSource = NULL;
+        bool input = !this->m_headless && !this->m_simulated;
+        if(input && !this->protocol.inputDevice.isEmpty())
+            this->inputSource = new EvdevInputSource(this->protocol.inputDevice.toStdString());
+        else if(input && !this->protocol.inputReplayFile.isEmpty())
+            this->inputSource = new ReplayInputSource(this->protocol.inputReplayFile.toStdString());
+        if(this->inputSource != NULL)
         {
-            this->cursorController->setPerturbation(this->perturbationDegree);
-            this->cursorController->setOriginX(this->originX);
-            this->cursorController->setOriginY(this->originY);
+            if(this->inputSource->Open())
+            {
+                this->cursorController->setInputSource(this->inputSource);
+                this->cursorController->setGain(this->protocol.inputGain);
+                //Devices with a file descriptor are read when they have data,
+                //the others are polled every millisecond
+                if(this->inputSource->fileDescriptor() >= 0)
+                {
+                    this->inputNotifier = new QSocketNotifier(this->inputSource->fileDescriptor(),
+                                                              QSocketNotifier::Read, this);
+                    connect(this->inputNotifier,SIGNAL(activated(int)),this,SLOT(inputReady()));
+                }
+                else
+                {
+                    this->inputPollTimer = new QTimer(this);
+                    this->inputPollTimer->setTimerType(Qt::PreciseTimer);
+                    this->inputPollTimer->setInterval(1);
+                    connect(this->inputPollTimer,SIGNAL(timeout()),this,SLOT(inputReady()));
+                    this->inputPollTimer->start();
+                }
+            }
+            else
+            {
+                qDebug() << "Input device not available, using the system cursor";
+                delete this->inputSource;
+                this->inputSource = NULL;
+            }
         }
 
         //Counter for the number of trials
@@ -107,41 +182,46 @@ void ProtocolController::Initialize()
         //Counter for the number of sessions
         this->sessionCounter=1;
 
-        //Aux variables
-        double x=0;
-        double y=0;
-
-        //Creates the object representing the origin                
-        this->objOrigin = new GUIObject();
-        x = this->originX;
-        y = this->originY;
-        this->objOrigin->point = new QPointF(x,y);
-        this->objOrigin->pen = new QPen(Qt::blue);
-        this->objOrigin->pen->setWidth(0);
-        this->objOrigin->width = this->objWidth;
-        this->objOrigin->height = this->objHeight;
-        this->objOrigin->type = GUIObject::Ellipse;
-
-        //Creates the object representing the target
+        //Objects drawn in the window, created once
+        //Origin and target
         this->targetColor = Qt::red;
-        this->objTarget = new GUIObject();
-        x = this->targetX;
-        y = this->targetY;
-        this->objTarget->point = new QPointF(x,y);
-        this->objTarget->pen = new QPen(this->targetColor);
-        this->objTarget->pen->setWidth(0);
-        this->objTarget->width = this->objWidth;
-        this->objTarget->height = this->objHeight;
-        this->objTarget->type = GUIObject::Ellipse;
-
-        this->objFeedbackCursor = new GUIObject();
+        this->originObject = this->scene.Add(SceneStore::Ellipse, this->originX, this->originY,
+                                             this->protocol.objWidth, this->protocol.objHeight, Qt::blue);
+        this->targetObject = this->scene.Add(SceneStore::Ellipse, this->targetX, this->targetY,
+                                             this->protocol.objWidth, this->protocol.objHeight, this->targetColor);
+        //Actual mouse movement (not drawn)
+        this->cursorObject = this->scene.Add(SceneStore::Ellipse, 0, 0,
+                                             this->protocol.cursorWidth, this->protocol.cursorHeight, Qt::yellow);
+        this->scene.setVisible(this->cursorObject, false);
+        //Visual feedback, can be different from the actual mouse movement
         this->feedbackCursorColor = Qt::green;
-        this->objCursor = new GUIObject();
+        this->feedbackObject = this->scene.Add(SceneStore::Ellipse, 0, 0,
+                                               this->protocol.cursorWidth, this->protocol.cursorHeight, this->feedbackCursorColor);
+        //Patch for the photodiode, drawn over everything else
+        this->photodiodeObject = this->scene.Add(SceneStore::Rectangle, 0, this->parent->height() - this->protocol.photodiodeSize,
+                                                 this->protocol.photodiodeSize, this->protocol.photodiodeSize, Qt::black);
+        this->scene.setVisible(this->photodiodeObject, this->protocol.photodiodePatch);
+
+        this->cursorController->setRawPosition(this->originX,this->originY);
 
-        //Writes the header file
-        this->writeHeader();
+        //Headless: nothing is recorded
+        if(!this->m_headless)
+        {
+            //Writes the header file
+            this->writeHeader();
+
+            if(!this->m_simulated)
+                QCursor::setPos(this->originX,this->originY);
+        }
+
+        //Target of the first trial (or of the trial where a resumed
+        //experiment continues)
+        this->prepareTrial();
 
-        QCursor::setPos(this->originX,this->originY);
+        //Starts sampling
+        //Simulated: the tick is run by Advance()
+        if(!this->m_headless && !this->m_simulated)
+            this->acquisitionThread->start();
 
         this->initialized = true;
     }
@@ -150,70 +230,74 @@ void ProtocolController::Initialize()
 //Destructor
 ProtocolController::~ProtocolController()
 {
-    if(this->flagRecord)
-        emit this->stop();
-    free(this->timer);
-    free(this->fileController);
-    free(this->cursorController);
-    free(this->mutex);
-    this->workerThread->deleteLater();
-    free(this->workerThread);
+    //Stops sampling before releasing the objects used by the tick
+    this->Stop();
+    delete this->acquisitionThread;
+    delete this->fileController;
+    delete this->cursorController;
+    delete this->inputSource;
+    delete this->sampleBuffer;
+    delete this->resampler;
+    delete this->m_frameScheduler;
+    delete this->m_latencyTracker;
+    //Closes the session file if the experiment was interrupted
+    delete this->trialLog;
+    delete this->sessionFile;
+}
+
+//Stops sampling and writes the blocks of an interrupted trial
+//The acquisition thread is joined, so no tick runs after this
+void ProtocolController::Stop()
+{
+    if(this->acquisitionThread != NULL)
+        this->acquisitionThread->Stop();
+    if(this->writeTimer != NULL)
+        this->writeTimer->stop();
+    this->writePending();
 }
 
 //This method updates the objects that needs to be drawn in the GUI
 //These objects can be targets, origin or even the visual feedback position
-QVector<GUIObject*> ProtocolController::updateGUI()
+//The objects are updated in place: no memory is allocated per frame
+const SceneStore& ProtocolController::updateGUI()
 {
-    //Creates a vector containing the GUI objects
-    QVector<GUIObject*> vobj;
-    double x=0;
-    double y=0;
-
-    //Creates the origin marker   
-    vobj.push_back(this->objOrigin);    
-
-    //Creates the target marker
-    this->objTarget->pen = new QPen(this->targetColor);
-    this->objTarget->pen->setWidth(0);
-    vobj.push_back(this->objTarget);
+    //Target marker
+    this->scene.setColor(this->targetObject, this->targetColor);
 
     if(this->flagFeedback)
     {
-        //Creates an object that represents the actual mouse movement
-        x = QCursor::pos().x();
-        y = QCursor::pos().y();
-        objCursor->point = new QPointF(x,y);
-        objCursor->pen = new QPen(Qt::yellow);
-        objCursor->pen->setWidth(0);
-        objCursor->width = this->cursorWidth;
-        objCursor->height = this->cursorHeight;
-        objCursor->type = GUIObject::Ellipse;
-
-        //Creates an object that represents the visual feedback
+        //Actual mouse movement
+        this->scene.setPosition(this->cursorObject,
+                                this->cursorController->rawX(), this->cursorController->rawY());
+
+        //Visual feedback
         //Can be different from the actual mouse movement
-        //GUIObject *objFeedbackCursor = new GUIObject();
-        x = this->cursorController->x();
-        y = this->cursorController->y();
-        objFeedbackCursor->point = new QPointF(x,y);
-        objFeedbackCursor->pen = new QPen(this->feedbackCursorColor);
-        objFeedbackCursor->pen->setWidth(0);
-        objFeedbackCursor->width = this->cursorWidth;
-        objFeedbackCursor->height = this->cursorHeight;
-        objFeedbackCursor->type = GUIObject::Ellipse;
+        this->scene.setPosition(this->feedbackObject,
+                                this->cursorController->x(), this->cursorController->y());
+        this->scene.setColor(this->feedbackObject, this->feedbackCursorColor);
+
+        //The frame shows a new position: the patch changes color
+        if(this->m_latencyTracker->SceneUpdated(this->now()) && this->protocol.photodiodePatch)
+            this->scene.setColor(this->photodiodeObject,
+                                 this->scene.color(this->photodiodeObject) == QColor(Qt::black).rgba() ?
+                                     Qt::white : Qt::black);
 
         //Checks if the visual feedback cursor has collided with the origin
         //In this case, the data acquisition is initiated
-        if(objFeedbackCursor->HasCollidedCenter(objOrigin) && flagRecord==false && this->flagExperiment)
+        //A new trial only starts after the previous one has been saved
+        if(this->scene.HasCollidedCenter(this->feedbackObject, this->originObject) && !this->flagRecord
+                && !this->flagSaving && this->flagExperiment)
         {
-            emit this->start();
+            this->flagPerturbation = this->currentTrial->perturbation.perturbed;
+            this->perturbationStartTime = this->now();
             this->flagRecord=true;
-            this->flagPerturbation = this->perturbationSession[this->sessionCounter-1];
+            this->m_latencyTracker->Reset();
         }
 
         //Checks if the visual feedback cursor has collided with the
         //target. In this case, the data acquisition is stopped
         //and saved in a file
-        else if(objFeedbackCursor->HasCollidedCenter(objTarget) && flagRecord==true && this->flagExperiment)
+        else if(this->scene.HasCollidedCenter(this->feedbackObject, this->targetObject) && this->flagRecord && this->flagExperiment)
         {
             /*this->flagPerturbation = false;
             this->flagRecord=false;
@@ -223,12 +307,9 @@ QVector<GUIObject*> ProtocolController::updateGUI()
         }
     }
 
-    //vobj.push_back(this->objCursor);
-
-    if(this->vectorCursorFeedback.at(this->sessionCounter-1))
-        vobj.push_back(this->objFeedbackCursor);
+    this->scene.setVisible(this->feedbackObject, this->currentTrial->feedback);
 
-    return vobj;
+    return this->scene;
 }
 
 //This method indicates that the experiment should be started
@@ -238,53 +319,86 @@ void ProtocolController::BeginExperiment()
     this->flagExperiment = true;
     //Sets the cursor back to the origin
     //QCursor::setPos(this->originX,this->originY);
+    //The next frame checks whether the cursor is already on the origin
+    this->m_frameScheduler->Invalidate();
 }
 
 //Saves the samples from the visual feedback
+//Runs on the acquisition thread once per sampling period
 void ProtocolController::timerTick()
 {
-    //Gets the current time -> to check the sampling frequency
-    QString currentTime = QTime::currentTime().toString("hh:mm:ss.zzzz");
-    //Locks the mutex for acessing the "cursorController" object for retrieving
-    //the x and y position of the visual feedback cursor
-    this->mutex->lock();
-    if(this->flagRecord) //If the cursor should be recorded
+    qint64 now = this->now();
+
+    //Retrieves every sample produced by the input events since the last tick
+    //During a trial every event is kept with its own timestamp and is also
+    //interpolated onto the uniform sampling grid
+    CursorSample sample;
+    while(this->sampleBuffer->Pop(sample))
     {
-        //Creates a new string containing the current time
-        //and the X and Y position of the visual feedback
-        QString val = QString::number(this->cursorController->x()) + "\t" +
-                QString::number(this->cursorController->y());
-        //Adds the string to the QVector "vData"
-        vData.push_back(val);
-
-        QPoint aux = QPoint(this->cursorController->x(),this->cursorController->y());
-        this->vectorMousePositions.push_back(aux);
-        //Every X ms, check if the cursor is stationary
-        if(this->vectorMousePositions.size() == this->samplesToStop)
+        this->lastSample = sample;
+        if(this->recording)
         {
-            //First mouse position
-            int x0 = this->vectorMousePositions.at(0).x();
-            int y0 = this->vectorMousePositions.at(0).y();
-            //Final mouse position
-            int xf = this->vectorMousePositions.at(this->samplesToStop-1).x();
-            int yf = this->vectorMousePositions.at(this->samplesToStop-1).y();
-            //If the difference is of one pixel or less, then the cursor is stationary
-            //The cursor should be stationary outside the origin as well
-            if(abs(xf-x0) <= 1 && abs(yf-y0) <= 1 && !this->objCursor->HasCollided(this->objOrigin))
-            {
-                this->feedbackCursorColor = Qt::blue;
-                qDebug() << QString::number(this->vectorMousePositions.at(0).x()) << " " << QString::number(this->vectorMousePositions.at(this->samplesToStop-1).x());
-                this->flagPerturbation = false;
-                this->flagRecord=false;
-                emit this->stop();
-                this->saveData();
-                this->vData.clear();
-            }
-            this->vectorMousePositions.clear();
+            this->trialLog->AddEvent(sample);
+            //Events out of order cannot be interpolated
+            if(!this->resampler->Push(sample, this->vGrid))
+                this->sampleBuffer->AddDropped(1);
         }
-    }    
-    //Releases the mutex
-    this->mutex->unlock();
+    }
+
+    //A new trial has started: the uniform grid starts at this tick
+    if(this->flagRecord && !this->recording)
+    {
+        this->recording = true;
+        this->trialStartTime = now;
+        this->resampler->Reset(now, this->lastSample);
+        this->acquisitionThread->timingStats()->Reset();
+        this->trialLog->Begin(this->sessionCounter, this->trialCounter+1, now);
+        this->movementEnd.Reset();
+        this->kinematics.Begin(now, this->targetX, this->targetY);
+        this->targetReached = false;
+    }
+
+    if(!this->recording)
+        return;
+
+    //The grid samples after the last event hold its position
+    //The most recent period is held back so that events that are still on
+    //their way can be interpolated
+    this->resampler->Advance(now - this->resampler->period(), this->vGrid);
+    for(int i=0; i<this->vGrid.size() && this->recording; i++)
+        this->processSample(this->vGrid.at(i));
+    this->vGrid.clear();
+}
+
+//Processes one sample of the uniform grid
+void ProtocolController::processSample(const CursorSample &_sample)
+{
+    //Adds the sample to the trial log, which streams it to the session file
+    this->trialLog->AddSample(_sample);
+
+    //Tests the visual feedback against the target of the trial
+    if(!this->targetReached && this->targetSet.Hits(_sample.x, _sample.y, 1ULL << this->currentTarget))
+    {
+        this->targetReached = true;
+        this->targetReachTime = _sample.timestamp;
+    }
+
+    //Reaction time, peak velocity, errors and path length
+    this->kinematics.Push(_sample);
+
+    //Checks on every sample whether the cursor has been stationary,
+    //outside the origin, for the whole dwell time
+    if(this->movementEnd.Push(_sample))
+    {
+        this->flagPerturbation = false;
+        //Writes the last blocks of the trial, then lets the GUI thread
+        //control the rest period
+        this->trialLog->End(*this->acquisitionThread->timingStats());
+        this->recording = false;
+        this->flagSaving = true;
+        this->flagRecord = false;
+        emit this->trialEnded();
+    }
 }
 
 //This timer serves to control the rest period between trials
@@ -300,26 +414,85 @@ void ProtocolController::timerRestTick()
     this->targetColor = Qt::red;
     //Paints the cursor back to green
     this->feedbackCursorColor = Qt::green;
+    //Shows the target of the next trial
+    this->prepareTrial();
+    this->m_frameScheduler->Invalidate();
 }
 
 //Updates the visual feedback of the cursor according to mouse position
 //If the perturbation is activated, then the visual feedback will be
 //deviated
-void ProtocolController::MouseMove()
+//The position comes from the input source, if there is one, or from the
+//mouse event. The position and the time of the event are taken together,
+//so the sample is not stamped with the time of an older position
+void ProtocolController::MouseMove(const QMouseEvent *_event)
+{
+    //Input read directly from a device: every pending report is processed
+    //with its own timestamp
+    if(this->cursorController->inputSource() != NULL)
+    {
+        qint64 timestamp;
+        while(this->cursorController->ReadInput(timestamp))
+            this->updateFeedback(timestamp);
+        return;
+    }
+
+    //Gets the X and Y coordinates of the cursor when the event happened
+    //(the system cursor if there is no event)
+    QPoint pos = _event != NULL ? _event->globalPos() : QCursor::pos();
+    this->cursorController->setRawPosition(pos.x(),pos.y());
+    this->updateFeedback(this->eventTime(_event != NULL ? _event->timestamp() : 0));
+}
+
+//Converts the timestamp of a mouse event (ms, window system clock)
+//to the monotonic clock (ns)
+//The event is always delivered after it happened, so the smallest delay
+//observed between the two clocks is the best estimate of their offset.
+//The estimate may creep up by 1 us per event to follow clock drift
+qint64 ProtocolController::eventTime(ulong _eventTimestamp)
 {
-    //Locks the mutex for acessing the "cursorController" object for setting
-    //the x and y position of the visual feedback cursor
-    this->mutex->lock();
+    qint64 now = MonotonicClock::Now();
+    if(_eventTimestamp == 0)
+        return now;
+
+    qint64 t = (qint64)_eventTimestamp * 1000000LL;
+    qint64 offset = now - t;
+    //First event or the window system clock jumped (more than 1 s)
+    if(!this->eventClockValid || qAbs(offset - this->eventClockOffset) > 1000000000LL)
+    {
+        this->eventClockOffset = offset;
+        this->eventClockValid = true;
+    }
+    else if(offset < this->eventClockOffset + 1000)
+        this->eventClockOffset = offset;
+    else
+        this->eventClockOffset += 1000;
+
+    return t + this->eventClockOffset;
+}
 
-    //Gets the X and Y coordinates of the cursor
-    this->cursorController->setX(QCursor::pos().x());
-    this->cursorController->setY(QCursor::pos().y());
+//Computes the visual feedback from the raw position of the cursor
+//and hands the new sample over to the sampling tick
+void ProtocolController::updateFeedback(qint64 _timestamp)
+{
+    CursorSample sample;
+    sample.timestamp = _timestamp;
+    sample.rawX = qRound(this->cursorController->rawX());
+    sample.rawY = qRound(this->cursorController->rawY());
     //Checks if the visual feedback should be perturbed
     //and updates it    
-    //The perturbation is given by the QVector "perturbationSession" that indicates
-    //whether a given session should be perturbed
-    if(this->flagPerturbation)
-        this->cursorController->RotatePoint(); //Applies rotation if required
+    //The perturbation of each trial is given by the protocol
+    //The schedule gives the matrix of the trial at this time (onset and
+    //onset ramp), so nothing is computed here
+    bool perturbed = this->flagPerturbation;
+    if(perturbed)
+    {
+        qint64 elapsed = _timestamp - this->perturbationStartTime;
+        const PerturbationSchedule::Trial &perturbation = this->currentTrial->perturbation;
+        this->cursorController->transform().stage<MatrixStage>() = this->perturbationSchedule.Matrix(perturbation, elapsed);
+        perturbed = perturbation.onset == 0 || elapsed >= perturbation.onset;
+    }
+    this->cursorController->UpdateFeedback(_timestamp, perturbed);
 
     //Checks if the cursor position is within the limits of the monitor
     //X-axis
@@ -333,8 +506,93 @@ void ProtocolController::MouseMove()
     else if(this->cursorController->y() > this->parent->height())
         this->cursorController->setY(this->parent->height());
 
-    //Releases the mutex
-    this->mutex->unlock();
+    //Hands the sample over to the sampling tick
+    //If the ring is full the sample is lost and counted as an overrun
+    sample.x = this->cursorController->x();
+    sample.y = this->cursorController->y();
+    this->sampleBuffer->Push(sample);
+
+    //Repaints if the feedback cursor has moved from where it was last drawn
+    //(the frame also checks whether it reached the origin or the target)
+    if(this->flagFeedback && (sample.x != this->scene.x(this->feedbackObject) ||
+                              sample.y != this->scene.y(this->feedbackObject)))
+    {
+        this->m_latencyTracker->InputEvent(_timestamp, this->now());
+        this->m_frameScheduler->Invalidate();
+    }
+}
+
+//Takes the descriptor of the trial that is about to start and moves its
+//target on the screen. Target and perturbation only depend on the number
+//of the trial in the experiment, so a resumed experiment continues the
+//same sequence
+void ProtocolController::prepareTrial()
+{
+    int trialIndex = this->trialCounter;
+    for(int i=0; i<this->sessionCounter-1; i++)
+        trialIndex += this->protocol.vSessions.at(i).trials;
+    //After the last trial the last descriptor is kept
+    if(trialIndex >= this->vTrials.size())
+        trialIndex = this->vTrials.size()-1;
+    this->currentTrial = &this->vTrials.at(trialIndex);
+    this->currentTarget = this->currentTrial->target;
+    this->targetX = this->targetSet.center(this->currentTarget).x();
+    this->targetY = this->targetSet.center(this->currentTarget).y();
+    this->scene.setPosition(this->targetObject, this->targetX, this->targetY);
+    //The error clamp points to the target of the trial
+    this->cursorController->transform().stage<ClampStage>().setDirection(this->targetX - this->originX,
+                                                                           this->targetY - this->originY);
+}
+
+//Simulated: the clock only moves when the caller advances it
+void ProtocolController::Advance(qint64 _time)
+{
+    this->virtualTime = _time;
+    if(this->resting && _time >= this->restEndTime)
+    {
+        this->resting = false;
+        this->timerRestTick();
+    }
+    this->timerTick();
+    //There is no event loop: the blocks of the tick are written at once
+    this->writePending();
+}
+
+qint64 ProtocolController::now() const
+{
+    return this->m_simulated ? this->virtualTime : MonotonicClock::Now();
+}
+
+//Moves the cursor to a raw position given by the caller
+void ProtocolController::MoveCursor(double _x, double _y, qint64 _timestamp)
+{
+    //Simulated: the events carry the virtual time
+    if(this->m_simulated && _timestamp > this->virtualTime)
+        this->virtualTime = _timestamp;
+    this->cursorController->setRawPosition(_x,_y);
+    this->updateFeedback(_timestamp);
+}
+
+//Called when the input device has new events
+void ProtocolController::inputReady()
+{
+    this->MouseMove();
+}
+
+//Writes the blocks, starts and ends of trials handed over by the
+//acquisition thread (the session file is only used on this thread)
+void ProtocolController::writePending()
+{
+    if(this->trialLog != NULL)
+        this->trialLog->WritePending();
+}
+
+//Called on the GUI thread when the acquisition thread detects the end of a trial
+void ProtocolController::finishTrial()
+{
+    this->feedbackCursorColor = Qt::blue;
+    this->saveData();
+    this->flagSaving = false;
 }
 
 //Method for saving the visual feedback motion
@@ -343,21 +601,98 @@ void ProtocolController::saveData()
     //Stops painting new positions from the cursor
     this->flagFeedback=false;
 
-    //Creates the filename
-    //Example: If subject name is "subject1", for session number one and trial number one
-    //datafile: subject1_1_1.txt
-    QString datafile = this->fileprefix + "_data_" +
-            QString::number(this->sessionCounter) +
-            "_" + QString::number(this->trialCounter+1) + ".txt";
-    //Creates a new instance of FileController to save data
-    this->fileController = new DataFileController(datafile.toStdString());
-    //Opening the file
-    this->fileController->Open();
-    //For each element in QVector "vData", writes it to file
-    for(int i=0; i<vData.size(); i++)
-        this->fileController->WriteData(vData.at(i)); //Retrieves the cursor sample
-    //Closes and saves the file
-    this->fileController->Close();
+    //Writes the last blocks and the timing of the trial, which the
+    //acquisition thread handed over when it ended (see TrialLog)
+    this->writePending();
+    //Samples lost in the handoff between mouse events and the sampling tick
+    //during this trial
+    quint64 overruns, dropped;
+    this->sampleBuffer->TakeCounters(overruns, dropped);
+    if(this->protocol.verbose)
+        qDebug() << "Trial" << this->trialCounter+1 << "samples:" << this->trialLog->samples()
+                 << "events:" << this->trialLog->events() << "overruns:" << overruns << "dropped:" << dropped;
+    //Reports how the I/O thread is keeping up with the writes
+    if(this->protocol.verbose)
+    {
+        AsyncWriter::Stats io = AsyncWriter::instance()->stats();
+        qDebug() << "Writer: bytes" << io.bytes << "max queue depth" << io.maxDepth
+                 << "stalls" << io.stalls << "stall time (ns)" << io.stallTime << "errors" << io.errors;
+    }
+    //Latency between the mouse and the screen during the trial, written
+    //next to the data of the trial
+    if(this->protocol.verbose)
+        qDebug() << "Latency:" << qPrintable(this->m_latencyTracker->Summary());
+    this->sessionFile->WriteText(this->sessionCounter, this->trialCounter+1, StreamLatency,
+                                 this->trialStartTime, this->m_latencyTracker->Report());
+    //Target of the trial and whether it was reached
+    QString info;
+    info += "Trial parameters\n";
+    info += "Target: " + QString::number(this->currentTarget+1) + "\n";
+    info += "Center of target in X: " + QString::number(this->targetX) + "\n";
+    info += "Center of target in Y: " + QString::number(this->targetY) + "\n";
+    const PerturbationSchedule::Trial &perturbation = this->currentTrial->perturbation;
+    info += QString("Perturbation: ") + (perturbation.perturbed ? "True" : "False") + "\n";
+    info += "Perturbation degree: " + QString::number(perturbation.perturbed ? perturbation.degrees : 0) + "\n";
+    info += QString("Catch trial: ") + (perturbation.catchTrial ? "True" : "False") + "\n";
+    info += "Perturbation onset (ms): " + QString::number(perturbation.onset / 1000000) + "\n";
+    info += QString("Feedback: ") + (this->currentTrial->feedback ? "True" : "False") + "\n";
+    info += QString("Target reached: ") + (this->targetReached ? "True" : "False") + "\n";
+    info += "Samples: " + QString::number(this->trialLog->samples()) + "\n";
+    info += "Input events: " + QString::number(this->trialLog->events()) + "\n";
+    info += "Input events lost because the buffer was full: " + QString::number(overruns) + "\n";
+    info += "Input events discarded by the sampling tick: " + QString::number(dropped) + "\n";
+    info += "Blocks lost between the acquisition and the file: " + QString::number(this->trialLog->lostBlocks()) + "\n";
+    if(this->targetReached)
+        info += "Time to reach the target (ns): " + QString::number(this->targetReachTime - this->trialStartTime) + "\n";
+    //The acquisition thread does not touch the detector until the next trial
+    info += "Path in the window of the end of the movement (pixels): " + QString::number(this->movementEnd.pathLength()) + "\n";
+    //Kinematic features, computed while the trial was recorded
+    TrialFeatures features = this->kinematics.Result();
+    features.session = this->sessionCounter;
+    features.trial = this->trialCounter+1;
+    features.target = this->currentTarget;
+    info += KinematicFeatures::Describe(features);
+    //Adaptation of the trial: rotation minus the initial direction error of
+    //the feedback; a trial without a movement interrupts the recursion
+    double rotation = perturbation.perturbed ? perturbation.degrees : 0;
+    AdaptationEstimator *models[3] = {&this->simpleModel, &this->singleStateModel, &this->twoStateModel};
+    for(int i=0; i<3; i++)
+    {
+        if(features.moved)
+            models[i]->Update(rotation, features.initialDirectionError, this->currentTrial->feedback);
+        else
+            models[i]->Skip();
+        info += models[i]->Describe();
+    }
+    this->sessionFile->WriteText(this->sessionCounter, this->trialCounter+1, StreamTrialInfo,
+                                 this->trialStartTime, info);
+    //How often the window was repainted since the previous trial, in its
+    //own stream: it depends on the machine, the trial information does not
+    QString frames = this->m_frameScheduler->Summary();
+    this->m_frameScheduler->ResetStats();
+    this->sessionFile->WriteText(this->sessionCounter, this->trialCounter+1, StreamFrames,
+                                 this->trialStartTime, frames);
+    if(this->protocol.verbose)
+        qDebug() << qPrintable(frames);
+    //Summary table of the session, rewritten after every trial
+    this->vSessionFeatures.append(features);
+    if(this->protocol.verbose)
+        qDebug() << "Features: RT (ms)" << features.reactionTime << "MT (ms)" << features.movementTime
+                 << "peak velocity" << features.peakVelocity << "initial error (deg)" << features.initialDirectionError
+                 << "endpoint error" << features.endpointError << "path" << features.pathLength;
+    AdaptationParameters adaptation;
+    if(this->protocol.verbose && this->singleStateModel.Estimate(adaptation))
+        qDebug() << "Single-state model: retention" << adaptation.retention << "learning rate" << adaptation.learningRate;
+    if(this->protocol.saveTextFiles)
+    {
+        QString summaryname = this->protocol.fileprefix + "_summary_" + QString::number(this->sessionCounter) + ".txt";
+        DataFileController summaryFile(summaryname.toStdString());
+        if(summaryFile.Open())
+        {
+            summaryFile.WriteData(KinematicFeatures::Table(this->vSessionFeatures));
+            summaryFile.Close();
+        }
+    }
 
     //Controlling the experiment
     //Increments the trial counter
@@ -365,18 +700,30 @@ void ProtocolController::saveData()
 
     //If the total number of trials for a given session have been performed, resets
     //the counter and increments the session counter
-    if(this->trialCounter >= this->numberTrialsperSession[this->sessionCounter-1])
+    if(this->trialCounter >= this->protocol.vSessions.at(this->sessionCounter-1).trials)
     {
         this->trialCounter=0;
         this->sessionCounter++;
+        this->vSessionFeatures.clear();
     }
 
     //If the total number of sessions have been performed
     //Finishes the experiment by presenting a QMessageBox and
     //closing the experiment window
-    if(this->sessionCounter > this->numberSessions)
+    if(this->sessionCounter > this->protocol.numberSessions())
     {
         this->sessionCounter--;
+        //Stops sampling, writes the trial index of the session file and
+        //waits until every file has reached the disk
+        this->acquisitionThread->Stop();
+        this->sessionFile->Close();
+        DataFileController::WaitForWrites();
+        //Simulated: the caller stops advancing the clock
+        if(this->m_simulated)
+        {
+            this->m_finished = true;
+            return;
+        }
         QMessageBox msgBox;
         msgBox.setText("The experiment has ended.");
         msgBox.exec();
@@ -384,13 +731,23 @@ void ProtocolController::saveData()
     }
 
     //Triggers the timer that controls the rest period
-    this->timerRest->start();
+    //(longer after the last trial of a session)
+    //Simulated: the rest ends when Advance() reaches its end
+    if(this->m_simulated)
+    {
+        this->restEndTime = this->now() + this->currentTrial->rest * 1000000LL;
+        this->resting = true;
+    }
+    else
+    {
+        this->timerRest->setInterval(this->currentTrial->rest);
+        this->timerRest->start();
+    }
     //Changes the target color to "Blue" indicating that
     //the target has been hit
     this->targetColor = Qt::blue;
     this->feedbackCursorColor = Qt::blue;
-    //Clears the QVector "vData" so it can store new visual feeddback samples
-    this->vData.clear();
+    this->m_frameScheduler->Invalidate();
 }
 
 bool ProtocolController::ExperimentIsRunning()
@@ -398,60 +755,207 @@ bool ProtocolController::ExperimentIsRunning()
     return this->flagExperiment;
 }
 
-//Creates the header file for the experiment
+//Creates the session file of the experiment, which starts with the header
 void ProtocolController::writeHeader()
 {
-    QString headername = fileprefix + "_header.txt";
-    this->fileController = new DataFileController(headername.toStdString());
-    if(this->fileController->Open())
+    QString header = "";
+
+    header += "Federal University of Uberlandia - Brazil\n";
+    header += "Biomedical Engineering Lab\n";
+    header += "---------------------------------------------\n";
+    header += "Visuomotor Adaptation Task\n";
+    header += "Date: " + QDate::currentDate().toString("dd/MM/yyyy")
+            + " - " + QTime::currentTime().toString() + "\n";
+    header += "---------------------------------------------\n";
+    header += "Details of the experiment\n";
+    header += "Protocol file: " + (this->protocol.path.isEmpty() ? QString("none (defaults)") : this->protocol.path) + "\n";
+    header += "Number of sessions: " + QString::number(this->protocol.numberSessions()) + "\n";        
+    header += "Sampling frequency (Hz): " + QString::number(this->protocol.samplingFrequency) + "\n";
+    header += "Session file (_session.dat): for each trial, samples at the sampling frequency,\n";
+    header += "every input event (time in ns, raw X, raw Y, feedback X, feedback Y) and the timing report\n";
+    header += "Samples are streamed in blocks of " + QString::number(this->blockSamples) + " samples";
+    header += QString(this->compressSamples ? " (compressed)" : "") + "\n";
+    if(this->m_simulated)
+        header += "Input: MoveCursor() on a virtual clock (simulation or replay)\n";
+    else if(this->cursorController->inputSource() == NULL)
+        header += "Input: system cursor\n";
+    else if(!this->protocol.inputDevice.isEmpty())
+        header += "Input: " + this->protocol.inputDevice + " (gain " + QString::number(this->protocol.inputGain) + " pixels/count)\n";
+    else
+        header += "Input: replay of " + this->protocol.inputReplayFile + "\n";
+    header += "Monitor width (pixels): " + QString::number(this->parent->geometry().width()) + "\n";
+    header += "Monitor height (pixels): " + QString::number(this->parent->geometry().height()) + "\n";
+    header += "Monitor refresh rate (Hz): " + QString::number(this->m_frameScheduler->refreshRate()) + "\n";
+    header += "---------------------------------------------\n";
+    header += "Details of the sessions\n";
+    header += "Number of trials: ";
+    for(int i=0; i<this->protocol.numberSessions(); i++)
+    {
+        header += QString::number(this->protocol.vSessions.at(i).trials) + "; ";
+    }
+    header += "\nPerturbation of each session: ";
+    for(int i=0; i<this->protocol.numberSessions(); i++)
+    {
+        if(this->protocol.vSessions.at(i).perturbation.type != PerturbationSchedule::NoPerturbation)
+            header += "True; ";
+        else
+            header += "False; ";
+    }
+    header += "\nFeedback of each session: ";
+    for(int i=0; i<this->protocol.numberSessions(); i++)
+        header += QString(this->protocol.vSessions.at(i).feedback ? "True; " : "False; ");
+    header += "\nRest after each trial and after the session (ms): ";
+    for(int i=0; i<this->protocol.numberSessions(); i++)
+        header += QString::number(this->protocol.vSessions.at(i).rest) + ", " +
+                QString::number(this->protocol.vSessions.at(i).sessionBreak) + "; ";
+    header += "\n";
+    header += "Perturbation schedule\n" + this->perturbationSchedule.Describe();
+    header += "Perturbation gain: " + QString::number(this->protocol.perturbationGain) + "\n";
+    header += "Mirror reversal: " + (this->protocol.perturbationMirror ? "axis at " + QString::number(this->protocol.mirrorAxisDegree) + " degrees" : QString("False")) + "\n";
+    header += "Curl field (s): " + QString::number(this->protocol.perturbationCurl) + "\n";
+    header += "Offset in X and Y (pixels): " + QString::number(this->protocol.perturbationOffsetX) + ", " + QString::number(this->protocol.perturbationOffsetY) + "\n";
+    header += "Error clamp: " + QString(this->protocol.errorClamp ? "True" : "False") + "\n";
+    header += "Order of the transforms: error clamp, gain, mirror, rotation, curl field, offset\n";
+    header += "---------------------------------------------\n";        
+    header += "Task parameters\n";
+    header += "-------------------------------------\n";
+    header += "Origin\n";
+    header += "Center of Origin in X: " + QString::number(this->scene.x(this->originObject)) + "\n";
+    header += "Center of Origin in Y: " + QString::number(this->scene.y(this->originObject)) + "\n";
+    header += "Origin width: " + QString::number(this->protocol.objWidth) + "\n";
+    header += "Origin height: " + QString::number(this->protocol.objHeight) + "\n";
+    header += "-------------------------------------\n";
+    header += "Target paradigm: " + QString(this->protocol.targetParadigm == TargetSet::SingleTarget ? "Single target" :
+                                            this->protocol.targetParadigm == TargetSet::CenterOut ? "Center-out" :
+                                            "Random target") + "\n";
+    header += "Number of targets: " + QString::number(this->targetSet.count()) + "\n";
+    header += "Center of target in X: " + QString::number(this->targetSet.center(0).x()) + "\n";
+    header += "Center of target in Y: " + QString::number(this->targetSet.center(0).y()) + "\n";
+    header += "Targets (X, Y): ";
+    for(int i=0; i<this->targetSet.count(); i++)
+        header += QString::number(this->targetSet.center(i).x()) + ", " +
+                QString::number(this->targetSet.center(i).y()) + "; ";
+    header += "\n";
+    header += "Target hit radius: " + QString::number(this->targetSet.radius(0)) + "\n";
+    if(this->protocol.targetParadigm == TargetSet::RandomTarget)
+        header += "Target order seed: " + QString::number(this->protocol.targetSeed) + "\n";
+    header += "Target width: " + QString::number(this->protocol.objWidth) + "\n";
+    header += "Target height: " + QString::number(this->protocol.objHeight) + "\n";
+    header += "-------------------------------------\n";
+    header += "End of the movement\n";
+    header += "Samples without movement: " + QString::number(this->movementEnd.window()) + " (sliding window)\n";
+    header += "Largest mean speed (pixels/s): " + QString::number(this->movementEnd.speedThreshold()) + "\n";
+    header += "Smallest distance from the origin (pixels): " + QString::number(this->movementEnd.originDistance()) + "\n";
+    header += "-------------------------------------\n";
+    header += "Kinematic features\n";
+    header += "Onset speed (pixels/s): " + QString::number(this->kinematics.onsetSpeed()) + "\n";
+    header += "Features of each trial: reaction time, movement time, peak velocity, initial direction error at the peak velocity, endpoint error and path length of the visual feedback\n";
+    header += "-------------------------------------\n";
+    header += "Adaptation models\n";
+    header += "Simple, single-state and two-state models (script_models.m), fitted by least squares after every trial\n";
+    header += "Adaptation of each trial: rotation minus the initial direction error of the visual feedback\n";
+    header += "Delay of the error (trials): simple " + QString::number(this->simpleModel.delay()) + ", single-state " +
+            QString::number(this->singleStateModel.delay()) + ", two-state " + QString::number(this->twoStateModel.delay()) + "\n";
+    header += "-------------------------------------\n";
+    header += "Acquisition timing\n";
+    header += "Sampling period (ns): " + QString::number(this->acquisitionThread->period()) + "\n";
+    header += "Real-time scheduling (SCHED_FIFO): " + QString(this->protocol.realtimeAcquisition ? "True" : "False") + "\n";
+    header += "Acquisition CPU: " + QString::number(this->protocol.acquisitionCpu) + "\n";
+    header += "Timing report: latency and jitter histograms and the ticks that woke up more than half a period late\n";
+    header += "Trials are flagged if a deadline was missed or a tick was more than half a period late\n";
+    header += "-------------------------------------\n";
+    header += "Display latency\n";
+    header += "Latency report: input event to the flush of the frame that shows it, for each trial\n";
+    header += "Frame report: frames painted, coalesced requests, paint time and CPU of the GUI thread, for each trial\n";
+    header += "Photodiode patch: " + QString(this->protocol.photodiodePatch ? "True" : "False") + "\n";
+    if(this->protocol.photodiodePatch)
+        header += "Photodiode patch (pixels): " + QString::number(this->protocol.photodiodeSize) +
+                "x" + QString::number(this->protocol.photodiodeSize) + " at the bottom-left corner\n";
+    header += "-------------------------------------\n";
+
+    //The header is the first block of the session file
+    QString sessionname = this->protocol.fileprefix + "_session.dat";
+    this->sessionFile = new SessionFileWriter(sessionname.toStdString());
+    this->sessionFile->setCompression(this->compressSamples);
+    bool resumed = false;
+    int session, trial;
+    if(this->protocol.resumeSession && QFile::exists(sessionname))
     {
-        QString header = "";
-
-        header += "Federal University of Uberlandia - Brazil\n";
-        header += "Biomedical Engineering Lab\n";
-        header += "---------------------------------------------\n";
-        header += "Visuomotor Adaptation Task\n";
-        header += "Date: " + QDate::currentDate().toString("dd/MM/yyyy")
-                + " - " + QTime::currentTime().toString() + "\n";
-        header += "---------------------------------------------\n";
-        header += "Details of the experiment\n";
-        header += "Number of sessions: " + QString::number(this->numberSessions) + "\n";        
-        header += "Sampling frequency (Hz): " + QString::number(this->samplingFrequency) + "\n";
-        header += "Monitor width (pixels): " + QString::number(this->parent->geometry().width()) + "\n";
-        header += "Monitor height (pixels): " + QString::number(this->parent->geometry().height()) + "\n";
-        header += "---------------------------------------------\n";
-        header += "Details of the sessions\n";
-        header += "Number of trials: ";
-        for(int i=0; i<this->numberSessions; i++)
+        //A finished experiment is never continued, and a file that cannot
+        //be read (damaged, older version) is never overwritten
+        bool finished = false;
+        if(this->sessionFile->Load() && this->sessionFile->LastCompleteTrial(session, trial))
+            finished = session >= this->protocol.numberSessions() &&
+                    trial >= this->protocol.vSessions.last().trials;
+        if(!finished)
+            resumed = this->sessionFile->Resume();
+        if(!resumed)
         {
-            header += QString::number(this->numberTrialsperSession[i]) + "; ";
+            //The data of this run are saved with the next free prefix
+            QString prefix = this->protocol.fileprefix;
+            int number = 2;
+            while(QFile::exists(prefix + "_" + QString::number(number) + "_session.dat"))
+                number++;
+            this->protocol.fileprefix = prefix + "_" + QString::number(number);
+            QString message = sessionname + (finished ? " is a finished experiment" : " cannot be continued") +
+                    ": the data are saved to " + this->protocol.fileprefix + "_session.dat";
+            qDebug() << message;
+            if(!this->m_simulated)
+            {
+                QMessageBox msgBox;
+                msgBox.setText(message);
+                msgBox.exec();
+            }
+            sessionname = this->protocol.fileprefix + "_session.dat";
+            delete this->sessionFile;
+            this->sessionFile = new SessionFileWriter(sessionname.toStdString());
+            this->sessionFile->setCompression(this->compressSamples);
         }
-        header += "\nPerturbation of each session: ";
-        for(int i=0; i<this->numberSessions; i++)
+    }
+    if(resumed)
+    {
+        //Continues after the last trial that was completely written
+        //A trial that was interrupted is recorded again
+        if(this->sessionFile->LastCompleteTrial(session, trial))
         {
-            if(this->perturbationSession[i])
-                header += "True; ";
-            else
-                header += "False; ";
+            this->sessionCounter = session;
+            this->trialCounter = trial;
+            if(this->trialCounter >= this->protocol.vSessions.at(this->sessionCounter-1).trials &&
+                    this->sessionCounter < this->protocol.numberSessions())
+            {
+                this->trialCounter = 0;
+                this->sessionCounter++;
+            }
+        }
+        qDebug() << "Resuming" << sessionname << "(run" << this->sessionFile->run()
+                 << ") at session" << this->sessionCounter << "trial" << this->trialCounter+1;
+    }
+    else if(!this->sessionFile->Open(header))
+        qDebug() << "Could not create the session file" << sessionname;
+
+    //The acquisition thread hands the trials over to this thread, which
+    //writes them to the session file
+    this->trialLog = new TrialLog(this->sessionFile, this->blockSamples);
+    if(this->protocol.saveTextFiles)
+        this->trialLog->setTextPrefix(this->protocol.fileprefix);
+    //Simulated: written after every tick (see Advance())
+    if(!this->m_simulated)
+    {
+        this->writeTimer = new QTimer(this);
+        this->writeTimer->setInterval(this->writeInterval);
+        connect(this->writeTimer,SIGNAL(timeout()),this,SLOT(writePending()));
+        this->writeTimer->start();
+    }
+
+    //Header file of the previous versions
+    if(this->protocol.saveTextFiles && !resumed)
+    {
+        QString headername = this->protocol.fileprefix + "_header.txt";
+        this->fileController = new DataFileController(headername.toStdString());
+        if(this->fileController->Open())
+        {
+            this->fileController->WriteData(header);
+            this->fileController->Close();
         }
-        header += "\n";
-        header += "Perturbation degree: " + QString::number(this->perturbationDegree) + "\n";
-        header += "---------------------------------------------\n";        
-        header += "Task parameters\n";
-        header += "-------------------------------------\n";
-        header += "Origin\n";
-        header += "Center of Origin in X: " + QString::number(this->objOrigin->point->x()) + "\n";
-        header += "Center of Origin in Y: " + QString::number(this->objOrigin->point->y()) + "\n";
-        header += "Origin width: " + QString::number(this->objWidth) + "\n";
-        header += "Origin height: " + QString::number(this->objHeight) + "\n";
-        header += "-------------------------------------\n";
-        header += "Number of targets: " + QString::number(this->numberTargets) + "\n";
-        header += "Center of target in X: " + QString::number(this->objTarget->point->x()) + "\n";
-        header += "Center of target in Y: " + QString::number(this->objTarget->point->y()) + "\n";
-        header += "Target width: " + QString::number(this->objWidth) + "\n";
-        header += "Target height: " + QString::number(this->objHeight) + "\n";
-        header += "-------------------------------------\n";
-        this->fileController->WriteData(header);
-        this->fileController->Close();
     }
 }
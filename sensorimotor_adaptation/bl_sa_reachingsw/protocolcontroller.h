@@ -16,17 +16,34 @@
 #include <QWidget>
 #include <QPainter>
 #include <QCursor> //Handles the mouse cursor
+#include <QMouseEvent> //Position and time of the mouse events
 #include <QDate> //Date functions
 #include <QTime> //Clock time functions
 #include <QThread> //Handles multi-threading
-#include <QMutex> //Handles multi-threading
-#include <QTimer> //Timer for saving data
-#include <QMutex> //Necessary for handling multiple acess
+#include <QTimer> //Timer for the rest period
+#include <atomic> //Flags shared with the acquisition thread
 #include <QVector> //Dynamic array
 #include <QMessageBox> //Display a messagebox on the screen
+#include <QSocketNotifier> //Notifies when the input device has data
 #include "datafilecontroller.h" //Imports the class that saves the experiment data
 #include "cursorcontroller.h" //Handles the mouse cursor
-#include "guiobject.h" //Defines the objects to be drawn in the GUI
+#include "scenestore.h" //Objects to be drawn in the GUI
+#include "targetset.h" //Targets of the task and the collision test
+#include "perturbationschedule.h" //Perturbation of each trial
+#include "protocolcompiler.h" //Protocol loaded from a file
+#include "samplebuffer.h" //Lock-free handoff of cursor samples
+#include "monotonicclock.h" //Monotonic timestamps
+#include "acquisitionthread.h" //Fixed-period sampling thread
+#include "evdevinputsource.h" //Mouse read directly from /dev/input
+#include "replayinputsource.h" //Movements replayed from a file
+#include "resampler.h" //Events to uniform sampling grid
+#include "sessionfilewriter.h" //Single binary file per experiment
+#include "triallog.h" //Streams the trial being recorded to the session file
+#include "framescheduler.h" //Repaints the window only when something has changed
+#include "latencytracker.h" //Latency between the mouse and the screen
+#include "movementenddetector.h" //End of the movement of each trial
+#include "kinematicfeatures.h" //Reaction time, peak velocity and errors of each trial
+#include "adaptationestimator.h" //Adaptation models fitted during the experiment
 
 
 class ProtocolController : public QObject
@@ -36,81 +53,173 @@ class ProtocolController : public QObject
 public:
     //-----------------------------------------------------------------
     //Constructors
-    ProtocolController(QWidget *p);
+    ProtocolController(QWidget *p, const ProtocolDefinition &_protocol = ProtocolDefinition());
     ~ProtocolController();
     //-----------------------------------------------------------------
     //-----------------------------------------------------------------
     //Methods    
     //Method that updates what needs to be drawn in the GUI
-    QVector<GUIObject*> updateGUI();
+    const SceneStore& updateGUI();
     //Mouse movement event
-    void MouseMove();
+    //_event: the mouse event, whose position and time are used together
+    //NULL when there is no event (input device): the device is read
+    void MouseMove(const QMouseEvent *_event = NULL);
     //Initialize the protocol
     void Initialize();
     //Method that indicates that the experiment should start
     void BeginExperiment();
     bool ExperimentIsRunning();
+    //Stops sampling and writes the blocks handed over so far
+    //Called when the window is closed, before the controller is deleted
+    void Stop();
+    //Moves the cursor to a raw position, as a mouse event would
+    //Drives the protocol without a mouse (headless rendering, simulation)
+    void MoveCursor(double _x, double _y, qint64 _timestamp);
+    //Decides when the window is repainted (created by Initialize())
+    FrameScheduler* frameScheduler()
+    {
+        return this->m_frameScheduler;
+    }
+    //Latency between the input events and the frames (created by Initialize())
+    LatencyTracker* latencyTracker()
+    {
+        return this->m_latencyTracker;
+    }
+    //Headless: Initialize() only builds the objects of the task, without
+    //input devices, session file or sampling (must be set before Initialize())
+    void setHeadless(bool headless)
+    {
+        m_headless = headless;
+    }
+    bool headless() const
+    {
+        return m_headless;
+    }
+    //Simulated: the task runs on a virtual clock moved by Advance() and the
+    //cursor is moved by MoveCursor(), without input devices, acquisition
+    //thread or rest timer. Everything is recorded as in an experiment
+    //(must be set before Initialize(), see bl_sa_simulate)
+    void setSimulated(bool simulated)
+    {
+        m_simulated = simulated;
+    }
+    bool simulated() const
+    {
+        return m_simulated;
+    }
+    //Simulated: moves the virtual clock to _time (ns), ends the rest period
+    //if it is over and runs the sampling tick
+    void Advance(qint64 _time);
+    //Simulated: the last trial has been saved
+    bool finished() const
+    {
+        return m_finished;
+    }
+    //A trial is being recorded (from the origin to the end of the movement)
+    bool trialRunning() const
+    {
+        return this->flagRecord;
+    }
+    //Position of the visual feedback and whether it is shown
+    QPoint feedbackPosition() const
+    {
+        return QPoint(this->cursorController->x(), this->cursorController->y());
+    }
+    bool feedbackVisible() const
+    {
+        return this->flagFeedback && this->currentTrial->feedback;
+    }
+    //Centers of the origin and of the target (set by Initialize())
+    QPoint originPosition() const
+    {
+        return QPoint(this->originX, this->originY);
+    }
+    QPoint targetPosition() const
+    {
+        return QPoint(this->targetX, this->targetY);
+    }
+    //Single-state model fitted to the trials saved so far
+    const AdaptationEstimator& singleStateFit() const
+    {
+        return this->singleStateModel;
+    }
     //-----------------------------------------------------------------
     //-----------------------------------------------------------------
 
 
 public slots:
-    void timerTick(); //Method evoked by the timer    
+    void timerTick(); //Method evoked by the acquisition thread
     void timerRestTick(); //Method evoked by the timer that counts rest between trials
+    void finishTrial(); //Saves the trial that has just ended (GUI thread)
+    void inputReady(); //Method evoked when the input device has new events
+    void writePending(); //Writes the blocks handed over by the acquisition thread
 
 signals:
-    //Starts the timer
-    void start();
-    //Stops the timer
-    void stop();
+    //Emitted by the acquisition thread when a trial has ended
+    void trialEnded();
 
 private:
     //Consts
-    //Sampling frequency (Hz)
-    const int samplingFrequency = 100;
-    //Total number of trials
-    const int numberTrials = 50;
-    //Total number of sessions
-    const int numberSessions = 4;
-    //Number of targets
-    const int numberTargets = 1;
-    //Distance from center to target
-    const int distanceTarget = 320;
-    //Height of the target
-    const int objHeight = 40;
-    //Width of the target
-    const int objWidth = 40;
-    const int cursorWidth = 15;
-    const int cursorHeight = 15;
-    const int samplesToStop = 50; //500 ms
-    //Defines the session
-    const bool perturbation = true;
-    const int perturbationDegree = -40;
-    const int restInterval = 1500; //ms
-    QVector<int> numberTrialsperSession;
-    QVector<bool> perturbationSession;
-    QVector<bool> vectorCursorFeedback;    
-    QVector<QPoint> vectorMousePositions;
+    //Capacity of the ring between mouse events and the sampling tick
+    //Enough for 8 kHz mice with the tick delayed by more than 100 ms
+    const int sampleBufferSize = 1024;
+    //Samples per block of the session file
+    //A crash loses at most one block of each stream (2.56 s at 100 Hz)
+    const int blockSamples = 256;
+    //Interval at which the GUI thread writes the completed blocks (ms)
+    //A crash also loses the blocks handed over in the last interval
+    const int writeInterval = 100;
+    //Compresses the sample blocks (delta + bit-packing, see TrajectoryCodec)
+    const bool compressSamples = true;
+    //Parameters of the experiment (see ProtocolCompiler)
+    ProtocolDefinition protocol;
+    //Every trial of the experiment, compiled by Initialize()
+    QVector<TrialDescriptor> vTrials;
     int okcont = 0;
-    //Filename prefix
-    const QString fileprefix = "andrei_mesa_piloto1";
     //Objects
     QWidget *parent;
-    DataFileController *fileController;
-    CursorController *cursorController;
-    QMutex *mutex;
-    QTimer *timer;
-    QTimer *timerRest;
-    QThread *workerThread;
-    GUIObject *objTarget;
-    GUIObject *objOrigin;
-    GUIObject *objFeedbackCursor;
-    GUIObject *objCursor;
+    DataFileController *fileController = NULL;
+    SessionFileWriter *sessionFile = NULL;
+    TrialLog *trialLog = NULL;
+    FrameScheduler *m_frameScheduler = NULL;
+    LatencyTracker *m_latencyTracker = NULL;
+    CursorController *cursorController = NULL;
+    SampleBuffer *sampleBuffer = NULL;
+    //Last sample received from the mouse events
+    CursorSample lastSample;
+    AcquisitionThread *acquisitionThread = NULL;
+    InputSource *inputSource = NULL;
+    QSocketNotifier *inputNotifier = NULL;
+    QTimer *inputPollTimer = NULL;
+    QTimer *timerRest = NULL;
+    QTimer *writeTimer = NULL;
+    //Objects drawn in the window and their indices
+    SceneStore scene;
+    int originObject;
+    int targetObject;
+    int cursorObject;
+    int feedbackObject;
+    int photodiodeObject;
+    //Targets and the target of the current trial
+    TargetSet targetSet;
+    int currentTarget = 0;
+    //Perturbation of every trial
+    PerturbationSchedule perturbationSchedule;
+    //Descriptor of the current trial
+    const TrialDescriptor *currentTrial = NULL;
+    //Time the current trial started on the GUI thread (monotonic, ns)
+    qint64 perturbationStartTime = 0;
     QColor targetColor;
     QColor feedbackCursorColor;
     //Methods    
     void writeHeader();
     void saveData();    
+    void updateFeedback(qint64 _timestamp);
+    qint64 eventTime(ulong _eventTimestamp);
+    void processSample(const CursorSample &_sample);
+    void prepareTrial();
+    //Monotonic time, or the virtual time when simulated (ns)
+    qint64 now() const;
     //Properties    
     int centerX;
     int centerY;
@@ -120,12 +229,46 @@ private:
     int targetY;
     int trialCounter;
     int sessionCounter;
-    bool flagPerturbation = false;
-    bool flagRecord = false;
+    //Flags shared between the GUI and the acquisition threads
+    std::atomic<bool> flagPerturbation{false};
+    std::atomic<bool> flagRecord{false};
+    std::atomic<bool> flagSaving{false};
     bool initialized = false;
+    bool m_headless = false;
+    bool m_simulated = false;
+    bool m_finished = false;
+    //Simulated: virtual time and end of the rest period (ns)
+    qint64 virtualTime = 0;
+    bool resting = false;
+    qint64 restEndTime = 0;
     bool flagFeedback = true;    
     bool flagExperiment = false;
-    QVector<QString> vData;
+    //Grid samples produced by the resampler in the current tick
+    QVector<CursorSample> vGrid;
+    Resampler *resampler = NULL;
+    //Acquisition thread only: a trial is being recorded
+    bool recording = false;
+    //Monotonic time of the first grid sample of the trial
+    qint64 trialStartTime = 0;
+    //Acquisition thread only: end of the movement
+    MovementEndDetector movementEnd;
+    //Acquisition thread only: kinematic features of the trial
+    KinematicFeatures kinematics;
+    //Features of the trials of the current session, for the summary table
+    QVector<TrialFeatures> vSessionFeatures;
+    //Models of script_models.m, fitted to the trials of the experiment
+    //after each one (rate and retention of the subject, live), with the
+    //delay of the error of the script
+    AdaptationEstimator simpleModel{AdaptationModel::Simple, AdaptationModel::ScriptDelay(AdaptationModel::Simple)};
+    AdaptationEstimator singleStateModel{AdaptationModel::SingleState,
+                                         AdaptationModel::ScriptDelay(AdaptationModel::SingleState)};
+    AdaptationEstimator twoStateModel{AdaptationModel::TwoState, AdaptationModel::ScriptDelay(AdaptationModel::TwoState)};
+    //The visual feedback has entered the target, and when
+    bool targetReached = false;
+    qint64 targetReachTime = 0;
+    //Offset between the mouse event clock and the monotonic clock
+    qint64 eventClockOffset = 0;
+    bool eventClockValid = false;
 };
 
 #endif // PROTOCOLCONTROLLER_H
@@ -19,51 +19,62 @@
 #include "reachingwindow.h"
 #include "ui_reachingwindow.h"
 #include "protocolcontroller.h"
+#include "scenerenderer.h"
 
 bool flag = true;
 
-ReachingWindow::ReachingWindow(QWidget *parent) :
+ReachingWindow::ReachingWindow(QWidget *parent, const ProtocolDefinition &_protocol) :
     QWidget(parent),
+    protocolController(NULL),
     ui(new Ui::ReachingWindow)
 {
     ui->setupUi(this);
 
     //Creates a new instance of the ProtocolController class
-    protocolController = new ProtocolController(this);
+    protocolController = new ProtocolController(this, _protocol);
 }
 
 ReachingWindow::~ReachingWindow()
 {
+    //Joins the acquisition thread and closes the session file
+    //The events sent while it is deleted no longer reach it
+    ProtocolController *controller = protocolController;
+    protocolController = NULL;
+    delete controller;
     delete ui;
 }
 
+//The frames requested with update() are painted and flushed to the window
+//system while the update request is handled, so the end of the request is
+//the time at which the frame was handed over for display
+//Events are also sent before the controller exists (setupUi, constructor
+//of the controller) and while it is deleted
+bool ReachingWindow::event(QEvent *e)
+{
+    bool result = QWidget::event(e);
+    if(e->type() == QEvent::UpdateRequest && this->protocolController != NULL)
+    {
+        LatencyTracker *latencyTracker = this->protocolController->latencyTracker();
+        if(latencyTracker != NULL)
+            latencyTracker->FrameFlushed(MonotonicClock::Now());
+    }
+    return result;
+}
+
 void ReachingWindow::paintEvent(QPaintEvent *e)
 {
     this->protocolController->Initialize();
+    FrameScheduler *frameScheduler = this->protocolController->frameScheduler();
+    frameScheduler->BeginFrame();
 
-    //Painter
+    //Draws the objects of the task
     QPainter painter(this);
-    QVector<GUIObject*> vGUIObjects = this->protocolController->updateGUI();
-    for(int i=0; i<vGUIObjects.size(); i++)
-    {        
-        painter.setPen(*vGUIObjects.at(i)->pen);
-        painter.setBrush(vGUIObjects.at(i)->pen->color());
-        switch(vGUIObjects.at(i)->type)
-        {
-            case GUIObject::Ellipse:            
-            painter.drawEllipse(*vGUIObjects.at(i)->point,
-                                vGUIObjects.at(i)->width,vGUIObjects.at(i)->height);
-            break;
-
-        case GUIObject::Rectangle:
-            painter.drawRect((int)vGUIObjects.at(i)->point->x(),
-                             (int)vGUIObjects.at(i)->point->y(),
-                                vGUIObjects.at(i)->width,vGUIObjects.at(i)->height);
-            break;
-        }
-    }
+    SceneRenderer::Render(&painter, this->protocolController->updateGUI());
+    this->protocolController->latencyTracker()->PaintEnded(MonotonicClock::Now());
 
-    update();
+    //The next frame is requested by the protocol when something changes
+    //(see FrameScheduler)
+    frameScheduler->EndFrame();
 }
 
 void ReachingWindow::mousePressEvent(QMouseEvent *e)
@@ -77,7 +88,15 @@ void ReachingWindow::mousePressEvent(QMouseEvent *e)
 
 void ReachingWindow::mouseMoveEvent(QMouseEvent *e)
 {
-    this->protocolController->MouseMove();
+    this->protocolController->MouseMove(e);
+}
+
+//The acquisition thread is stopped as soon as the window is closed
+//(by the user or at the end of the experiment)
+void ReachingWindow::closeEvent(QCloseEvent *e)
+{
+    this->protocolController->Stop();
+    QWidget::closeEvent(e);
 }
 
 void ReachingWindow::experimentFinished()
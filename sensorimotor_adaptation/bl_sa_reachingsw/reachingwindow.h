@@ -17,6 +17,7 @@
 #include <QWidget>
 #include <QCursor> //Keeps track of the position of the cursor
 #include <QMouseEvent> //Mouse Events for handling the visual feedback
+#include <QCloseEvent> //Stops the acquisition when the window is closed
 #include <QPainter> //Painter to draw the visual feedback of the task
 #include "protocolcontroller.h" //Imports the class that manages the protocol
 #include "guiobject.h" //Class that manages the objects to be drawn
@@ -32,16 +33,18 @@ class ReachingWindow : public QWidget
 
 public:
     //Constructor
-    explicit ReachingWindow(QWidget *parent = 0);
+    explicit ReachingWindow(QWidget *parent = 0, const ProtocolDefinition &_protocol = ProtocolDefinition());
     ~ReachingWindow();
 
     //Objects
     ProtocolController *protocolController;
 
     //Methods
+    bool event(QEvent *e); //Detects when a frame has been flushed
     void paintEvent(QPaintEvent *e); //Paint Event
     void mousePressEvent(QMouseEvent *e); //Mouse press event
     void mouseMoveEvent(QMouseEvent *e); //Mouse Move Event    
+    void closeEvent(QCloseEvent *e); //Stops the acquisition when the window is closed
     void experimentFinished(); //Method called when the experiment has finished
 
     //Properties
@@ -0,0 +1,280 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Headless benchmark of the stimulus pipeline. Runs the
+ * protocol without a display (offscreen platform, ProtocolController in
+ * headless mode), moves the cursor along a synthetic stream and renders
+ * every frame into a QImage with the code used by the task window
+ * (ProtocolController::updateGUI() + SceneRenderer).
+ * Reports the time and the heap allocations of each frame (the scene update
+ * must not allocate: the benchmark fails if it does), and the CRC of every
+ * frame, which can be saved as a reference and checked later to
+ * find frames whose pixels have changed.
+ * Usage: bl_sa_renderbench [-frames N] [-stream reach|circle|random]
+ *                          [-save reference.txt] [-check reference.txt]
+ *                          [-protocol file]
+ * ----------------------------------------------------------------------------
+*/
+
+#include <QApplication>
+#include <QWidget>
+#include <QImage>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QVector>
+#include <QtMath>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <algorithm>
+#include "protocolcontroller.h"
+#include "protocolcompiler.h"
+#include "scenerenderer.h"
+#include "sessionformat.h" //SessionChecksum
+#include "monotonicclock.h"
+
+//Heap allocations, counted only while a frame is produced
+static std::atomic<bool> countAllocations(false);
+static std::atomic<quint64> allocations(0);
+static std::atomic<quint64> allocatedBytes(0);
+
+void* operator new(size_t _size)
+{
+    if(countAllocations.load(std::memory_order_relaxed))
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(_size, std::memory_order_relaxed);
+    }
+    void *p = malloc(_size > 0 ? _size : 1);
+    if(p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t _size)
+{
+    return operator new(_size);
+}
+
+void operator delete(void *_p) noexcept
+{
+    free(_p);
+}
+
+void operator delete[](void *_p) noexcept
+{
+    free(_p);
+}
+
+//Raw cursor positions of the synthetic stream, one per frame
+//reach: center-out reaches with a minimum-jerk profile, 1 s each way
+//circle: the cursor circles the origin once per second
+//random: random walk (fixed seed)
+static QVector<QPointF> GenerateStream(const QString &_stream, int _frames, int _rate,
+                                       QPoint _origin, QPoint _target)
+{
+    QVector<QPointF> positions;
+    positions.reserve(_frames);
+    srand(1);
+    double x = _origin.x();
+    double y = _origin.y();
+    for(int i=0; i<_frames; i++)
+    {
+        if(_stream == "circle")
+        {
+            double angle = 2 * M_PI * i / _rate;
+            double radius = 0.5 * (_origin.y() - _target.y());
+            x = _origin.x() + radius * qSin(angle);
+            y = _origin.y() - radius * (1 - qCos(angle));
+        }
+        else if(_stream == "random")
+        {
+            x += (rand() % 11) - 5;
+            y += (rand() % 11) - 5;
+        }
+        else
+        {
+            int step = i % (2 * _rate);
+            double tau = (double)(step % _rate) / _rate;
+            double s = 10*qPow(tau,3) - 15*qPow(tau,4) + 6*qPow(tau,5);
+            if(step >= _rate)
+                s = 1 - s;
+            x = _origin.x() + s * (_target.x() - _origin.x());
+            y = _origin.y() + s * (_target.y() - _origin.y());
+        }
+        positions.push_back(QPointF(x, y));
+    }
+    return positions;
+}
+
+int main(int argc, char *argv[])
+{
+    //No display is needed unless another platform is chosen
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    int frames = 10000;
+    QString stream = "reach";
+    QString saveFile;
+    QString checkFile;
+    QString protocolFile;
+    QStringList arguments = a.arguments();
+    for(int i=1; i<arguments.size(); i++)
+    {
+        if(arguments.at(i) == "-frames" && i+1 < arguments.size())
+            frames = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-stream" && i+1 < arguments.size())
+            stream = arguments.at(++i);
+        else if(arguments.at(i) == "-save" && i+1 < arguments.size())
+            saveFile = arguments.at(++i);
+        else if(arguments.at(i) == "-check" && i+1 < arguments.size())
+            checkFile = arguments.at(++i);
+        else if(arguments.at(i) == "-protocol" && i+1 < arguments.size())
+            protocolFile = arguments.at(++i);
+        else
+        {
+            out << "Usage: bl_sa_renderbench [-frames N] [-stream reach|circle|random]"
+                << " [-save reference.txt] [-check reference.txt] [-protocol file]\n";
+            return 1;
+        }
+    }
+    if(frames < 1)
+        frames = 1;
+
+    //Objects of the task of a protocol file, if one is given
+    ProtocolDefinition definition;
+    QString error;
+    if(!protocolFile.isEmpty() && !ProtocolCompiler::Load(protocolFile, definition, error))
+    {
+        out << error << "\n";
+        return 1;
+    }
+
+    //The protocol builds the same objects as in the task window
+    QWidget window;
+    ProtocolController protocol(&window, definition);
+    protocol.setHeadless(true);
+    protocol.Initialize();
+    protocol.BeginExperiment();
+    int rate = qRound(protocol.frameScheduler()->refreshRate());
+    QImage image(window.size(), QImage::Format_RGB32);
+    //The painter is kept open, so the allocations of QPainter::begin() are
+    //not counted as allocations of the frame
+    QPainter painter(&image);
+
+    QVector<QPointF> positions = GenerateStream(stream, frames, rate,
+                                                protocol.originPosition(), protocol.targetPosition());
+    QVector<qint64> sceneTime(frames);
+    QVector<qint64> drawTime(frames);
+    QVector<quint32> checksums(frames);
+    quint64 sceneAllocations = 0;
+    quint64 drawAllocations = 0;
+    quint64 drawBytes = 0;
+    qint64 framePeriod = protocol.frameScheduler()->framePeriod();
+
+    for(int i=0; i<frames; i++)
+    {
+        allocations = 0;
+        allocatedBytes = 0;
+        countAllocations = true;
+        qint64 t0 = MonotonicClock::Now();
+        protocol.MoveCursor(positions.at(i).x(), positions.at(i).y(), i * framePeriod);
+        const SceneStore &scene = protocol.updateGUI();
+        qint64 t1 = MonotonicClock::Now();
+        quint64 updateAllocations = allocations;
+        SceneRenderer::RenderFrame(&painter, image.rect(), scene);
+        qint64 t2 = MonotonicClock::Now();
+        countAllocations = false;
+
+        sceneTime[i] = t1 - t0;
+        drawTime[i] = t2 - t1;
+        sceneAllocations += updateAllocations;
+        drawAllocations += allocations - updateAllocations;
+        drawBytes += allocatedBytes;
+        checksums[i] = SessionChecksum((const char*)image.constBits(), image.bytesPerLine() * image.height());
+    }
+
+    //Times per frame: mean, median and 99th percentile
+    QVector<qint64> total(frames);
+    qint64 sceneSum = 0, drawSum = 0;
+    for(int i=0; i<frames; i++)
+    {
+        total[i] = sceneTime.at(i) + drawTime.at(i);
+        sceneSum += sceneTime.at(i);
+        drawSum += drawTime.at(i);
+    }
+    std::sort(total.begin(), total.end());
+    out << "Stream: " << stream << ", " << frames << " frames of " << image.width() << "x"
+        << image.height() << " (" << QGuiApplication::platformName() << ")\n";
+    out << "Scene update: " << sceneSum / frames << " ns/frame, drawing: " << drawSum / frames << " ns/frame\n";
+    out << "Frame: median " << total.at(frames/2) << " ns, 99% " << total.at((int)(frames*0.99))
+        << " ns, max " << total.last() << " ns\n";
+    out << "Allocations: scene update " << sceneAllocations << " in total, drawing "
+        << QString::number((double)drawAllocations / frames, 'f', 2) << " per frame ("
+        << QString::number((double)drawBytes / frames, 'f', 1) << " bytes per frame)\n";
+
+    //Reference checksums: one line per frame
+    if(!saveFile.isEmpty())
+    {
+        QFile file(saveFile);
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            out << "Could not write " << saveFile << "\n";
+            return 1;
+        }
+        QTextStream reference(&file);
+        reference << "# " << stream << " " << image.width() << "x" << image.height() << "\n";
+        for(int i=0; i<frames; i++)
+            reference << QString::number(checksums.at(i), 16) << "\n";
+        out << "Reference saved to " << saveFile << "\n";
+    }
+
+    //Compares every frame with the reference
+    int failed = 0;
+    if(!checkFile.isEmpty())
+    {
+        QFile file(checkFile);
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            out << "Could not read " << checkFile << "\n";
+            return 1;
+        }
+        QStringList lines = QString::fromUtf8(file.readAll()).split('\n');
+        QString expectedHeader = "# " + stream + " " + QString::number(image.width()) + "x"
+                + QString::number(image.height());
+        if(lines.isEmpty() || lines.first() != expectedHeader)
+        {
+            out << "The reference was rendered with other settings: " << (lines.isEmpty() ? "" : lines.first()) << "\n";
+            return 1;
+        }
+        int first = -1;
+        int compared = qMin(frames, lines.size() - 1);
+        for(int i=0; i<compared; i++)
+        {
+            bool ok = false;
+            if(lines.at(i+1).toUInt(&ok, 16) != checksums.at(i) || !ok)
+            {
+                if(first < 0)
+                    first = i;
+                failed++;
+            }
+        }
+        if(failed > 0)
+            out << "Pixel check FAILED: " << failed << " of " << compared << " frames differ (first: frame " << first << ")\n";
+        else
+            out << "Pixel check passed: " << compared << " frames identical\n";
+    }
+
+    if(sceneAllocations > 0)
+    {
+        out << "The scene update allocated memory\n";
+        failed++;
+    }
+    return failed > 0 ? 1 : 0;
+}
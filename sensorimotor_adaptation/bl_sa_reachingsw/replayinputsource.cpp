@@ -0,0 +1,99 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "replayinputsource.h"
+#include "monotonicclock.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QDebug>
+
+//Default constructor
+ReplayInputSource::ReplayInputSource(std::string _filename, bool _realtime)
+{
+    this->filename = _filename;
+    this->realtime = _realtime;
+    this->position = 0;
+    this->timeOffset = 0;
+}
+
+//Loads every event of the file
+bool ReplayInputSource::Open()
+{
+    QFile file(QString::fromStdString(this->filename));
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qDebug() << "Replay: could not open" << QString::fromStdString(this->filename);
+        return false;
+    }
+
+    this->events.clear();
+    QTextStream stream(&file);
+    int lineNumber = 0;
+    while(!stream.atEnd())
+    {
+        QString line = stream.readLine().trimmed();
+        lineNumber++;
+        if(line.isEmpty() || line.startsWith("#"))
+            continue;
+        QStringList fields = line.split("\t");
+        bool ok = fields.size() == 3;
+        InputEvent ev;
+        if(ok)
+        {
+            bool okT, okX, okY;
+            ev.timestamp = fields.at(0).toLongLong(&okT);
+            ev.dx = fields.at(1).toInt(&okX);
+            ev.dy = fields.at(2).toInt(&okY);
+            ok = okT && okX && okY;
+        }
+        if(!ok)
+        {
+            qDebug() << "Replay: invalid event at line" << lineNumber;
+            return false;
+        }
+        this->events.push_back(ev);
+    }
+    file.close();
+
+    this->Rewind();
+    return true;
+}
+
+//Releases the events
+void ReplayInputSource::Close()
+{
+    this->events.clear();
+    this->position = 0;
+}
+
+//Starts the replay from the first event
+//In real-time mode the first event is aligned with the current time
+void ReplayInputSource::Rewind()
+{
+    this->position = 0;
+    if(this->realtime && !this->events.isEmpty())
+        this->timeOffset = MonotonicClock::Now() - this->events.at(0).timestamp;
+    else
+        this->timeOffset = 0;
+}
+
+//Returns the next event, if it is already due
+bool ReplayInputSource::Read(InputEvent &_event)
+{
+    if(this->position >= this->events.size())
+        return false;
+    const InputEvent &ev = this->events.at(this->position);
+    qint64 timestamp = ev.timestamp + this->timeOffset;
+    if(this->realtime && timestamp > MonotonicClock::Now())
+        return false;
+    _event = ev;
+    _event.timestamp = timestamp;
+    this->position++;
+    return true;
+}
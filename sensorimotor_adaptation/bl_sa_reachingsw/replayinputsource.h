@@ -0,0 +1,59 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Input source that replays relative movements from a text
+ * file, one event per line: "timestamp(ns) <tab> dx <tab> dy". Lines starting
+ * with '#' are ignored. In real-time mode the events are released as the
+ * monotonic clock reaches them; otherwise every event is available at once,
+ * with its original timestamp, which makes runs fully deterministic.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef REPLAYINPUTSOURCE_H
+#define REPLAYINPUTSOURCE_H
+
+#include <string>
+#include <QVector>
+#include "inputsource.h"
+
+class ReplayInputSource : public InputSource
+{
+public:
+    //Constructor
+    ReplayInputSource(std::string _filename, bool _realtime = true);
+
+    //Fields
+    std::string filename;
+
+    //Methods
+    bool Open();
+    void Close();
+    bool Read(InputEvent &_event);
+    //Goes back to the first event
+    void Rewind();
+
+    //Getters
+    int size() const
+    {
+        return events.size();
+    }
+    bool atEnd() const
+    {
+        return position >= events.size();
+    }
+
+private:
+    //Fields
+    QVector<InputEvent> events;
+    int position;
+    bool realtime;
+    //Offset that maps the file timestamps to the monotonic clock
+    qint64 timeOffset;
+};
+
+#endif // REPLAYINPUTSOURCE_H
@@ -0,0 +1,395 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Replays the input events of a recorded session file through
+ * the trial logic of the task (ProtocolController in simulated mode) on a
+ * virtual clock, as fast as possible, and compares what the replay saves
+ * with what was recorded. Used as a regression test of changes to the
+ * trial logic with the data of real participants, and as a benchmark.
+ * Every recorded trial is replayed with the ticks of the sampling grid at
+ * the times they had in the recording: one period before the recorded
+ * start the cursor is placed where the trial started and a frame decides
+ * whether the trial starts, then every event is fed with its timestamp
+ * before the tick that followed it. The grid, the events and the trial
+ * information saved by the replay are then compared, trial by trial, with
+ * the recording: start and end of every trial, and the first sample that
+ * differs. The raw positions are stored rounded, so the feedback may differ
+ * by up to -tolerance pixels when it was transformed.
+ * The timing, latency and frame reports depend on the machine and are not
+ * compared.
+ * Usage: bl_sa_replay <prefix>_session.dat [-protocol file] [-output prefix]
+ *                     [-tolerance pixels] [-verbose]
+ * The protocol is the one given with -protocol, or the file named in the
+ * header of the session if it exists. Returns 1 if anything differs.
+ * ----------------------------------------------------------------------------
+*/
+
+#include <QApplication>
+#include <QWidget>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QStringList>
+#include "protocolcontroller.h"
+#include "protocolcompiler.h"
+#include "sessionfilereader.h"
+#include "asyncwriter.h"
+#include "datafilecontroller.h"
+#include "monotonicclock.h"
+
+//The messages of every trial are only shown with -verbose
+static bool verbose = false;
+
+static void MessageHandler(QtMsgType _type, const QMessageLogContext &_context, const QString &_message)
+{
+    Q_UNUSED(_context);
+    if(_type == QtDebugMsg && !verbose)
+        return;
+    QTextStream(stderr) << _message << "\n";
+}
+
+//A trial of the session file
+struct ReplayTrial
+{
+    int session;
+    int trial;
+    qint64 start; //Monotonic time of the first grid sample (ns)
+    qint64 offset; //Replay time - recorded time
+};
+
+//Value of a "key: value" line of the header, empty if there is none
+static QString HeaderValue(const QString &_header, const QString &_key)
+{
+    QStringList lines = _header.split('\n');
+    for(int i=0; i<lines.size(); i++)
+    {
+        if(lines.at(i).startsWith(_key + ":"))
+            return lines.at(i).mid(_key.length() + 1).trimmed();
+    }
+    return QString();
+}
+
+//Trials of a session file in the order they were recorded
+//A trial recorded again after a resume keeps its first position
+static QVector<ReplayTrial> ListTrials(const SessionFileReader &_reader)
+{
+    QVector<ReplayTrial> trials;
+    for(int i=0; i<_reader.records(); i++)
+    {
+        const TrialIndexEntry &entry = _reader.entry(i);
+        if(entry.stream != StreamGrid || entry.sequence != 0)
+            continue;
+        bool found = false;
+        for(int k=0; k<trials.size() && !found; k++)
+            found = trials.at(k).session == (int)entry.session && trials.at(k).trial == (int)entry.trial;
+        if(found)
+            continue;
+        QVector<int> blocks = _reader.Blocks(entry.session, entry.trial, StreamGrid);
+        if(blocks.isEmpty())
+            continue;
+        ReplayTrial trial;
+        trial.session = entry.session;
+        trial.trial = entry.trial;
+        trial.start = _reader.entry(blocks.first()).startTime;
+        trial.offset = 0;
+        trials.push_back(trial);
+    }
+    return trials;
+}
+
+//First sample that differs between two streams of a trial, empty if every
+//sample they have in common is equal
+//Times are compared relative to the start of each trial
+static QString CompareSamples(const QVector<CursorSample> &_recorded, qint64 _recordedStart,
+                              const QVector<CursorSample> &_replayed, qint64 _replayedStart,
+                              int _tolerance)
+{
+    int n = qMin(_recorded.size(), _replayed.size());
+    for(int i=0; i<n; i++)
+    {
+        const CursorSample &a = _recorded.at(i);
+        const CursorSample &b = _replayed.at(i);
+        if(a.timestamp - _recordedStart != b.timestamp - _replayedStart ||
+                a.rawX != b.rawX || a.rawY != b.rawY ||
+                qAbs(a.x - b.x) > _tolerance || qAbs(a.y - b.y) > _tolerance)
+        {
+            return "sample " + QString::number(i) + ": recorded (" +
+                    QString::number((a.timestamp - _recordedStart) / 1000000.0, 'f', 3) + " ms, " +
+                    QString::number(a.rawX) + ", " + QString::number(a.rawY) + " -> " +
+                    QString::number(a.x) + ", " + QString::number(a.y) + "), replayed (" +
+                    QString::number((b.timestamp - _replayedStart) / 1000000.0, 'f', 3) + " ms, " +
+                    QString::number(b.rawX) + ", " + QString::number(b.rawY) + " -> " +
+                    QString::number(b.x) + ", " + QString::number(b.y) + ")";
+        }
+    }
+    return QString();
+}
+
+int main(int argc, char *argv[])
+{
+    //No display is needed unless another platform is chosen
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication a(argc, argv);
+    qInstallMessageHandler(MessageHandler);
+    QTextStream out(stdout);
+
+    QString sessionFile;
+    QString protocolFile;
+    QString outputPrefix;
+    int tolerance = 1;
+    QStringList arguments = a.arguments();
+    for(int i=1; i<arguments.size(); i++)
+    {
+        if(arguments.at(i) == "-protocol" && i+1 < arguments.size())
+            protocolFile = arguments.at(++i);
+        else if(arguments.at(i) == "-output" && i+1 < arguments.size())
+            outputPrefix = arguments.at(++i);
+        else if(arguments.at(i) == "-tolerance" && i+1 < arguments.size())
+            tolerance = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-verbose")
+            verbose = true;
+        else if(sessionFile.isEmpty() && !arguments.at(i).startsWith("-"))
+            sessionFile = arguments.at(i);
+        else
+        {
+            sessionFile.clear();
+            break;
+        }
+    }
+    if(sessionFile.isEmpty())
+    {
+        out << "Usage: bl_sa_replay <prefix>_session.dat [-protocol file] [-output prefix]"
+            << " [-tolerance pixels] [-verbose]\n";
+        return 1;
+    }
+
+    SessionFileReader recorded(sessionFile.toStdString());
+    if(!recorded.Open())
+    {
+        out << "Could not read " << sessionFile << "\n";
+        return 1;
+    }
+    QString header = recorded.header();
+    QVector<ReplayTrial> trials = ListTrials(recorded);
+    if(trials.isEmpty())
+    {
+        out << sessionFile << " has no trials\n";
+        return 1;
+    }
+
+    //Protocol of the recording
+    if(protocolFile.isEmpty())
+    {
+        QString path = HeaderValue(header, "Protocol file");
+        if(QFileInfo(path).exists())
+            protocolFile = path;
+    }
+    ProtocolDefinition definition;
+    QString error;
+    if(!protocolFile.isEmpty() && !ProtocolCompiler::Load(protocolFile, definition, error))
+    {
+        out << error << "\n";
+        return 1;
+    }
+    if(outputPrefix.isEmpty())
+        outputPrefix = QFileInfo(sessionFile).completeBaseName() + "_replay";
+    definition.fileprefix = outputPrefix;
+    definition.resumeSession = false;
+    definition.saveTextFiles = false;
+    qint64 period = 1000000000LL / definition.samplingFrequency;
+    QString recordedPeriod = HeaderValue(header, "Sampling period (ns)");
+    if(!recordedPeriod.isEmpty() && recordedPeriod.toLongLong() != period)
+        out << "Warning: the session was sampled every " << recordedPeriod
+            << " ns, the protocol every " << period << " ns\n";
+    //Longest rest, used when the recorded clock goes back (resumed sessions)
+    qint64 longestRest = definition.restInterval;
+    for(int i=0; i<definition.numberSessions(); i++)
+        longestRest = qMax(longestRest, (qint64)qMax(definition.vSessions.at(i).rest,
+                                                     definition.vSessions.at(i).sessionBreak));
+    longestRest *= 1000000LL;
+
+    //The window has the size of the monitor of the recording, so the
+    //origin and the targets are at the same positions
+    int width = HeaderValue(header, "Monitor width (pixels)").toInt();
+    int height = HeaderValue(header, "Monitor height (pixels)").toInt();
+    quint64 events = 0;
+    qint64 replayedTime = 0;
+    qint64 wall = 0;
+    {
+        QWidget window;
+        ProtocolController protocol(&window, definition);
+        if(width > 0 && height > 0)
+        {
+            window.setWindowState(Qt::WindowNoState);
+            window.setGeometry(0, 0, width, height);
+        }
+        protocol.setSimulated(true);
+        protocol.Initialize();
+        protocol.BeginExperiment();
+        qint64 framePeriod = protocol.frameScheduler()->framePeriod();
+        //Time a trial may go on after its last event before it is
+        //abandoned (the stationary window, twice, and one second)
+        qint64 holdLimit = 2LL * definition.samplesToStop * period + 1000000000LL;
+
+        QVector<CursorSample> vGrid;
+        QVector<CursorSample> vEvents;
+        qint64 now = 0;
+        qint64 offset = 0;
+        qint64 wallStart = MonotonicClock::Now();
+        for(int k=0; k<trials.size() && !protocol.finished(); k++)
+        {
+            ReplayTrial &trial = trials[k];
+            recorded.Samples(trial.session, trial.trial, StreamGrid, vGrid);
+            recorded.Samples(trial.session, trial.trial, StreamEvents, vEvents);
+            if(vGrid.isEmpty())
+            {
+                out << "Trial " << trial.session << "_" << trial.trial << " has no samples, skipped\n";
+                continue;
+            }
+            //The virtual clock never goes back
+            if(trial.start - period + offset <= now)
+                offset = now - (trial.start - period) + longestRest;
+            trial.offset = offset;
+
+            //Start: the cursor is where the grid started, and a frame
+            //decides whether the trial starts at the next tick
+            now = trial.start - period + offset;
+            protocol.Advance(now);
+            protocol.MoveCursor(vGrid.first().rawX, vGrid.first().rawY, now);
+            protocol.updateGUI();
+            qint64 nextFrame = now + framePeriod;
+
+            //Ticks of the recording: every event before the tick that
+            //followed it, frames in between
+            qint64 lastEvent = vEvents.isEmpty() ? trial.start : vEvents.last().timestamp;
+            int next = 0;
+            bool started = false;
+            qint64 tick = trial.start + offset;
+            for(;; tick += period)
+            {
+                while(next < vEvents.size() && vEvents.at(next).timestamp + offset <= tick)
+                {
+                    const CursorSample &event = vEvents.at(next);
+                    qint64 t = event.timestamp + offset;
+                    while(nextFrame <= t)
+                    {
+                        protocol.updateGUI();
+                        nextFrame += framePeriod;
+                    }
+                    protocol.MoveCursor(event.rawX, event.rawY, t);
+                    next++;
+                    events++;
+                }
+                while(nextFrame <= tick)
+                {
+                    protocol.updateGUI();
+                    nextFrame += framePeriod;
+                }
+                protocol.Advance(tick);
+                started = started || protocol.trialRunning();
+                bool ended = started && !protocol.trialRunning();
+                if(next >= vEvents.size() && (ended || protocol.finished() || tick > lastEvent + offset + holdLimit))
+                    break;
+            }
+            now = tick;
+            replayedTime += tick - (trial.start - period + offset);
+        }
+        wall = MonotonicClock::Now() - wallStart;
+        //Closes the session file of the replay (the protocol may have more
+        //trials than the recording)
+    }
+    DataFileController::WaitForWrites();
+
+    //Comparison, trial by trial
+    QString replayFile = outputPrefix + "_session.dat";
+    SessionFileReader replayed(replayFile.toStdString());
+    if(!replayed.Open())
+    {
+        out << "Could not read the replay " << replayFile << "\n";
+        AsyncWriter::Shutdown();
+        return 1;
+    }
+    QVector<ReplayTrial> replayedTrials = ListTrials(replayed);
+    int differences = 0;
+    QVector<CursorSample> vRecorded;
+    QVector<CursorSample> vReplayed;
+    for(int k=0; k<trials.size(); k++)
+    {
+        const ReplayTrial &trial = trials.at(k);
+        QString name = "Trial " + QString::number(trial.session) + "_" + QString::number(trial.trial) + ": ";
+        const ReplayTrial *copy = NULL;
+        for(int i=0; i<replayedTrials.size() && copy == NULL; i++)
+        {
+            if(replayedTrials.at(i).session == trial.session && replayedTrials.at(i).trial == trial.trial)
+                copy = &replayedTrials.at(i);
+        }
+        if(copy == NULL)
+        {
+            out << name << "not replayed (did not start)\n";
+            differences++;
+            continue;
+        }
+
+        QStringList problems;
+        //Start decision: the tick where the recording of the trial began
+        qint64 shift = copy->start - trial.offset - trial.start;
+        if(shift != 0)
+            problems << "started " + QString::number(shift / (double)period, 'f', 1) + " samples " +
+                        (shift > 0 ? "later" : "earlier");
+        //Stop decision and the samples (after a different start every
+        //sample is shifted, so only the first difference is reported)
+        recorded.Samples(trial.session, trial.trial, StreamGrid, vRecorded);
+        replayed.Samples(trial.session, trial.trial, StreamGrid, vReplayed);
+        if(vRecorded.size() != vReplayed.size())
+            problems << "ended after " + QString::number(vReplayed.size()) + " samples instead of " +
+                        QString::number(vRecorded.size());
+        QString difference = CompareSamples(vRecorded, trial.start, vReplayed, copy->start, tolerance);
+        if(!difference.isEmpty() && (shift == 0 || problems.size() == 0))
+            problems << "grid " + difference;
+        recorded.Samples(trial.session, trial.trial, StreamEvents, vRecorded);
+        replayed.Samples(trial.session, trial.trial, StreamEvents, vReplayed);
+        if(vRecorded.size() != vReplayed.size())
+            problems << QString::number(vReplayed.size()) + " events instead of " + QString::number(vRecorded.size());
+        difference = CompareSamples(vRecorded, trial.start, vReplayed, copy->start, tolerance);
+        if(!difference.isEmpty() && shift == 0)
+            problems << "events " + difference;
+        //Target, perturbation and whether the target was reached
+        int a = recorded.Find(trial.session, trial.trial, StreamTrialInfo);
+        int b = replayed.Find(trial.session, trial.trial, StreamTrialInfo);
+        if(a >= 0 && (b < 0 || recorded.Text(a) != replayed.Text(b)))
+            problems << "trial information differs";
+
+        if(!problems.isEmpty())
+        {
+            out << name << problems.join("; ") << "\n";
+            differences++;
+        }
+    }
+    for(int i=0; i<replayedTrials.size(); i++)
+    {
+        bool found = false;
+        for(int k=0; k<trials.size() && !found; k++)
+            found = trials.at(k).session == replayedTrials.at(i).session && trials.at(k).trial == replayedTrials.at(i).trial;
+        if(!found)
+        {
+            out << "Trial " << replayedTrials.at(i).session << "_" << replayedTrials.at(i).trial
+                << ": only in the replay\n";
+            differences++;
+        }
+    }
+
+    double seconds = wall / 1e9;
+    out << "Replayed " << trials.size() << " trials, " << events << " events in "
+        << QString::number(seconds, 'f', 3) << " s (" << QString::number(trials.size() / seconds, 'f', 1)
+        << " trials/s, " << QString::number(events / seconds / 1e6, 'f', 2) << " M events/s, "
+        << QString::number(replayedTime / (double)wall, 'f', 1) << "x real time)\n";
+    if(differences > 0)
+        out << differences << " of " << trials.size() << " trials differ (replay in " << replayFile << ")\n";
+    else
+        out << "Every trial is identical (replay in " << replayFile << ")\n";
+    AsyncWriter::Shutdown();
+    return differences > 0 ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "resampler.h"
+
+//Default constructor
+Resampler::Resampler(qint64 _period)
+{
+    this->m_period = _period;
+    this->m_nextTime = 0;
+    this->lastEventTime = 0;
+    this->previous.timestamp = 0;
+    this->previous.rawX = 0;
+    this->previous.rawY = 0;
+    this->previous.x = 0;
+    this->previous.y = 0;
+}
+
+//Starts a new grid
+void Resampler::Reset(qint64 _startTime, const CursorSample &_initial)
+{
+    this->previous = _initial;
+    this->m_nextTime = _startTime;
+    this->lastEventTime = _initial.timestamp;
+    //The initial position is valid from the start of the grid
+    if(this->previous.timestamp > _startTime)
+        this->previous.timestamp = _startTime;
+}
+
+//Interpolates the grid samples between the previous event and the new one
+bool Resampler::Push(const CursorSample &_event, QVector<CursorSample> &_output)
+{
+    if(_event.timestamp < this->lastEventTime)
+        return false;
+    this->lastEventTime = _event.timestamp;
+
+    qint64 span = _event.timestamp - this->previous.timestamp;
+    while(this->m_nextTime <= _event.timestamp)
+    {
+        //Fraction of the way between the two events
+        double alpha = 1.0;
+        if(span > 0 && this->m_nextTime > this->previous.timestamp)
+            alpha = (double)(this->m_nextTime - this->previous.timestamp) / (double)span;
+        else if(this->m_nextTime <= this->previous.timestamp)
+            alpha = 0.0;
+
+        CursorSample s;
+        s.timestamp = this->m_nextTime;
+        s.rawX = qRound(this->previous.rawX + alpha*(_event.rawX - this->previous.rawX));
+        s.rawY = qRound(this->previous.rawY + alpha*(_event.rawY - this->previous.rawY));
+        s.x = qRound(this->previous.x + alpha*(_event.x - this->previous.x));
+        s.y = qRound(this->previous.y + alpha*(_event.y - this->previous.y));
+        _output.push_back(s);
+
+        this->m_nextTime += this->m_period;
+    }
+    //An event older than the held grid samples only updates the position
+    qint64 heldTime = this->previous.timestamp;
+    this->previous = _event;
+    if(this->previous.timestamp < heldTime)
+        this->previous.timestamp = heldTime;
+    return true;
+}
+
+//Holds the last position up to the given time
+void Resampler::Advance(qint64 _time, QVector<CursorSample> &_output)
+{
+    while(this->m_nextTime <= _time)
+    {
+        CursorSample s = this->previous;
+        s.timestamp = this->m_nextTime;
+        _output.push_back(s);
+        this->m_nextTime += this->m_period;
+    }
+    //Later events interpolate from the end of the held segment
+    if(this->previous.timestamp < this->m_nextTime - this->m_period)
+        this->previous.timestamp = this->m_nextTime - this->m_period;
+}
@@ -0,0 +1,62 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Streaming resampler that converts the cursor events, which
+ * arrive at irregular times, into samples on a uniform time grid. Grid
+ * points between two events are linearly interpolated; grid points after the
+ * last event hold its position, since no event means no movement.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QVector>
+#include "samplebuffer.h"
+
+class Resampler
+{
+public:
+    //Constructor
+    //_period: interval of the output grid (ns)
+    Resampler(qint64 _period = 10000000);
+
+    //Methods
+    //Starts a new grid at _startTime from the position in _initial
+    void Reset(qint64 _startTime, const CursorSample &_initial);
+    //Adds an event and appends to _output every grid sample up to its time
+    //Returns false if the event is older than the previous one (ignored)
+    bool Push(const CursorSample &_event, QVector<CursorSample> &_output);
+    //Appends to _output every grid sample up to _time, holding the
+    //position of the last event
+    void Advance(qint64 _time, QVector<CursorSample> &_output);
+
+    //Getters and setters
+    void setPeriod(qint64 period)
+    {
+        m_period = period;
+    }
+    qint64 period() const
+    {
+        return m_period;
+    }
+    //Time of the next grid sample
+    qint64 nextTime() const
+    {
+        return m_nextTime;
+    }
+
+private:
+    //Fields
+    qint64 m_period;
+    qint64 m_nextTime;
+    qint64 lastEventTime;
+    CursorSample previous;
+};
+
+#endif // RESAMPLER_H
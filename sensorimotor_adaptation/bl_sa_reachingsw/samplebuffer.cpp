@@ -0,0 +1,85 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "samplebuffer.h"
+
+//Default constructor
+SampleBuffer::SampleBuffer(int _capacity)
+{
+    //Rounds the capacity up to a power of two so the
+    //indexes can be wrapped with a mask
+    quint32 cap = 2;
+    while((int)cap < _capacity)
+        cap <<= 1;
+    this->m_capacity = (int)cap;
+    this->mask = cap - 1;
+    this->buffer = new CursorSample[cap];
+    this->head.store(0);
+    this->tail.store(0);
+    this->m_overruns.store(0);
+    this->m_dropped.store(0);
+}
+
+//Destructor
+SampleBuffer::~SampleBuffer()
+{
+    delete[] this->buffer;
+}
+
+//Adds a new sample to the ring
+//Must only be called from the producer thread
+bool SampleBuffer::Push(const CursorSample &_sample)
+{
+    quint32 h = this->head.load(std::memory_order_relaxed);
+    quint32 t = this->tail.load(std::memory_order_acquire);
+    //The ring is full: the new sample is lost
+    if(h - t >= (quint32)this->m_capacity)
+    {
+        this->m_overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    this->buffer[h & this->mask] = _sample;
+    //Publishes the sample to the consumer
+    this->head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+//Removes the oldest sample from the ring
+//Must only be called from the consumer thread
+bool SampleBuffer::Pop(CursorSample &_sample)
+{
+    quint32 t = this->tail.load(std::memory_order_relaxed);
+    quint32 h = this->head.load(std::memory_order_acquire);
+    //The ring is empty
+    if(t == h)
+        return false;
+    _sample = this->buffer[t & this->mask];
+    //Gives the slot back to the producer
+    this->tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+//Number of samples waiting to be consumed
+int SampleBuffer::Size() const
+{
+    quint32 h = this->head.load(std::memory_order_acquire);
+    quint32 t = this->tail.load(std::memory_order_acquire);
+    return (int)(h - t);
+}
+
+//Counts samples that were consumed but not used
+void SampleBuffer::AddDropped(quint64 _count)
+{
+    this->m_dropped.fetch_add(_count, std::memory_order_relaxed);
+}
+
+//Takes the counters
+void SampleBuffer::TakeCounters(quint64 &_overruns, quint64 &_dropped)
+{
+    _overruns = this->m_overruns.exchange(0, std::memory_order_relaxed);
+    _dropped = this->m_dropped.exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,90 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Lock-free single-producer/single-consumer ring of cursor
+ * samples. The GUI thread (MouseMove) is the only producer and the sampling
+ * tick is the only consumer, so no mutex is needed on the hot path.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef SAMPLEBUFFER_H
+#define SAMPLEBUFFER_H
+
+#include <atomic>
+#include <QtGlobal>
+
+//Fixed-size sample handed from the mouse events to the sampling tick
+struct CursorSample
+{
+    qint64 timestamp; //Monotonic timestamp (ns)
+    int rawX; //Cursor position before the perturbation
+    int rawY;
+    int x; //Position of the visual feedback (perturbed)
+    int y;
+};
+
+class SampleBuffer
+{
+public:
+    //Constructor
+    //The capacity is rounded up to the next power of two
+    SampleBuffer(int _capacity = 1024);
+    ~SampleBuffer();
+
+    //Methods
+    //Producer side: adds a sample to the ring
+    //Returns false (and counts an overrun) if the ring is full
+    bool Push(const CursorSample &_sample);
+    //Consumer side: removes the oldest sample from the ring
+    //Returns false if the ring is empty
+    bool Pop(CursorSample &_sample);
+    //Number of samples waiting to be consumed
+    int Size() const;
+    //Counts samples that were consumed but not used by the consumer
+    void AddDropped(quint64 _count);
+    //Returns the overrun and dropped counters and resets them in the same
+    //atomic operation, so nothing counted meanwhile is lost
+    void TakeCounters(quint64 &_overruns, quint64 &_dropped);
+
+    //Getters
+    int capacity() const
+    {
+        return m_capacity;
+    }
+    //Samples lost because the ring was full
+    quint64 overruns() const
+    {
+        return m_overruns.load(std::memory_order_relaxed);
+    }
+    //Samples discarded by the consumer
+    quint64 dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    //Fields
+    CursorSample *buffer;
+    int m_capacity;
+    quint32 mask;
+    //Head and tail are padded into different cache lines so the
+    //producer and the consumer do not invalidate each other
+    char padding0[64];
+    std::atomic<quint32> head; //Written only by the producer
+    char padding1[64];
+    std::atomic<quint32> tail; //Written only by the consumer
+    char padding2[64];
+    std::atomic<quint64> m_overruns;
+    std::atomic<quint64> m_dropped;
+
+    //Not copyable
+    SampleBuffer(const SampleBuffer&);
+    SampleBuffer& operator=(const SampleBuffer&);
+};
+
+#endif // SAMPLEBUFFER_H
@@ -0,0 +1,39 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "scenerenderer.h"
+
+void SceneRenderer::Render(QPainter *_painter, const SceneStore &_scene)
+{
+    for(int i=0; i<_scene.count(); i++)
+    {
+        if(!_scene.visible(i))
+            continue;
+        _painter->setPen(_scene.pen(i));
+        _painter->setBrush(_scene.brush(i));
+        switch(_scene.type(i))
+        {
+        case SceneStore::Ellipse:
+            _painter->drawEllipse(QPointF(_scene.x(i),_scene.y(i)),
+                                  _scene.width(i),_scene.height(i));
+            break;
+
+        case SceneStore::Rectangle:
+            _painter->drawRect((int)_scene.x(i),(int)_scene.y(i),
+                               _scene.width(i),_scene.height(i));
+            break;
+        }
+    }
+}
+
+//The window gets its background from the style sheet before the paint event,
+//so the frame is cleared to the same color
+void SceneRenderer::RenderFrame(QPainter *_painter, const QRect &_rect, const SceneStore &_scene)
+{
+    _painter->fillRect(_rect, background());
+    Render(_painter, _scene);
+}
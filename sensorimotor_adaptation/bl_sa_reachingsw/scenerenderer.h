@@ -0,0 +1,40 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Draws the objects of the task (ProtocolController::updateGUI())
+ * with a QPainter. The task window and the headless benchmark
+ * (bl_sa_renderbench) use the same code, so an image rendered offscreen has
+ * the same pixels as the frame shown on the screen.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include <QPainter>
+#include <QRect>
+#include "scenestore.h"
+
+class SceneRenderer
+{
+public:
+    //Methods
+    //Draws the visible objects, in order, on the painter
+    static void Render(QPainter *_painter, const SceneStore &_scene);
+    //Clears _rect to the background of the task window and draws the objects
+    //Used when the painter does not belong to the window (e.g. a QImage)
+    static void RenderFrame(QPainter *_painter, const QRect &_rect, const SceneStore &_scene);
+
+    //Background of the task window (see ProtocolController)
+    static QColor background()
+    {
+        return QColor(Qt::black);
+    }
+};
+
+#endif // SCENERENDERER_H
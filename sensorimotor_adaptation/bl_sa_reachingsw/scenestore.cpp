@@ -0,0 +1,65 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "scenestore.h"
+
+SceneStore::SceneStore(int _capacity)
+{
+    this->m_count = 0;
+    this->vX.resize(_capacity);
+    this->vY.resize(_capacity);
+    this->vWidth.resize(_capacity);
+    this->vHeight.resize(_capacity);
+    this->vColor.resize(_capacity);
+    this->vType.resize(_capacity);
+    this->vVisible.resize(_capacity);
+    this->vPen.resize(_capacity);
+    this->vBrush.resize(_capacity);
+}
+
+int SceneStore::Add(ObjectType _type, double _x, double _y, int _width, int _height, const QColor &_color)
+{
+    if(this->m_count == this->capacity())
+        return -1;
+    int i = this->m_count++;
+    this->vType[i] = _type;
+    this->vX[i] = _x;
+    this->vY[i] = _y;
+    this->vWidth[i] = _width;
+    this->vHeight[i] = _height;
+    this->vVisible[i] = true;
+    //Pen of 0 pixels (cosmetic) and a brush of the same color
+    this->vPen[i] = QPen(_color);
+    this->vPen[i].setWidth(0);
+    this->vBrush[i] = QBrush(_color);
+    this->vColor[i] = _color.rgba();
+    return i;
+}
+
+//The pen and the brush are only rebuilt if the color has changed
+void SceneStore::setColor(int _object, const QColor &_color)
+{
+    if(this->vColor.at(_object) == _color.rgba())
+        return;
+    this->vColor[_object] = _color.rgba();
+    this->vPen[_object].setColor(_color);
+    this->vBrush[_object].setColor(_color);
+}
+
+double SceneStore::SquaredDistance(int _object, int _other) const
+{
+    double x = this->vX.at(_object) - this->vX.at(_other);
+    double y = this->vY.at(_object) - this->vY.at(_other);
+    return x*x + y*y;
+}
+
+//Same criterion as GUIObject::HasCollidedCenter, without the square root
+bool SceneStore::HasCollidedCenter(int _object, int _other) const
+{
+    double radius = this->vWidth.at(_other) / 2.0;
+    return this->SquaredDistance(_object, _other) <= radius*radius;
+}
@@ -0,0 +1,114 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Objects drawn in the task window (origin, target, cursors),
+ * stored by value as one array per property. Every array is allocated by
+ * the constructor, so moving an object or hiding it does not touch the heap.
+ * Each object keeps its pen and brush: they are only rebuilt when its color
+ * changes, which happens between trials, not on every frame.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef SCENESTORE_H
+#define SCENESTORE_H
+
+#include <QVector>
+#include <QColor>
+#include <QPen>
+#include <QBrush>
+
+class SceneStore
+{
+public:
+    //Shape of an object
+    enum ObjectType{Ellipse=1, Rectangle=2};
+
+    //Constructor
+    //_capacity: maximum number of objects
+    SceneStore(int _capacity = 8);
+
+    //Methods
+    //Adds an object and returns its index (-1 if the store is full)
+    //Objects are drawn in the order in which they were added
+    int Add(ObjectType _type, double _x, double _y, int _width, int _height, const QColor &_color);
+    //Squared distance between the centers of two objects
+    double SquaredDistance(int _object, int _other) const;
+    //Whether the center of _object is within half the width of _other
+    bool HasCollidedCenter(int _object, int _other) const;
+
+    //Getters and setters
+    int count() const
+    {
+        return m_count;
+    }
+    int capacity() const
+    {
+        return vX.size();
+    }
+    void setPosition(int _object, double _x, double _y)
+    {
+        vX[_object] = _x;
+        vY[_object] = _y;
+    }
+    double x(int _object) const
+    {
+        return vX.at(_object);
+    }
+    double y(int _object) const
+    {
+        return vY.at(_object);
+    }
+    int width(int _object) const
+    {
+        return vWidth.at(_object);
+    }
+    int height(int _object) const
+    {
+        return vHeight.at(_object);
+    }
+    ObjectType type(int _object) const
+    {
+        return (ObjectType)vType.at(_object);
+    }
+    void setColor(int _object, const QColor &_color);
+    QRgb color(int _object) const
+    {
+        return vColor.at(_object);
+    }
+    void setVisible(int _object, bool _visible)
+    {
+        vVisible[_object] = _visible;
+    }
+    bool visible(int _object) const
+    {
+        return vVisible.at(_object);
+    }
+    const QPen& pen(int _object) const
+    {
+        return vPen.at(_object);
+    }
+    const QBrush& brush(int _object) const
+    {
+        return vBrush.at(_object);
+    }
+
+private:
+    //Fields
+    int m_count;
+    QVector<double> vX; //Center
+    QVector<double> vY;
+    QVector<int> vWidth;
+    QVector<int> vHeight;
+    QVector<QRgb> vColor;
+    QVector<quint8> vType;
+    QVector<bool> vVisible;
+    QVector<QPen> vPen;
+    QVector<QBrush> vBrush;
+};
+
+#endif // SCENESTORE_H
@@ -0,0 +1,490 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "sessionexporter.h"
+
+#include <string.h>
+#include <QSet>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+//MAT v5 data types
+enum MatDataType{miINT8=1, miUINT8=2, miINT32=5, miUINT32=6, miDOUBLE=9, miINT64=12,
+                 miMATRIX=14, miUINT16=4};
+//MAT v5 array classes
+enum MatClass{mxSTRUCT=2, mxCHAR=4, mxDOUBLE=6, mxUINT8=9, mxINT32=12, mxINT64=14};
+//Array flag of logical arrays
+static const quint32 matLogical = 0x0200;
+//Longest field name accepted by MATLAB
+static const int matNameLength = 63;
+
+//Byte order of the NumPy arrays: the samples are written as they are in memory
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+static const char npyOrder = '>';
+#else
+static const char npyOrder = '<';
+#endif
+
+//Row of <prefix>_trials.npy
+struct NpyTrialRow
+{
+    qint32 session;
+    qint32 trial;
+    qint64 startTime;
+    qint64 gridStart;
+    qint64 gridCount;
+    qint64 eventStart;
+    qint64 eventCount;
+};
+static_assert(sizeof(NpyTrialRow) == 48, "NpyTrialRow must not be padded");
+
+//-----------------------------------------------------------------
+//MAT v5 elements
+//-----------------------------------------------------------------
+//Tag, data and padding to 8 bytes
+static void AppendElement(QByteArray &_out, quint32 _type, const void *_data, quint32 _bytes)
+{
+    static const char zeros[8] = {0,0,0,0,0,0,0,0};
+    quint32 tag[2] = {_type, _bytes};
+    _out.append((const char*)tag, sizeof(tag));
+    if(_bytes > 0)
+        _out.append((const char*)_data, _bytes);
+    int padding = (8 - (_bytes % 8)) % 8;
+    _out.append(zeros, padding);
+}
+
+//Array flags, dimensions and name of a matrix
+static void AppendMatrixHeader(QByteArray &_out, quint32 _class, int _rows, int _cols,
+                               const char *_name, quint32 _flags = 0)
+{
+    quint32 flags[2] = {_class | _flags, 0};
+    AppendElement(_out, miUINT32, flags, sizeof(flags));
+    qint32 dims[2] = {_rows, _cols};
+    AppendElement(_out, miINT32, dims, sizeof(dims));
+    AppendElement(_out, miINT8, _name, strlen(_name));
+}
+
+//Numeric matrix stored column by column
+static void AppendMatrix(QByteArray &_out, const char *_name, quint32 _class, quint32 _type,
+                         const void *_data, int _elementBytes, int _rows, int _cols,
+                         quint32 _flags = 0)
+{
+    QByteArray body;
+    AppendMatrixHeader(body, _class, _rows, _cols, _name, _flags);
+    AppendElement(body, _type, _data, _rows * _cols * _elementBytes);
+    AppendElement(_out, miMATRIX, body.constData(), body.size());
+}
+
+//Row of characters (UTF-16)
+static void AppendChar(QByteArray &_out, const char *_name, const QString &_text)
+{
+    QByteArray body;
+    AppendMatrixHeader(body, mxCHAR, 1, _text.size(), _name);
+    AppendElement(body, miUINT16, _text.utf16(), _text.size() * 2);
+    AppendElement(_out, miMATRIX, body.constData(), body.size());
+}
+
+//Array flags, dimensions, name and field names of a struct
+//The fields of every element follow, column by column
+static void AppendStructHeader(QByteArray &_out, const char *_name, int _rows, int _cols,
+                               const QStringList &_fields)
+{
+    AppendMatrixHeader(_out, mxSTRUCT, _rows, _cols, _name);
+    qint32 length = 1;
+    for(int i=0; i<_fields.size(); i++)
+        length = qMax(length, _fields.at(i).size() + 1);
+    AppendElement(_out, miINT32, &length, sizeof(length));
+    QByteArray names(_fields.size() * length, 0);
+    for(int i=0; i<_fields.size(); i++)
+    {
+        QByteArray name = _fields.at(i).toLatin1();
+        memcpy(names.data() + i*length, name.constData(), name.size());
+    }
+    AppendElement(_out, miINT8, names.constData(), names.size());
+}
+
+//Converts a header value to numbers: "320", "1; 1; 1; " or "True; False; "
+//Returns false if the value is text
+static bool ParseValue(const QString &_value, QVector<double> &_numbers, bool &_logical)
+{
+    _numbers.clear();
+    _logical = false;
+    QStringList items = _value.split(';');
+    int logicals = 0;
+    for(int i=0; i<items.size(); i++)
+    {
+        QString item = items.at(i).trimmed();
+        if(item.isEmpty())
+            continue;
+        bool ok = false;
+        double number = item.toDouble(&ok);
+        if(!ok)
+        {
+            if(item == "True" || item == "False")
+            {
+                number = item == "True" ? 1 : 0;
+                logicals++;
+            }
+            else
+                return false;
+        }
+        _numbers.push_back(number);
+    }
+    if(_numbers.isEmpty() || (logicals > 0 && logicals != _numbers.size()))
+        return false;
+    _logical = logicals > 0;
+    return true;
+}
+
+//Default constructor
+SessionExporter::SessionExporter(SessionFileReader *_reader)
+{
+    this->reader = _reader;
+    this->CollectTrials();
+}
+
+//Lists the trials of the session in the order in which they were recorded
+//A trial recorded more than once (the session was resumed) is listed once
+void SessionExporter::CollectTrials()
+{
+    this->vTrials.clear();
+    QSet<qint64> found;
+    for(int i=0; i<this->reader->records(); i++)
+    {
+        const TrialIndexEntry &e = this->reader->entry(i);
+        if(e.stream != (quint32)StreamGrid)
+            continue;
+        qint64 key = ((qint64)e.session << 32) | e.trial;
+        if(found.contains(key))
+            continue;
+        found.insert(key);
+
+        Trial trial;
+        trial.session = e.session;
+        trial.trial = e.trial;
+        trial.gridCount = 0;
+        trial.eventCount = 0;
+        QVector<int> blocks = this->reader->Blocks(trial.session, trial.trial, StreamGrid);
+        trial.startTime = this->reader->entry(blocks.first()).startTime;
+        for(int k=0; k<blocks.size(); k++)
+            trial.gridCount += this->reader->entry(blocks.at(k)).count;
+        blocks = this->reader->Blocks(trial.session, trial.trial, StreamEvents);
+        for(int k=0; k<blocks.size(); k++)
+            trial.eventCount += this->reader->entry(blocks.at(k)).count;
+        trial.timingRecord = this->reader->Find(trial.session, trial.trial, StreamTiming);
+        trial.latencyRecord = this->reader->Find(trial.session, trial.trial, StreamLatency);
+        trial.infoRecord = this->reader->Find(trial.session, trial.trial, StreamTrialInfo);
+        this->vTrials.push_back(trial);
+    }
+}
+
+//Lines "Name: value" of the header
+//Names are converted to identifiers: "Sampling frequency (Hz)" becomes
+//"Sampling_frequency_Hz"; repeated names get a suffix (_2, _3, ...)
+void SessionExporter::ParseHeader(const QString &_header, QStringList &_names, QStringList &_values)
+{
+    _names.clear();
+    _values.clear();
+    QStringList lines = _header.split('\n');
+    for(int i=0; i<lines.size(); i++)
+    {
+        int colon = lines.at(i).indexOf(":");
+        if(colon <= 0)
+            continue;
+        QString key = lines.at(i).left(colon).trimmed();
+        QString value = lines.at(i).mid(colon+1).trimmed();
+
+        QString name;
+        bool separator = false;
+        for(int k=0; k<key.size(); k++)
+        {
+            QChar c = key.at(k);
+            if(c.isLetterOrNumber() && c.unicode() < 128)
+            {
+                if(separator && !name.isEmpty())
+                    name += '_';
+                name += c;
+                separator = false;
+            }
+            else
+                separator = true;
+        }
+        if(name.isEmpty())
+            continue;
+        if(!name.at(0).isLetter())
+            name = "f_" + name;
+        name = name.left(matNameLength - 3);
+
+        QString unique = name;
+        for(int n=2; _names.contains(unique); n++)
+            unique = name + "_" + QString::number(n);
+        _names.push_back(unique);
+        _values.push_back(value);
+    }
+}
+
+//Records the error and returns false
+bool SessionExporter::Fail(const QString &_error)
+{
+    this->m_errorString = _error;
+    return false;
+}
+
+//Writes the MAT v5 file
+bool SessionExporter::ExportMat(std::string _filename)
+{
+    QFile file(QString::fromStdString(_filename));
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return this->Fail("could not create " + file.fileName());
+
+    //Header of the file: 116 bytes of text, subsystem offset, version, byte order
+    QByteArray text = ("MATLAB 5.0 MAT-file, Platform: bl_sa_reachingsw, Created on: " +
+                       QDateTime::currentDateTime().toString("ddd MMM dd hh:mm:ss yyyy")).toLatin1();
+    QByteArray head(128, ' ');
+    memcpy(head.data(), text.constData(), qMin(text.size(), 116));
+    memset(head.data() + 116, 0, 8);
+    quint16 version = 0x0100;
+    quint16 endian = ('M' << 8) | 'I';
+    memcpy(head.data() + 124, &version, 2);
+    memcpy(head.data() + 126, &endian, 2);
+    if(file.write(head) != head.size())
+        return this->Fail("could not write " + file.fileName());
+
+    //header: one field per line of the header text
+    QStringList names, values;
+    QString headerText = this->reader->header();
+    ParseHeader(headerText, names, values);
+    QStringList fields = names;
+    fields.push_back("text");
+    QByteArray body;
+    AppendStructHeader(body, "header", 1, 1, fields);
+    QVector<double> numbers;
+    bool logical;
+    for(int i=0; i<names.size(); i++)
+    {
+        if(ParseValue(values.at(i), numbers, logical))
+        {
+            if(logical)
+            {
+                QVector<quint8> flags;
+                for(int k=0; k<numbers.size(); k++)
+                    flags.push_back(numbers.at(k) != 0);
+                AppendMatrix(body, "", mxUINT8, miUINT8, flags.constData(), 1, 1, flags.size(), matLogical);
+            }
+            else
+                AppendMatrix(body, "", mxDOUBLE, miDOUBLE, numbers.constData(), 8, 1, numbers.size());
+        }
+        else
+            AppendChar(body, "", values.at(i));
+    }
+    AppendChar(body, "", headerText);
+    QByteArray element;
+    AppendElement(element, miMATRIX, body.constData(), body.size());
+    if(file.write(element) != element.size())
+        return this->Fail("could not write " + file.fileName());
+
+    //trials: the size of the element is written once every trial is known
+    QStringList trialFields;
+    trialFields << "session" << "trial" << "startTime" << "t" << "rawX" << "rawY" << "x" << "y"
+                << "eventT" << "eventRawX" << "eventRawY" << "eventX" << "eventY" << "timing" << "latency" << "info";
+    qint64 elementOffset = file.pos();
+    quint32 tag[2] = {miMATRIX, 0};
+    if(file.write((const char*)tag, sizeof(tag)) != (qint64)sizeof(tag))
+        return this->Fail("could not write " + file.fileName());
+    body.clear();
+    AppendStructHeader(body, "trials", 1, this->vTrials.size(), trialFields);
+    if(file.write(body) != body.size())
+        return this->Fail("could not write " + file.fileName());
+    qint64 bytes = body.size();
+
+    QVector<qint64> times;
+    QVector<qint32> column;
+    for(int i=0; i<this->vTrials.size(); i++)
+    {
+        const Trial &trial = this->vTrials.at(i);
+        body.clear();
+        qint64 session = trial.session;
+        qint64 number = trial.trial;
+        AppendMatrix(body, "", mxINT64, miINT64, &session, 8, 1, 1);
+        AppendMatrix(body, "", mxINT64, miINT64, &number, 8, 1, 1);
+        AppendMatrix(body, "", mxINT64, miINT64, &trial.startTime, 8, 1, 1);
+
+        //Samples at the sampling frequency, then every input event
+        for(int stream=StreamGrid; stream<=StreamEvents; stream++)
+        {
+            int n = this->reader->Samples(trial.session, trial.trial, (SessionStream)stream, this->vSamples);
+            times.resize(n);
+            column.resize(n);
+            for(int k=0; k<n; k++)
+                times[k] = this->vSamples.at(k).timestamp;
+            AppendMatrix(body, "", mxINT64, miINT64, times.constData(), 8, n, 1);
+            for(int c=0; c<4; c++)
+            {
+                for(int k=0; k<n; k++)
+                {
+                    const CursorSample &s = this->vSamples.at(k);
+                    column[k] = c == 0 ? s.rawX : c == 1 ? s.rawY : c == 2 ? s.x : s.y;
+                }
+                AppendMatrix(body, "", mxINT32, miINT32, column.constData(), 4, n, 1);
+            }
+        }
+        AppendChar(body, "", trial.timingRecord >= 0 ? this->reader->Text(trial.timingRecord) : QString());
+        AppendChar(body, "", trial.latencyRecord >= 0 ? this->reader->Text(trial.latencyRecord) : QString());
+        AppendChar(body, "", trial.infoRecord >= 0 ? this->reader->Text(trial.infoRecord) : QString());
+
+        bytes += body.size();
+        if(bytes > 0xFFFFFFFFLL)
+            return this->Fail("session too large for a MAT v5 file, use the NumPy export");
+        if(file.write(body) != body.size())
+            return this->Fail("could not write " + file.fileName());
+    }
+
+    //Size of the trials element
+    tag[1] = (quint32)bytes;
+    if(!file.seek(elementOffset) || file.write((const char*)tag, sizeof(tag)) != (qint64)sizeof(tag))
+        return this->Fail("could not write " + file.fileName());
+    file.close();
+    return true;
+}
+
+//Header of a .npy file (format version 1.0)
+//The header is padded so the data starts at a multiple of 64 bytes
+bool SessionExporter::WriteNpyHeader(QFile &_file, const QString &_descr, qint64 _rows)
+{
+    QString dict = "{'descr': " + _descr + ", 'fortran_order': False, 'shape': (" +
+            QString::number(_rows) + ",), }";
+    QByteArray header = dict.toLatin1();
+    int total = 10 + header.size() + 1;
+    header.append(QByteArray((64 - total % 64) % 64, ' '));
+    header.append('\n');
+
+    QByteArray head("\x93NUMPY\x01\x00", 8);
+    quint16 length = header.size();
+    head.append((char)(length & 0xFF));
+    head.append((char)(length >> 8));
+    head.append(header);
+    return _file.write(head) == head.size();
+}
+
+//Writes every sample of a stream, trial after trial
+//Uncompressed blocks are written straight from the memory map
+bool SessionExporter::WriteNpyArray(const QString &_filename, const QString &_descr, qint64 _rows,
+                                    SessionStream _stream)
+{
+    QFile file(_filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return this->Fail("could not create " + _filename);
+    if(!this->WriteNpyHeader(file, _descr, _rows))
+        return this->Fail("could not write " + _filename);
+
+    for(int i=0; i<this->vTrials.size(); i++)
+    {
+        QVector<int> blocks = this->reader->Blocks(this->vTrials.at(i).session,
+                                                   this->vTrials.at(i).trial, _stream);
+        for(int k=0; k<blocks.size(); k++)
+        {
+            int count = this->reader->entry(blocks.at(k)).count;
+            const CursorSample *samples = this->reader->Samples(blocks.at(k));
+            if(samples == NULL)
+            {
+                this->vSamples.resize(count);
+                if(this->reader->Decode(blocks.at(k), this->vSamples.data()) != count)
+                    return this->Fail("damaged block in the session file");
+                samples = this->vSamples.constData();
+            }
+            qint64 bytes = (qint64)count * sizeof(CursorSample);
+            if(file.write((const char*)samples, bytes) != bytes)
+                return this->Fail("could not write " + _filename);
+        }
+    }
+    file.close();
+    return true;
+}
+
+//Writes the NumPy files
+bool SessionExporter::ExportNpy(std::string _prefix)
+{
+    QString prefix = QString::fromStdString(_prefix);
+    QString o(npyOrder);
+    QString sampleDescr = "[('t', '" + o + "i8'), ('rawX', '" + o + "i4'), ('rawY', '" + o +
+            "i4'), ('x', '" + o + "i4'), ('y', '" + o + "i4')]";
+
+    //Trials and their range in the sample arrays
+    qint64 gridRows = 0, eventRows = 0;
+    QVector<NpyTrialRow> rows;
+    for(int i=0; i<this->vTrials.size(); i++)
+    {
+        const Trial &trial = this->vTrials.at(i);
+        NpyTrialRow row;
+        row.session = trial.session;
+        row.trial = trial.trial;
+        row.startTime = trial.startTime;
+        row.gridStart = gridRows;
+        row.gridCount = trial.gridCount;
+        row.eventStart = eventRows;
+        row.eventCount = trial.eventCount;
+        rows.push_back(row);
+        gridRows += trial.gridCount;
+        eventRows += trial.eventCount;
+    }
+
+    if(!this->WriteNpyArray(prefix + "_grid.npy", sampleDescr, gridRows, StreamGrid))
+        return false;
+    if(!this->WriteNpyArray(prefix + "_events.npy", sampleDescr, eventRows, StreamEvents))
+        return false;
+
+    QFile file(prefix + "_trials.npy");
+    QString trialDescr = "[('session', '" + o + "i4'), ('trial', '" + o + "i4'), ('startTime', '" + o +
+            "i8'), ('gridStart', '" + o + "i8'), ('gridCount', '" + o + "i8'), ('eventStart', '" + o +
+            "i8'), ('eventCount', '" + o + "i8')]";
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            !this->WriteNpyHeader(file, trialDescr, rows.size()))
+        return this->Fail("could not create " + file.fileName());
+    qint64 bytes = rows.size() * sizeof(NpyTrialRow);
+    if(file.write((const char*)rows.constData(), bytes) != bytes)
+        return this->Fail("could not write " + file.fileName());
+    file.close();
+
+    //Header fields, numbers as numbers
+    QStringList names, values;
+    QString headerText = this->reader->header();
+    ParseHeader(headerText, names, values);
+    QJsonObject header;
+    QVector<double> numbers;
+    bool logical;
+    for(int i=0; i<names.size(); i++)
+    {
+        if(ParseValue(values.at(i), numbers, logical))
+        {
+            QJsonArray array;
+            for(int k=0; k<numbers.size(); k++)
+            {
+                if(logical)
+                    array.append(numbers.at(k) != 0);
+                else
+                    array.append(numbers.at(k));
+            }
+            if(array.size() == 1)
+                header.insert(names.at(i), array.at(0));
+            else
+                header.insert(names.at(i), array);
+        }
+        else
+            header.insert(names.at(i), values.at(i));
+    }
+    header.insert("text", headerText);
+    QFile json(prefix + "_header.json");
+    if(!json.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return this->Fail("could not create " + json.fileName());
+    QByteArray text = QJsonDocument(header).toJson();
+    if(json.write(text) != text.size())
+        return this->Fail("could not write " + json.fileName());
+    json.close();
+    return true;
+}
@@ -0,0 +1,101 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Exports a session file (see sessionformat.h) to files that
+ * the analysis scripts load without parsing text.
+ *
+ * MAT v5 (uncompressed, MATLAB and scipy.io.loadmat):
+ *   header: struct with one field per "Name: value" line of the header
+ *           (numbers as double) and the whole header in header.text
+ *   trials: 1xN struct array with session, trial, startTime (int64), the grid
+ *           samples (t, rawX, rawY, x, y), the input events (eventT,
+ *           eventRawX, eventRawY, eventX, eventY), the timing report, the
+ *           latency report and the trial parameters (info)
+ *
+ * NumPy (numpy.load):
+ *   <prefix>_grid.npy, <prefix>_events.npy: every sample of every trial,
+ *     structured array (t int64, rawX, rawY, x, y int32) laid out as
+ *     CursorSample, so the file is a copy of memory
+ *   <prefix>_trials.npy: session, trial, startTime and the range of each
+ *     trial in the two sample arrays
+ *   <prefix>_header.json: the header fields
+ *
+ * Trials are exported one at a time, so the memory used does not depend
+ * on the size of the session.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef SESSIONEXPORTER_H
+#define SESSIONEXPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QFile>
+#include "sessionfilereader.h"
+
+class SessionExporter
+{
+public:
+    //Constructor
+    //The reader must be open while the exporter is used
+    SessionExporter(SessionFileReader *_reader);
+
+    //Methods
+    //Writes the MAT v5 file
+    bool ExportMat(std::string _filename);
+    //Writes the NumPy files <prefix>_grid.npy, _events.npy, _trials.npy
+    //and _header.json
+    bool ExportNpy(std::string _prefix);
+
+    //"Name: value" lines of the header text, with the names converted
+    //to valid MATLAB identifiers
+    static void ParseHeader(const QString &_header, QStringList &_names, QStringList &_values);
+
+    //Getters
+    //Number of trials found in the session
+    int trials() const
+    {
+        return vTrials.size();
+    }
+    //Description of the last error
+    QString errorString() const
+    {
+        return m_errorString;
+    }
+
+private:
+    //A trial of the session
+    struct Trial
+    {
+        int session;
+        int trial;
+        qint64 startTime;
+        int timingRecord; //-1 if there is no timing report
+        int latencyRecord; //-1 if there is no latency report
+        int infoRecord; //-1 if there are no trial parameters
+        qint64 gridCount;
+        qint64 eventCount;
+    };
+
+    //Fields
+    SessionFileReader *reader;
+    QVector<Trial> vTrials;
+    //Samples of the trial being exported
+    QVector<CursorSample> vSamples;
+    QString m_errorString;
+
+    //Methods
+    void CollectTrials();
+    bool WriteNpyArray(const QString &_filename, const QString &_descr, qint64 _rows,
+                       SessionStream _stream);
+    bool WriteNpyHeader(QFile &_file, const QString &_descr, qint64 _rows);
+    bool Fail(const QString &_error);
+};
+
+#endif // SESSIONEXPORTER_H
@@ -0,0 +1,274 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "sessionfilereader.h"
+
+#include <string.h>
+#include <QDebug>
+
+//Default constructor
+SessionFileReader::SessionFileReader(std::string _filename)
+{
+    this->filename = _filename;
+    this->file.setFileName(QString::fromStdString(_filename));
+    this->data = NULL;
+    this->size = 0;
+    this->m_complete = false;
+    this->m_validBytes = 0;
+}
+
+//Destructor
+SessionFileReader::~SessionFileReader()
+{
+    this->Close();
+}
+
+//Maps the whole file and loads the index
+bool SessionFileReader::Open()
+{
+    if(!this->file.open(QIODevice::ReadOnly))
+        return false;
+    this->size = this->file.size();
+    if(this->size < (qint64)sizeof(SessionFileHeader))
+    {
+        this->Close();
+        return false;
+    }
+    this->data = this->file.map(0, this->size);
+    if(this->data == NULL)
+    {
+        this->Close();
+        return false;
+    }
+
+    const SessionFileHeader *header = (const SessionFileHeader*)this->data;
+    if(memcmp(header->magic, SESSION_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+            header->byteOrder != SESSION_BYTE_ORDER)
+    {
+        qDebug() << "Session: not a session file" << QString::fromStdString(this->filename);
+        this->Close();
+        return false;
+    }
+    //Every version changed how the records are read, so only the current
+    //one is accepted
+    if(header->version != SESSION_FORMAT_VERSION)
+    {
+        qDebug() << "Session: version" << header->version << "instead of" << SESSION_FORMAT_VERSION
+                 << QString::fromStdString(this->filename);
+        this->Close();
+        return false;
+    }
+    return this->LoadIndex();
+}
+
+//Unmaps and closes the file
+void SessionFileReader::Close()
+{
+    if(this->data != NULL)
+        this->file.unmap((uchar*)this->data);
+    this->data = NULL;
+    this->size = 0;
+    this->index.clear();
+    if(this->file.isOpen())
+        this->file.close();
+}
+
+//Reads the index from the footer or rebuilds it
+bool SessionFileReader::LoadIndex()
+{
+    const SessionFileHeader *header = (const SessionFileHeader*)this->data;
+    qint64 first = sizeof(SessionFileHeader) + header->headerBytes +
+            SessionPadding(header->headerBytes);
+    this->index.clear();
+    if(first > this->size)
+    {
+        qDebug() << "Session: the header is larger than the file" << QString::fromStdString(this->filename);
+        this->Close();
+        return false;
+    }
+
+    //Closed session: the footer points to the index
+    if(this->size >= first + (qint64)sizeof(SessionFileFooter))
+    {
+        const SessionFileFooter *footer = (const SessionFileFooter*)
+                (this->data + this->size - sizeof(SessionFileFooter));
+        qint64 indexBytes = (qint64)footer->entries * sizeof(TrialIndexEntry);
+        if(footer->magic == SESSION_INDEX_MAGIC &&
+                (qint64)footer->indexOffset >= first &&
+                (qint64)footer->indexOffset + indexBytes + (qint64)sizeof(SessionFileFooter) == this->size)
+        {
+            const TrialIndexEntry *entries = (const TrialIndexEntry*)(this->data + footer->indexOffset);
+            //Every payload must be between the header and the index
+            for(quint32 i=0; i<footer->entries; i++)
+            {
+                if(entries[i].offset < (quint64)first || entries[i].offset > footer->indexOffset ||
+                        entries[i].bytes > footer->indexOffset - entries[i].offset)
+                {
+                    qDebug() << "Session: entry" << i << "of the index is outside the records"
+                             << QString::fromStdString(this->filename);
+                    this->Close();
+                    return false;
+                }
+            }
+            this->index.resize(footer->entries);
+            memcpy(this->index.data(), entries, indexBytes);
+            this->m_complete = true;
+            this->m_validBytes = footer->indexOffset;
+            return true;
+        }
+    }
+
+    //The session was not closed: walks the records
+    this->m_complete = false;
+    this->ScanRecords(first);
+    return true;
+}
+
+//Rebuilds the index by walking the records from _offset
+//Stops at the first record that is damaged or incomplete
+void SessionFileReader::ScanRecords(qint64 _offset)
+{
+    qint64 offset = _offset;
+    this->m_validBytes = offset;
+    while(offset + (qint64)sizeof(TrialRecordHeader) <= this->size)
+    {
+        const TrialRecordHeader *record = (const TrialRecordHeader*)(this->data + offset);
+        if(record->magic != SESSION_RECORD_MAGIC)
+            break;
+        qint64 payload = offset + sizeof(TrialRecordHeader);
+        qint64 end = payload + record->bytes + SessionPadding(record->bytes);
+        if(end > this->size)
+            break;
+        //Block that was only partially written
+        if(SessionChecksum((const char*)(this->data + payload), record->bytes) != record->checksum)
+            break;
+
+        TrialIndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.session = record->session;
+        entry.trial = record->trial;
+        entry.stream = record->stream;
+        entry.count = record->count;
+        entry.offset = payload;
+        entry.bytes = record->bytes;
+        entry.sequence = record->sequence;
+        entry.flags = record->flags;
+        entry.run = record->run;
+        entry.startTime = record->startTime;
+        this->index.push_back(entry);
+
+        offset = end;
+        this->m_validBytes = offset;
+    }
+}
+
+//Finds the first block of a stream
+int SessionFileReader::Find(int _session, int _trial, SessionStream _stream) const
+{
+    QVector<int> blocks = this->Blocks(_session, _trial, _stream);
+    if(blocks.isEmpty())
+        return -1;
+    return blocks.first();
+}
+
+//Blocks of a stream of a trial
+//Blocks are written in order, so they are returned in the order of the file
+QVector<int> SessionFileReader::Blocks(int _session, int _trial, SessionStream _stream) const
+{
+    //Chooses the last run that finished the stream, or else the last run
+    int lastRun = -1;
+    int finalRun = -1;
+    for(int i=0; i<this->index.size(); i++)
+    {
+        const TrialIndexEntry &e = this->index.at(i);
+        if((int)e.session != _session || (int)e.trial != _trial || e.stream != (quint32)_stream)
+            continue;
+        lastRun = qMax(lastRun, (int)e.run);
+        if(e.flags & RecordFinal)
+            finalRun = qMax(finalRun, (int)e.run);
+    }
+    int run = finalRun >= 0 ? finalRun : lastRun;
+
+    QVector<int> blocks;
+    for(int i=0; i<this->index.size(); i++)
+    {
+        const TrialIndexEntry &e = this->index.at(i);
+        if((int)e.session == _session && (int)e.trial == _trial &&
+                e.stream == (quint32)_stream && (int)e.run == run)
+            blocks.push_back(i);
+    }
+    return blocks;
+}
+
+//Copies the samples of every block of a stream
+int SessionFileReader::Samples(int _session, int _trial, SessionStream _stream,
+                               QVector<CursorSample> &_samples) const
+{
+    QVector<int> blocks = this->Blocks(_session, _trial, _stream);
+    int total = 0;
+    for(int i=0; i<blocks.size(); i++)
+        total += this->index.at(blocks.at(i)).count;
+    _samples.resize(total);
+
+    int n = 0;
+    for(int i=0; i<blocks.size(); i++)
+    {
+        int count = this->Decode(blocks.at(i), _samples.data() + n);
+        if(count < 0)
+            break;
+        n += count;
+    }
+    _samples.resize(n);
+    return n;
+}
+
+//Pointer to the samples of a record
+const CursorSample* SessionFileReader::Samples(int _record) const
+{
+    if(this->data == NULL || _record < 0 || _record >= this->index.size())
+        return NULL;
+    if(this->index.at(_record).flags & RecordCompressed)
+        return NULL;
+    return (const CursorSample*)(this->data + this->index.at(_record).offset);
+}
+
+//Copies the samples of a block, decoding it if needed
+int SessionFileReader::Decode(int _record, CursorSample *_samples) const
+{
+    if(this->data == NULL || _record < 0 || _record >= this->index.size())
+        return -1;
+    const TrialIndexEntry &e = this->index.at(_record);
+    const uchar *payload = this->data + e.offset;
+    if(e.flags & RecordCompressed)
+    {
+        if(TrajectoryCodec::Count(payload, e.bytes) != (int)e.count)
+            return -1;
+        return TrajectoryCodec::Decode(payload, e.bytes, _samples);
+    }
+    if((qint64)e.bytes < (qint64)e.count * (qint64)sizeof(CursorSample))
+        return -1;
+    memcpy(_samples, payload, (size_t)e.count * sizeof(CursorSample));
+    return e.count;
+}
+
+//Text of a record
+QString SessionFileReader::Text(int _record) const
+{
+    if(this->data == NULL || _record < 0 || _record >= this->index.size())
+        return QString();
+    const TrialIndexEntry &e = this->index.at(_record);
+    return QString::fromUtf8((const char*)(this->data + e.offset), e.bytes);
+}
+
+//Header text
+QString SessionFileReader::header() const
+{
+    if(this->data == NULL)
+        return QString();
+    const SessionFileHeader *h = (const SessionFileHeader*)this->data;
+    return QString::fromUtf8((const char*)(this->data + sizeof(SessionFileHeader)), h->headerBytes);
+}
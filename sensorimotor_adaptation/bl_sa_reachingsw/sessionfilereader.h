@@ -0,0 +1,98 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Reads a session file (see sessionformat.h) through a memory
+ * map. The samples of any block are returned as pointers into the map, so
+ * no data is copied. If the file has no trial index (the session was not
+ * closed) the index is rebuilt by walking the records, up to the first
+ * block that is incomplete or fails its checksum.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef SESSIONFILEREADER_H
+#define SESSIONFILEREADER_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "sessionformat.h"
+#include "trajectorycodec.h"
+
+class SessionFileReader
+{
+public:
+    //Constructor
+    SessionFileReader(std::string _filename);
+    ~SessionFileReader();
+
+    //Fields
+    std::string filename;
+
+    //Methods
+    //Maps the file and loads the trial index
+    //False if the header or an entry of the index points outside the file
+    bool Open();
+    //Unmaps the file
+    void Close();
+    //Finds the first block of a stream of a trial, -1 if it does not exist
+    int Find(int _session, int _trial, SessionStream _stream) const;
+    //Blocks of a stream of a trial, in order
+    //If the trial was recorded more than once (the session was resumed
+    //during the trial) the blocks of the last complete run are returned
+    QVector<int> Blocks(int _session, int _trial, SessionStream _stream) const;
+    //Samples of a block (valid while the file is open)
+    //NULL if the block is compressed, see Decode()
+    const CursorSample* Samples(int _record) const;
+    //Copies the samples of a block into _samples, which must hold
+    //entry(_record).count samples; returns the number of samples, -1 if damaged
+    int Decode(int _record, CursorSample *_samples) const;
+    //Copies every sample of a stream of a trial, returns the number of samples
+    int Samples(int _session, int _trial, SessionStream _stream,
+                QVector<CursorSample> &_samples) const;
+    //Text of a record
+    QString Text(int _record) const;
+
+    //Getters
+    //Header text written when the session was created
+    QString header() const;
+    //Number of records
+    int records() const
+    {
+        return index.size();
+    }
+    //Index entry of a record
+    const TrialIndexEntry& entry(int _record) const
+    {
+        return index.at(_record);
+    }
+    //False if the index was rebuilt because the file was not closed
+    bool complete() const
+    {
+        return m_complete;
+    }
+    //Bytes up to the end of the last complete record
+    qint64 validBytes() const
+    {
+        return m_validBytes;
+    }
+
+private:
+    //Fields
+    QFile file;
+    const uchar *data;
+    qint64 size;
+    QVector<TrialIndexEntry> index;
+    bool m_complete;
+    qint64 m_validBytes;
+
+    //Methods
+    bool LoadIndex();
+    void ScanRecords(qint64 _offset);
+};
+
+#endif // SESSIONFILEREADER_H
@@ -0,0 +1,247 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "sessionfilewriter.h"
+#include "sessionfilereader.h"
+
+#include <string.h>
+#include <QDateTime>
+#include <QFile>
+#include <QDebug>
+
+//Default constructor
+SessionFileWriter::SessionFileWriter(std::string _filename)
+{
+    this->filename = _filename;
+    this->fileController = new DataFileController(_filename);
+    //The session is forced to the disk when it is closed
+    this->fileController->setFlushPolicy(DataFileController::FlushOnClose);
+    this->position = 0;
+    this->m_run = 1;
+    this->opened = false;
+    this->m_compression = false;
+    this->loadedComplete = false;
+}
+
+//Destructor
+//Closing writes the index, so an open session is still readable
+SessionFileWriter::~SessionFileWriter()
+{
+    this->Close();
+    delete this->fileController;
+}
+
+//Creates the file and writes the header block
+bool SessionFileWriter::Open(const QString &_header)
+{
+    if(!this->fileController->Open())
+        return false;
+    this->opened = true;
+    this->index.clear();
+    this->position = 0;
+    this->m_run = 1;
+
+    QByteArray text = _header.toUtf8();
+    SessionFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SESSION_FILE_MAGIC, sizeof(header.magic));
+    header.version = SESSION_FORMAT_VERSION;
+    header.byteOrder = SESSION_BYTE_ORDER;
+    header.headerBytes = text.size();
+    header.created = QDateTime::currentMSecsSinceEpoch();
+
+    this->fileController->WriteBytes((const char*)&header, sizeof(header));
+    this->fileController->WriteBytes(text.constData(), text.size());
+    this->position += sizeof(header) + text.size();
+    this->WritePadding(text.size());
+    this->fileController->Submit();
+    return true;
+}
+
+//Reads the index of a session that was written before
+//The file is not changed
+bool SessionFileWriter::Load()
+{
+    if(this->opened || !QFile::exists(QString::fromStdString(this->filename)))
+        return false;
+
+    SessionFileReader reader(this->filename);
+    if(!reader.Open())
+        return false;
+    this->index.clear();
+    this->m_run = 1;
+    for(int i=0; i<reader.records(); i++)
+    {
+        this->index.push_back(reader.entry(i));
+        if((int)reader.entry(i).run >= this->m_run)
+            this->m_run = reader.entry(i).run + 1;
+    }
+    this->position = reader.validBytes();
+    this->loadedComplete = reader.complete();
+    reader.Close();
+    return true;
+}
+
+//Reopens a session that was written before
+//The index of the blocks already in the file is kept, the damaged or
+//incomplete block at the end (if any) and the old index are cut off
+bool SessionFileWriter::Resume()
+{
+    if(!this->Load())
+        return false;
+    bool complete = this->loadedComplete;
+
+    QString name = QString::fromStdString(this->filename);
+    QFile file(name);
+    if(!file.resize(this->position))
+    {
+        qDebug() << "Session: could not truncate" << name;
+        return false;
+    }
+    if(!complete)
+        qDebug() << "Session: recovered" << this->index.size() << "blocks from" << name;
+
+    if(!this->fileController->Open(true))
+        return false;
+    this->opened = true;
+    return true;
+}
+
+//Appends a block of samples of a trial
+bool SessionFileWriter::WriteSamples(int _session, int _trial, SessionStream _stream,
+                                     qint64 _startTime, const CursorSample *_samples, int _count,
+                                     int _sequence, bool _final)
+{
+    quint32 flags = _final ? RecordFinal : 0;
+    if(this->m_compression)
+    {
+        //The buffer keeps its size, so blocks of the same size do not allocate
+        int size = TrajectoryCodec::MaxEncodedSize(_count);
+        if(this->encoded.size() < size)
+            this->encoded.resize(size);
+        int bytes = this->codec.Encode(_samples, _count, (uchar*)this->encoded.data());
+        return this->WriteRecord(_session, _trial, _stream, _startTime, _count,
+                                 this->encoded.constData(), bytes, _sequence,
+                                 flags | RecordCompressed);
+    }
+    return this->WriteRecord(_session, _trial, _stream, _startTime, _count,
+                             (const char*)_samples, _count * sizeof(CursorSample),
+                             _sequence, flags);
+}
+
+//Appends text of a trial
+bool SessionFileWriter::WriteText(int _session, int _trial, SessionStream _stream,
+                                  qint64 _startTime, const QString &_text)
+{
+    QByteArray text = _text.toUtf8();
+    return this->WriteRecord(_session, _trial, _stream, _startTime, text.size(),
+                             text.constData(), text.size(), 0, RecordFinal);
+}
+
+//Writes the record header, the payload and the padding
+//The block is handed to the I/O thread right away, so it is not lost if
+//the application stops before the end of the trial
+bool SessionFileWriter::WriteRecord(int _session, int _trial, SessionStream _stream,
+                                    qint64 _startTime, quint32 _count,
+                                    const char *_payload, quint32 _bytes,
+                                    int _sequence, quint32 _flags)
+{
+    if(!this->opened)
+        return false;
+
+    TrialRecordHeader record;
+    memset(&record, 0, sizeof(record));
+    record.magic = SESSION_RECORD_MAGIC;
+    record.session = _session;
+    record.trial = _trial;
+    record.stream = _stream;
+    record.count = _count;
+    record.bytes = _bytes;
+    record.sequence = _sequence;
+    record.flags = _flags;
+    record.checksum = SessionChecksum(_payload, _bytes);
+    record.run = this->m_run;
+    record.startTime = _startTime;
+    this->fileController->WriteBytes((const char*)&record, sizeof(record));
+    this->position += sizeof(record);
+
+    //The index points to the payload
+    TrialIndexEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.session = _session;
+    entry.trial = _trial;
+    entry.stream = _stream;
+    entry.count = _count;
+    entry.offset = this->position;
+    entry.bytes = _bytes;
+    entry.sequence = record.sequence;
+    entry.flags = record.flags;
+    entry.run = record.run;
+    entry.startTime = _startTime;
+    this->index.push_back(entry);
+
+    this->fileController->WriteBytes(_payload, _bytes);
+    this->position += _bytes;
+    this->WritePadding(_bytes);
+    this->fileController->Submit();
+    return true;
+}
+
+//Forces the blocks written so far to the disk
+bool SessionFileWriter::Sync()
+{
+    if(!this->opened)
+        return false;
+    return this->fileController->Flush();
+}
+
+//Last trial with the final block of its samples at the sampling frequency
+bool SessionFileWriter::LastCompleteTrial(int &_session, int &_trial) const
+{
+    for(int i=this->index.size()-1; i>=0; i--)
+    {
+        const TrialIndexEntry &e = this->index.at(i);
+        if(e.stream == (quint32)StreamGrid && (e.flags & RecordFinal))
+        {
+            _session = e.session;
+            _trial = e.trial;
+            return true;
+        }
+    }
+    return false;
+}
+
+//Aligns the next block to 8 bytes
+void SessionFileWriter::WritePadding(qint64 _bytes)
+{
+    static const char zeros[8] = {0,0,0,0,0,0,0,0};
+    qint64 padding = SessionPadding(_bytes);
+    if(padding > 0)
+    {
+        this->fileController->WriteBytes(zeros, padding);
+        this->position += padding;
+    }
+}
+
+//Writes the trial index and the footer
+bool SessionFileWriter::Close()
+{
+    if(!this->opened)
+        return false;
+
+    SessionFileFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.magic = SESSION_INDEX_MAGIC;
+    footer.entries = this->index.size();
+    footer.indexOffset = this->position;
+    this->fileController->WriteBytes((const char*)this->index.constData(),
+                                     this->index.size() * sizeof(TrialIndexEntry));
+    this->fileController->WriteBytes((const char*)&footer, sizeof(footer));
+    this->fileController->Close();
+    this->opened = false;
+    return true;
+}
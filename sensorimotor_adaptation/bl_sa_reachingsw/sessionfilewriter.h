@@ -0,0 +1,109 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Writes the session file of an experiment (see sessionformat.h).
+ * Blocks are appended while the trials are recorded and each one is handed
+ * to the I/O thread as soon as it is complete. The trial index is written
+ * when the session is closed. A session that was not closed (crash, forced
+ * close) can be resumed: the file is cut after the last complete block and
+ * new blocks are appended with the next run number. Load() reads the index
+ * first without changing the file, so the caller can decide not to resume
+ * (e.g. the experiment was finished).
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef SESSIONFILEWRITER_H
+#define SESSIONFILEWRITER_H
+
+#include <QString>
+#include <QVector>
+#include "sessionformat.h"
+#include "datafilecontroller.h"
+#include "trajectorycodec.h"
+
+class SessionFileWriter
+{
+public:
+    //Constructor
+    SessionFileWriter(std::string _filename);
+    ~SessionFileWriter();
+
+    //Fields
+    std::string filename;
+
+    //Methods
+    //Creates the file and writes the header block
+    bool Open(const QString &_header);
+    //Reads the index of an existing session without changing the file, so
+    //LastCompleteTrial() can be checked before resuming
+    //Returns false if the file does not exist or is not a session file
+    bool Load();
+    //Opens an existing session to append to it
+    //Returns false if the file does not exist or is not a session file
+    bool Resume();
+    //Appends a block of samples of a trial
+    //_sequence: number of the block within the stream, _final: last block
+    bool WriteSamples(int _session, int _trial, SessionStream _stream, qint64 _startTime,
+                      const CursorSample *_samples, int _count,
+                      int _sequence = 0, bool _final = true);
+    //Appends a text stream of a trial (single block)
+    bool WriteText(int _session, int _trial, SessionStream _stream, qint64 _startTime,
+                   const QString &_text);
+    //Forces the blocks written so far to the disk
+    bool Sync();
+    //Last trial whose samples were completely written
+    //Returns false if there is none
+    bool LastCompleteTrial(int &_session, int &_trial) const;
+    //Writes the trial index and closes the file
+    bool Close();
+
+    //Getters
+    bool isOpen() const
+    {
+        return opened;
+    }
+    //Number of records written so far
+    int records() const
+    {
+        return index.size();
+    }
+    //Sample blocks are compressed by TrajectoryCodec
+    void setCompression(bool enabled)
+    {
+        m_compression = enabled;
+    }
+    bool compression() const
+    {
+        return m_compression;
+    }
+    //Incremented every time the session is resumed (starts at 1)
+    int run() const
+    {
+        return m_run;
+    }
+
+private:
+    //Fields
+    DataFileController *fileController;
+    QVector<TrialIndexEntry> index;
+    qint64 position; //Bytes written so far
+    int m_run;
+    bool opened;
+    bool m_compression;
+    bool loadedComplete; //The index read by Load() was complete
+    TrajectoryCodec codec;
+    QByteArray encoded; //Reused for every compressed block
+
+    //Methods
+    bool WriteRecord(int _session, int _trial, SessionStream _stream, qint64 _startTime,
+                     quint32 _count, const char *_payload, quint32 _bytes,
+                     int _sequence, quint32 _flags);
+    void WritePadding(qint64 _bytes);
+};
+
+#endif // SESSIONFILEWRITER_H
@@ -0,0 +1,146 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Layout of the session file, a single append-only binary file
+ * per experiment:
+ *
+ *   SessionFileHeader | header text (UTF-8, padded to 8 bytes)
+ *   TrialRecordHeader | payload (padded to 8 bytes)     <- one per block
+ *   ...
+ *   TrialIndexEntry[entries] | SessionFileFooter        <- written on close
+ *
+ * Trials are streamed while they are recorded: every stream of a trial is a
+ * sequence of blocks of at most a fixed number of samples, and the last block
+ * carries RecordFinal. Each block has a CRC-32 of its payload, so after a
+ * crash the file is valid up to the last complete block. Sample payloads are
+ * arrays of CursorSample, so a memory-mapped file can be read without copying,
+ * or blocks encoded by TrajectoryCodec (RecordCompressed).
+ * Blocks written after a restart carry a higher run number.
+ * All fields are in the byte order of the machine that wrote the file,
+ * which is identified by SessionFileHeader::byteOrder.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef SESSIONFORMAT_H
+#define SESSIONFORMAT_H
+
+#include <QtGlobal>
+#include "samplebuffer.h" //CursorSample
+
+//Version of the layout (3: sample blocks may be encoded by TrajectoryCodec)
+#define SESSION_FORMAT_VERSION 3
+//Magic numbers
+#define SESSION_FILE_MAGIC "BLSASESS"
+#define SESSION_RECORD_MAGIC 0x324C5254 //"TRL2"
+#define SESSION_INDEX_MAGIC 0x58444E49 //"INDX"
+#define SESSION_BYTE_ORDER 0x01020304
+
+//Streams stored for each trial
+enum SessionStream
+{
+    StreamGrid = 0, //CursorSample at the sampling frequency
+    StreamEvents = 1, //CursorSample for every input event
+    StreamTiming = 2, //Text: TimingStats::Report()
+    StreamLatency = 3, //Text: LatencyTracker::Report()
+    StreamTrialInfo = 4, //Text: target of the trial and whether it was reached
+    StreamFrames = 5 //Text: FrameScheduler::Summary()
+};
+
+//Flags of a record
+enum SessionRecordFlags
+{
+    RecordFinal = 1, //Last block of the stream of the trial
+    RecordCompressed = 2 //Samples encoded by TrajectoryCodec
+};
+
+struct SessionFileHeader
+{
+    char magic[8]; //SESSION_FILE_MAGIC, not null terminated
+    quint32 version; //SESSION_FORMAT_VERSION
+    quint32 byteOrder; //SESSION_BYTE_ORDER as written by the machine
+    quint32 headerBytes; //Size of the header text (without padding)
+    quint32 reserved;
+    qint64 created; //ms since the epoch
+};
+
+struct TrialRecordHeader
+{
+    quint32 magic; //SESSION_RECORD_MAGIC
+    quint32 session; //Session number (starts at 1)
+    quint32 trial; //Trial number (starts at 1)
+    quint32 stream; //SessionStream
+    quint32 count; //Number of samples (bytes for text streams)
+    quint32 bytes; //Size of the payload (without padding)
+    quint32 sequence; //Block number within the stream of the trial
+    quint32 flags; //SessionRecordFlags
+    quint32 checksum; //CRC-32 of the payload
+    quint32 run; //Incremented every time the session is resumed
+    qint64 startTime; //Monotonic time of the start of the trial (ns)
+};
+
+struct TrialIndexEntry
+{
+    quint32 session;
+    quint32 trial;
+    quint32 stream;
+    quint32 count;
+    quint64 offset; //Offset of the payload in the file
+    quint32 bytes;
+    quint32 sequence;
+    quint32 flags;
+    quint32 run;
+    qint64 startTime;
+};
+
+struct SessionFileFooter
+{
+    quint32 magic; //SESSION_INDEX_MAGIC
+    quint32 entries; //Number of TrialIndexEntry
+    quint64 indexOffset; //Offset of the first TrialIndexEntry
+};
+
+//Payloads are padded so every record starts aligned to 8 bytes
+inline qint64 SessionPadding(qint64 _bytes)
+{
+    return (8 - (_bytes % 8)) % 8;
+}
+
+//Table of the CRC-32, built once (thread-safe static initialization)
+struct SessionChecksumTable
+{
+    quint32 values[256];
+    SessionChecksumTable()
+    {
+        for(quint32 i=0; i<256; i++)
+        {
+            quint32 c = i;
+            for(int k=0; k<8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+            values[i] = c;
+        }
+    }
+};
+
+//CRC-32 (IEEE 802.3) of the payload of a record
+inline quint32 SessionChecksum(const char *_data, qint64 _size)
+{
+    static const SessionChecksumTable table;
+    quint32 crc = 0xFFFFFFFFu;
+    const uchar *p = (const uchar*)_data;
+    for(qint64 i=0; i<_size; i++)
+        crc = table.values[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static_assert(sizeof(CursorSample) == 24, "CursorSample layout is part of the session format");
+static_assert(sizeof(SessionFileHeader) == 32, "SessionFileHeader layout changed");
+static_assert(sizeof(TrialRecordHeader) == 48, "TrialRecordHeader layout changed");
+static_assert(sizeof(TrialIndexEntry) == 48, "TrialIndexEntry layout changed");
+static_assert(sizeof(SessionFileFooter) == 16, "SessionFileFooter layout changed");
+
+#endif // SESSIONFORMAT_H
@@ -0,0 +1,276 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Runs a protocol with synthetic subjects (OfcSubject) instead
+ * of a person, faster than real time. The trial logic is the one of the
+ * task (ProtocolController in simulated mode): the subject moves the cursor
+ * with input events at 1 kHz, sees the visual feedback computed by
+ * CursorController, and the trials are sampled, recorded in the session
+ * file and saved as in an experiment, on a virtual clock.
+ * Used to pilot protocols (the adaptation of the subjects, the duration of
+ * the experiment) and to stress-test and benchmark the acquisition and
+ * storage pipeline with thousands of trials.
+ * Each subject: reaches the target after a reaction time once the trial
+ * starts, and returns to the origin during the rest. The aim is adapted
+ * after every reach with the initial direction error (only when the
+ * feedback was shown). The single-state model fitted by the task during
+ * the experiment is reported next to the retention and learning rate of
+ * the subject.
+ * Usage: bl_sa_simulate [-protocol file] [-subjects N] [-seed N]
+ *                       [-prefix name] [-rate Hz] [-size WxH]
+ *                       [-log file.csv] [-verbose]
+ * Each subject writes <prefix>_s<N>_session.dat.
+ * ----------------------------------------------------------------------------
+*/
+
+#include <QApplication>
+#include <QWidget>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QtMath>
+#include "protocolcontroller.h"
+#include "protocolcompiler.h"
+#include "ofcsubject.h"
+#include "asyncwriter.h"
+#include "datafilecontroller.h"
+#include "monotonicclock.h"
+
+//The messages of every trial are only shown with -verbose
+static bool verbose = false;
+
+static void MessageHandler(QtMsgType _type, const QMessageLogContext &_context, const QString &_message)
+{
+    Q_UNUSED(_context);
+    if(_type == QtDebugMsg && !verbose)
+        return;
+    QTextStream(stderr) << _message << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    //No display is needed unless another platform is chosen
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication a(argc, argv);
+    qInstallMessageHandler(MessageHandler);
+    QTextStream out(stdout);
+
+    //Times of the subject (ns)
+    const qint64 reactionTime = 250000000LL;
+    const qint64 returnDelay = 300000000LL;
+    //A trial that does not end in this time stops the simulation
+    const qint64 trialTimeout = 60000000000LL;
+
+    QString protocolFile;
+    QString prefix;
+    QString logFile;
+    int subjects = 1;
+    quint64 seed = 1;
+    int rate = 1000;
+    int width = 1920;
+    int height = 1080;
+    QStringList arguments = a.arguments();
+    for(int i=1; i<arguments.size(); i++)
+    {
+        if(arguments.at(i) == "-protocol" && i+1 < arguments.size())
+            protocolFile = arguments.at(++i);
+        else if(arguments.at(i) == "-subjects" && i+1 < arguments.size())
+            subjects = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-seed" && i+1 < arguments.size())
+            seed = arguments.at(++i).toULongLong();
+        else if(arguments.at(i) == "-prefix" && i+1 < arguments.size())
+            prefix = arguments.at(++i);
+        else if(arguments.at(i) == "-rate" && i+1 < arguments.size())
+            rate = arguments.at(++i).toInt();
+        else if(arguments.at(i) == "-size" && i+1 < arguments.size())
+        {
+            QStringList size = arguments.at(++i).split('x');
+            width = size.first().toInt();
+            height = size.last().toInt();
+        }
+        else if(arguments.at(i) == "-log" && i+1 < arguments.size())
+            logFile = arguments.at(++i);
+        else if(arguments.at(i) == "-verbose")
+            verbose = true;
+        else
+        {
+            out << "Usage: bl_sa_simulate [-protocol file] [-subjects N] [-seed N] [-prefix name]"
+                << " [-rate Hz] [-size WxH] [-log file.csv] [-verbose]\n";
+            return 1;
+        }
+    }
+    if(subjects < 1 || rate < 100 || width < 1 || height < 1)
+    {
+        out << "Invalid options\n";
+        return 1;
+    }
+
+    ProtocolDefinition definition;
+    QString error;
+    if(!protocolFile.isEmpty() && !ProtocolCompiler::Load(protocolFile, definition, error))
+    {
+        out << error << "\n";
+        return 1;
+    }
+    if(prefix.isEmpty())
+        prefix = definition.fileprefix;
+    //A simulation never continues the files of another run, and only writes
+    //the text files when the protocol file asks for them
+    definition.resumeSession = false;
+    if(protocolFile.isEmpty())
+        definition.saveTextFiles = false;
+    //-verbose also prints the reports of every trial
+    if(verbose)
+        definition.verbose = true;
+
+    //One line per trial: subject, trial, aim and initial direction error
+    QFile log(logFile);
+    QTextStream logStream(&log);
+    if(!logFile.isEmpty())
+    {
+        if(!log.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            out << "Could not write " << logFile << "\n";
+            return 1;
+        }
+        logStream << "subject,trial,feedback,aim,error\n";
+    }
+
+    qint64 step = 1000000000LL / rate;
+    qint64 wallStart = MonotonicClock::Now();
+    qint64 virtualTotal = 0;
+    quint64 events = 0;
+    int trialsTotal = 0;
+    int failed = 0;
+
+    for(int s=1; s<=subjects; s++)
+    {
+        definition.fileprefix = prefix + "_s" + QString::number(s);
+        QWidget window;
+        ProtocolController protocol(&window, definition);
+        //The screen of the offscreen platform is smaller than a monitor
+        window.setWindowState(Qt::WindowNoState);
+        window.setGeometry(0, 0, width, height);
+        protocol.setSimulated(true);
+        protocol.Initialize();
+        protocol.BeginExperiment();
+
+        QPoint origin = protocol.originPosition();
+        QPoint target = protocol.targetPosition();
+        OfcParameters parameters;
+        parameters.dt = 1.0 / rate;
+        parameters.distance = qSqrt(qPow(target.x() - origin.x(), 2) + qPow(target.y() - origin.y(), 2));
+        //Every reach is the 0.2 m of the script
+        parameters.pixelsPerMeter = parameters.distance / 0.2;
+        parameters.seed = seed + s - 1;
+        OfcSubject subject(parameters);
+        subject.Place(origin.x(), origin.y());
+
+        qint64 samplePeriod = 1000000000LL / definition.samplingFrequency;
+        qint64 framePeriod = protocol.frameScheduler()->framePeriod();
+        qint64 t = 0;
+        qint64 nextSample = samplePeriod;
+        qint64 nextFrame = 0;
+        //0: waiting for the trial, 1: reaction time, 2: reaching, 3: before returning
+        int phase = 0;
+        qint64 phaseTime = 0;
+        bool feedback = true;
+        int trials = 0;
+        protocol.MoveCursor(origin.x(), origin.y(), t);
+
+        while(!protocol.finished())
+        {
+            t += step;
+            //The subject sees the feedback when it is shown, and the hand
+            //otherwise
+            QPoint seen = protocol.feedbackPosition();
+            double x, y;
+            if(protocol.feedbackVisible())
+                subject.Step(seen.x(), seen.y(), x, y);
+            else
+                subject.Step(subject.handX(), subject.handY(), x, y);
+            protocol.MoveCursor(x, y, t);
+            events++;
+
+            if(t >= nextFrame)
+            {
+                protocol.updateGUI();
+                nextFrame += framePeriod;
+            }
+            if(t >= nextSample)
+            {
+                protocol.Advance(t);
+                nextSample += samplePeriod;
+            }
+
+            if(phase == 0 && protocol.trialRunning())
+            {
+                phase = 1;
+                phaseTime = t + reactionTime;
+            }
+            else if(phase == 1 && t >= phaseTime)
+            {
+                target = protocol.targetPosition();
+                feedback = protocol.feedbackVisible();
+                subject.StartMovement(target.x(), target.y(), true);
+                phase = 2;
+                phaseTime = t;
+            }
+            else if(phase == 2 && !protocol.trialRunning())
+            {
+                trials++;
+                double aim = subject.aim();
+                double reachError = feedback ? subject.initialError() : 0;
+                subject.Adapt(reachError);
+                if(!logFile.isEmpty())
+                    logStream << s << "," << trials << "," << (feedback ? 1 : 0) << ","
+                              << QString::number(aim, 'f', 3) << "," << QString::number(reachError, 'f', 3) << "\n";
+                phase = 3;
+                phaseTime = t + returnDelay;
+            }
+            else if(phase == 3 && t >= phaseTime)
+            {
+                subject.StartMovement(origin.x(), origin.y(), false);
+                phase = 0;
+            }
+            else if(phase == 2 && t - phaseTime > trialTimeout)
+            {
+                out << "Subject " << s << ": trial " << trials+1 << " did not end\n";
+                failed++;
+                break;
+            }
+        }
+        virtualTotal += t;
+        trialsTotal += trials;
+        out << "Subject " << s << ": " << trials << " trials, " << QString::number(t / 1e9, 'f', 1)
+            << " s of experiment, final aim " << QString::number(subject.aim(), 'f', 2)
+            << " degrees -> " << definition.fileprefix << "_session.dat\n";
+        //Single-state model fitted by the task, against the one of the subject
+        AdaptationParameters fitted;
+        if(protocol.singleStateFit().Estimate(fitted))
+            out << "  fitted retention " << QString::number(fitted.retention, 'f', 4)
+                << " (subject " << parameters.retention << "), learning rate "
+                << QString::number(fitted.learningRate, 'f', 4) << " (subject " << parameters.learningRate << ")\n";
+    }
+    DataFileController::WaitForWrites();
+    qint64 wall = MonotonicClock::Now() - wallStart;
+
+    AsyncWriter::Stats io = AsyncWriter::instance()->stats();
+    double seconds = wall / 1e9;
+    out << "Trials: " << trialsTotal << " in " << QString::number(seconds, 'f', 2) << " s ("
+        << QString::number(trialsTotal / seconds, 'f', 1) << " trials/s, "
+        << QString::number(virtualTotal / (double)wall, 'f', 1) << "x real time)\n";
+    out << "Input events: " << events << " (" << QString::number(events / seconds / 1e6, 'f', 2) << " M/s)\n";
+    out << "Writer: " << io.bytes << " bytes (" << QString::number(io.bytes / seconds / 1048576.0, 'f', 1)
+        << " MB/s), max queue depth " << io.maxDepth << ", stalls " << io.stalls
+        << ", errors " << io.errors << "\n";
+
+    if(!logFile.isEmpty())
+        log.close();
+    AsyncWriter::Shutdown();
+    return failed > 0 || io.errors > 0 ? 1 : 0;
+}
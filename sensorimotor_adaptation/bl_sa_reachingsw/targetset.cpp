@@ -0,0 +1,207 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "targetset.h"
+
+#include <QtMath>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TARGETSET_SSE2
+#endif
+
+TargetSet::TargetSet()
+{
+    this->Clear();
+}
+
+void TargetSet::Clear()
+{
+    this->m_count = 0;
+    for(int i=0; i<this->maxTargets; i++)
+    {
+        this->x[i] = 0;
+        this->y[i] = 0;
+        this->radius2[i] = -1;
+        this->m_radius[i] = 0;
+    }
+    this->gridX = 0;
+    this->gridY = 0;
+    this->cellSize = 1;
+    this->columns = 0;
+    this->rows = 0;
+    this->cells.clear();
+}
+
+int TargetSet::Add(double _x, double _y, double _radius)
+{
+    if(this->m_count == this->maxTargets)
+        return -1;
+    int i = this->m_count++;
+    this->x[i] = (float)_x;
+    this->y[i] = (float)_y;
+    this->radius2[i] = (float)(_radius * _radius);
+    this->m_radius[i] = _radius;
+    return i;
+}
+
+//Each cell keeps the targets whose bounding square overlaps it
+void TargetSet::Build(double _cellSize)
+{
+    this->cells.clear();
+    this->columns = 0;
+    this->rows = 0;
+    if(this->m_count == 0)
+        return;
+
+    double minX = this->x[0] - this->m_radius[0];
+    double maxX = this->x[0] + this->m_radius[0];
+    double minY = this->y[0] - this->m_radius[0];
+    double maxY = this->y[0] + this->m_radius[0];
+    double largest = 0;
+    for(int i=0; i<this->m_count; i++)
+    {
+        minX = qMin(minX, this->x[i] - this->m_radius[i]);
+        maxX = qMax(maxX, this->x[i] + this->m_radius[i]);
+        minY = qMin(minY, this->y[i] - this->m_radius[i]);
+        maxY = qMax(maxY, this->y[i] + this->m_radius[i]);
+        largest = qMax(largest, this->m_radius[i]);
+    }
+    if(_cellSize <= 0)
+        _cellSize = 2 * largest;
+    if(_cellSize < 1)
+        _cellSize = 1;
+
+    this->gridX = minX;
+    this->gridY = minY;
+    this->cellSize = _cellSize;
+    this->columns = (int)((maxX - minX) / _cellSize) + 1;
+    this->rows = (int)((maxY - minY) / _cellSize) + 1;
+    this->cells.fill(0, this->columns * this->rows);
+    for(int i=0; i<this->m_count; i++)
+    {
+        int c0 = (int)((this->x[i] - this->m_radius[i] - minX) / _cellSize);
+        int c1 = (int)((this->x[i] + this->m_radius[i] - minX) / _cellSize);
+        int r0 = (int)((this->y[i] - this->m_radius[i] - minY) / _cellSize);
+        int r1 = (int)((this->y[i] + this->m_radius[i] - minY) / _cellSize);
+        for(int r=r0; r<=r1 && r<this->rows; r++)
+            for(int c=c0; c<=c1 && c<this->columns; c++)
+                this->cells[r*this->columns + c] |= 1ULL << i;
+    }
+}
+
+quint64 TargetSet::Hits(double _x, double _y, quint64 _mask) const
+{
+    if(this->columns == 0 || _x < this->gridX || _y < this->gridY)
+        return 0;
+    int c = (int)((_x - this->gridX) / this->cellSize);
+    int r = (int)((_y - this->gridY) / this->cellSize);
+    if(c >= this->columns || r >= this->rows)
+        return 0;
+    quint64 candidates = this->cells.at(r*this->columns + c) & _mask;
+    if(candidates == 0)
+        return 0;
+    return this->TestTargets((float)_x, (float)_y, candidates);
+}
+
+int TargetSet::FirstHit(double _x, double _y, quint64 _mask) const
+{
+    quint64 hits = this->Hits(_x, _y, _mask);
+    if(hits == 0)
+        return -1;
+    int i = 0;
+    while(!(hits & 1))
+    {
+        hits >>= 1;
+        i++;
+    }
+    return i;
+}
+
+//Squared distance to each target compared with its squared radius, four
+//targets at a time; groups without candidates are skipped
+quint64 TargetSet::TestTargets(float _x, float _y, quint64 _candidates) const
+{
+    quint64 hits = 0;
+#ifdef TARGETSET_SSE2
+    __m128 px = _mm_set1_ps(_x);
+    __m128 py = _mm_set1_ps(_y);
+    for(int i=0; i<this->m_count; i+=4)
+    {
+        if(((_candidates >> i) & 0xF) == 0)
+            continue;
+        __m128 dx = _mm_sub_ps(_mm_load_ps(this->x + i), px);
+        __m128 dy = _mm_sub_ps(_mm_load_ps(this->y + i), py);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        int inside = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_load_ps(this->radius2 + i)));
+        hits |= (quint64)inside << i;
+    }
+#else
+    for(int i=0; i<this->m_count; i++)
+    {
+        float dx = this->x[i] - _x;
+        float dy = this->y[i] - _y;
+        if(dx*dx + dy*dy <= this->radius2[i])
+            hits |= 1ULL << i;
+    }
+#endif
+    return hits & _candidates;
+}
+
+void TargetSet::SquaredDistances(double _x, double _y, float *_distances) const
+{
+    float px = (float)_x;
+    float py = (float)_y;
+    for(int i=0; i<this->m_count; i++)
+    {
+        float dx = this->x[i] - px;
+        float dy = this->y[i] - py;
+        _distances[i] = dx*dx + dy*dy;
+    }
+}
+
+//Angles go counterclockwise on the screen (Y grows downwards)
+void TargetSet::CreateCircle(double _centerX, double _centerY, double _distance, int _count, double _radius)
+{
+    this->Clear();
+    if(_count > this->maxTargets)
+        _count = this->maxTargets;
+    for(int i=0; i<_count; i++)
+    {
+        double angle = M_PI/2 + 2*M_PI*i/_count;
+        this->Add(qRound(_centerX + _distance*qCos(angle)),
+                  qRound(_centerY - _distance*qSin(angle)), _radius);
+    }
+    this->Build();
+}
+
+//Random order: Fisher-Yates shuffle of each cycle with a small linear
+//congruential generator, so the sequence is the same on every platform
+int TargetSet::TargetForTrial(Paradigm _paradigm, int _trialIndex, quint32 _seed) const
+{
+    if(this->m_count == 0)
+        return -1;
+    int position = _trialIndex % this->m_count;
+    if(_paradigm == SingleTarget)
+        return 0;
+    if(_paradigm == CenterOut)
+        return position;
+
+    int order[maxTargets];
+    for(int i=0; i<this->m_count; i++)
+        order[i] = i;
+    quint32 state = _seed * 2654435761U + (quint32)(_trialIndex / this->m_count) * 40503U + 1;
+    for(int i=this->m_count-1; i>0; i--)
+    {
+        state = state * 1664525U + 1013904223U;
+        int j = (int)((state >> 8) % (quint32)(i+1));
+        int aux = order[i];
+        order[i] = order[j];
+        order[j] = aux;
+    }
+    return order[position];
+}
@@ -0,0 +1,111 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Targets of the task (up to 64) and the test of the cursor
+ * against them. Each target is a circle (center and hit radius). A point is
+ * tested against every target at once: the squared distances to the
+ * centers are compared with the squared radii, four targets per SSE2
+ * instruction (plain loop on other processors), and the result is a mask
+ * with one bit per target. A uniform grid over the screen keeps, for each
+ * cell, the mask of the targets that reach it, so a point far from every
+ * target is rejected with one lookup.
+ * The set is built once (Add(), then Build()) and is only read afterwards,
+ * so it can be used by the GUI and the acquisition threads at the same time.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef TARGETSET_H
+#define TARGETSET_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QPointF>
+
+class TargetSet
+{
+public:
+    //How the target of each trial is chosen
+    enum Paradigm
+    {
+        SingleTarget = 0, //One target, opposite to the origin
+        CenterOut = 1, //Targets around the origin, visited in order
+        RandomTarget = 2 //Targets around the origin, shuffled: every target
+                         //once in each cycle of numberTargets trials
+    };
+
+    //Maximum number of targets (one bit of the mask each)
+    static const int maxTargets = 64;
+
+    //Constructor
+    TargetSet();
+
+    //Methods
+    //Removes every target
+    void Clear();
+    //Adds a target and returns its index (-1 if the set is full)
+    int Add(double _x, double _y, double _radius);
+    //Builds the grid. Must be called after the last Add()
+    //_cellSize: side of the cells (pixels), 0: twice the largest radius
+    void Build(double _cellSize = 0);
+    //Mask of the targets, among those in _mask, that contain the point
+    quint64 Hits(double _x, double _y, quint64 _mask = ~0ULL) const;
+    //First target, among those in _mask, that contains the point (-1: none)
+    int FirstHit(double _x, double _y, quint64 _mask = ~0ULL) const;
+    //Squared distances from the point to the center of every target
+    //_distances must have room for count() values
+    void SquaredDistances(double _x, double _y, float *_distances) const;
+
+    //Targets of a paradigm: _count targets on a circle of _distance pixels
+    //around (_centerX, _centerY), the first one straight up
+    void CreateCircle(double _centerX, double _centerY, double _distance, int _count, double _radius);
+    //Target of the trial with the given index (0: first trial of the
+    //experiment). The order only depends on the paradigm and on _seed,
+    //so an experiment that is resumed continues the same sequence
+    int TargetForTrial(Paradigm _paradigm, int _trialIndex, quint32 _seed) const;
+
+    //Getters
+    int count() const
+    {
+        return m_count;
+    }
+    QPointF center(int _target) const
+    {
+        return QPointF(x[_target], y[_target]);
+    }
+    double radius(int _target) const
+    {
+        return m_radius[_target];
+    }
+    //Mask with the bit of every target
+    quint64 allTargets() const
+    {
+        return m_count == maxTargets ? ~0ULL : ((1ULL << m_count) - 1);
+    }
+
+private:
+    //Fields
+    //Structure of arrays, padded to a multiple of 4 with targets that
+    //never match (radius -1)
+    alignas(16) float x[maxTargets];
+    alignas(16) float y[maxTargets];
+    alignas(16) float radius2[maxTargets];
+    double m_radius[maxTargets];
+    int m_count;
+    //Grid: mask of the targets that reach each cell
+    double gridX;
+    double gridY;
+    double cellSize;
+    int columns;
+    int rows;
+    QVector<quint64> cells;
+
+    //Methods
+    quint64 TestTargets(float _x, float _y, quint64 _candidates) const;
+};
+
+#endif // TARGETSET_H
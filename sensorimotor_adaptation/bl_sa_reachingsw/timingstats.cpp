@@ -0,0 +1,198 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "timingstats.h"
+
+#include <math.h>
+#include <string.h>
+
+//Default constructor
+TimingStats::TimingStats(qint64 _period)
+{
+    this->m_period = _period;
+    this->Reset();
+}
+
+//Clears every counter
+void TimingStats::Reset()
+{
+    this->m_ticks = 0;
+    this->m_missed = 0;
+    this->firstWakeup = 0;
+    this->lastWakeup = 0;
+    this->m_maxLatency = 0;
+    this->minInterval = 0;
+    this->maxInterval = 0;
+    this->sumInterval = 0;
+    this->sumInterval2 = 0;
+    this->sumLatency = 0;
+    memset(this->latencyHistogram, 0, sizeof(this->latencyHistogram));
+    memset(this->jitterHistogram, 0, sizeof(this->jitterHistogram));
+    this->m_lateTicks = 0;
+}
+
+//Adds a tick
+void TimingStats::AddTick(qint64 _deadline, qint64 _wakeup)
+{
+    //Latency: how late the thread woke up
+    qint64 latency = _wakeup - _deadline;
+    if(latency < 0)
+        latency = 0;
+    if(latency > this->m_maxLatency)
+        this->m_maxLatency = latency;
+    this->sumLatency += latency;
+    int bin = (int)(latency / this->binWidth);
+    if(bin >= this->latencyBins)
+        bin = this->latencyBins - 1;
+    this->latencyHistogram[bin]++;
+
+    //Jitter: deviation of the interval from the nominal period
+    if(this->m_ticks > 0)
+    {
+        qint64 interval = _wakeup - this->lastWakeup;
+        if(this->m_ticks == 1 || interval < this->minInterval)
+            this->minInterval = interval;
+        if(this->m_ticks == 1 || interval > this->maxInterval)
+            this->maxInterval = interval;
+        this->sumInterval += interval;
+        this->sumInterval2 += (double)interval * (double)interval;
+        qint64 jitter = interval - this->m_period;
+        bin = (int)floor((double)jitter / this->binWidth) + this->jitterBins/2;
+        if(bin < 0)
+            bin = 0;
+        else if(bin >= this->jitterBins)
+            bin = this->jitterBins - 1;
+        this->jitterHistogram[bin]++;
+    }
+    else
+        this->firstWakeup = _wakeup;
+
+    //Late tick: the time is kept while there is room, then only counted
+    if(latency > this->m_period/2)
+    {
+        if(this->m_lateTicks < this->maxLateTicks)
+        {
+            this->lateTime[this->m_lateTicks] = _wakeup - this->firstWakeup;
+            this->lateLatency[this->m_lateTicks] = latency;
+        }
+        this->m_lateTicks++;
+    }
+
+    this->lastWakeup = _wakeup;
+    this->m_ticks++;
+}
+
+//Adds skipped deadlines
+void TimingStats::AddMissed(int _count)
+{
+    this->m_missed += _count;
+}
+
+//Mean interval between ticks
+double TimingStats::meanInterval() const
+{
+    if(this->m_ticks < 2)
+        return 0;
+    return this->sumInterval / (this->m_ticks - 1);
+}
+
+//Standard deviation of the interval between ticks
+double TimingStats::stdInterval() const
+{
+    if(this->m_ticks < 3)
+        return 0;
+    int n = this->m_ticks - 1;
+    double mean = this->sumInterval / n;
+    double var = (this->sumInterval2 - n*mean*mean) / (n - 1);
+    return var > 0 ? sqrt(var) : 0;
+}
+
+//Frequency that was actually achieved
+double TimingStats::achievedFrequency() const
+{
+    double mean = this->meanInterval();
+    return mean > 0 ? 1e9 / mean : 0;
+}
+
+//Finds the percentile from the latency histogram
+//Resolution is one bin (10 us), the upper edge of the bin is returned
+qint64 TimingStats::LatencyPercentile(double _fraction) const
+{
+    if(this->m_ticks == 0)
+        return 0;
+    quint64 target = (quint64)ceil(_fraction * this->m_ticks);
+    quint64 count = 0;
+    for(int i=0; i<this->latencyBins; i++)
+    {
+        count += this->latencyHistogram[i];
+        if(count >= target)
+            return (qint64)(i+1) * this->binWidth;
+    }
+    return this->m_maxLatency;
+}
+
+//A trial is flagged if any deadline was missed or if a tick
+//woke up more than half a period late
+bool TimingStats::IsFlagged() const
+{
+    return this->m_missed > 0 || this->m_maxLatency > this->m_period/2;
+}
+
+//One-line summary (times in us)
+QString TimingStats::Summary() const
+{
+    QString s;
+    s += "ticks " + QString::number(this->m_ticks);
+    s += "; achieved frequency (Hz) " + QString::number(this->achievedFrequency(),'f',2);
+    s += "; mean period (us) " + QString::number(this->meanInterval()/1000.0,'f',1);
+    s += "; period sd (us) " + QString::number(this->stdInterval()/1000.0,'f',1);
+    s += "; latency p50/p99/max (us) " + QString::number(this->LatencyPercentile(0.5)/1000) +
+            "/" + QString::number(this->LatencyPercentile(0.99)/1000) +
+            "/" + QString::number(this->m_maxLatency/1000);
+    s += "; missed deadlines " + QString::number(this->m_missed);
+    if(this->IsFlagged())
+        s += "; FLAGGED";
+    return s;
+}
+
+//Full report written next to the data of each trial
+QString TimingStats::Report() const
+{
+    QString r;
+    r += "Acquisition timing\n";
+    r += "-------------------------------------\n";
+    r += "Nominal period (us): " + QString::number(this->m_period/1000.0,'f',1) + "\n";
+    r += "Ticks: " + QString::number(this->m_ticks) + "\n";
+    r += "Achieved frequency (Hz): " + QString::number(this->achievedFrequency(),'f',3) + "\n";
+    r += "Mean period (us): " + QString::number(this->meanInterval()/1000.0,'f',2) + "\n";
+    r += "Period sd (us): " + QString::number(this->stdInterval()/1000.0,'f',2) + "\n";
+    r += "Min/max period (us): " + QString::number(this->minInterval/1000.0,'f',1) + "/" +
+            QString::number(this->maxInterval/1000.0,'f',1) + "\n";
+    r += "Mean latency (us): " + QString::number(this->m_ticks > 0 ? this->sumLatency/this->m_ticks/1000.0 : 0.0,'f',1) + "\n";
+    r += "Latency p50/p99/max (us): " + QString::number(this->LatencyPercentile(0.5)/1000) + "/" +
+            QString::number(this->LatencyPercentile(0.99)/1000) + "/" +
+            QString::number(this->m_maxLatency/1000) + "\n";
+    r += "Missed deadlines: " + QString::number(this->m_missed) + "\n";
+    r += QString("Flagged: ") + (this->IsFlagged() ? "True" : "False") + "\n";
+    r += "-------------------------------------\n";
+    r += "Latency histogram (bin start in us, count)\n";
+    for(int i=0; i<this->latencyBins; i++)
+        if(this->latencyHistogram[i] > 0)
+            r += QString::number(i*this->binWidth/1000) + "\t" + QString::number(this->latencyHistogram[i]) + "\n";
+    r += "-------------------------------------\n";
+    r += "Jitter histogram (bin start in us, count)\n";
+    for(int i=0; i<this->jitterBins; i++)
+        if(this->jitterHistogram[i] > 0)
+            r += QString::number((i - this->jitterBins/2)*this->binWidth/1000) + "\t" +
+                    QString::number(this->jitterHistogram[i]) + "\n";
+    r += "-------------------------------------\n";
+    r += "Late ticks: " + QString::number(this->m_lateTicks) + "\n";
+    r += "Late ticks (ns since the first tick, latency in ns)\n";
+    for(int i=0; i<qMin(this->m_lateTicks, (int)this->maxLateTicks); i++)
+        r += QString::number(this->lateTime[i]) + "\t" + QString::number(this->lateLatency[i]) + "\n";
+    return r;
+}
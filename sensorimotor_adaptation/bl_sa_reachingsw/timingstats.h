@@ -0,0 +1,110 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Timing quality of the acquisition. Keeps histograms of the
+ * wake-up latency (wake-up - deadline) and of the jitter (interval - nominal
+ * period), the number of missed deadlines and the time of the ticks that
+ * woke up late, so each trial can be accepted or flagged after it is
+ * recorded. Every counter has a fixed size, so AddTick() never allocates on
+ * the acquisition thread, however long the trial is.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef TIMINGSTATS_H
+#define TIMINGSTATS_H
+
+#include <QString>
+
+class TimingStats
+{
+public:
+    //Constructor
+    //_period: nominal sampling period (ns)
+    TimingStats(qint64 _period = 10000000);
+
+    //Methods
+    //Clears every counter (start of a trial)
+    void Reset();
+    //Adds a tick that was due at _deadline and woke up at _wakeup
+    void AddTick(qint64 _deadline, qint64 _wakeup);
+    //Adds deadlines that were skipped because a tick was too late
+    void AddMissed(int _count);
+    //Latency (ns) below which the given fraction (0-1) of the ticks woke up
+    qint64 LatencyPercentile(double _fraction) const;
+    //Whether the trial should be flagged: a deadline was missed or a tick
+    //woke up more than half a period late
+    bool IsFlagged() const;
+    //One-line summary
+    QString Summary() const;
+    //Summary, histograms and the ticks that woke up late
+    QString Report() const;
+
+    //Getters and setters
+    void setPeriod(qint64 period)
+    {
+        m_period = period;
+    }
+    qint64 period() const
+    {
+        return m_period;
+    }
+    int ticks() const
+    {
+        return m_ticks;
+    }
+    quint64 missed() const
+    {
+        return m_missed;
+    }
+    qint64 maxLatency() const
+    {
+        return m_maxLatency;
+    }
+    //Mean and standard deviation of the interval between ticks (ns)
+    double meanInterval() const;
+    double stdInterval() const;
+    //Frequency that was actually achieved (Hz)
+    double achievedFrequency() const;
+    //Ticks that woke up more than half a period late (also those beyond
+    //maxLateTicks, which are only counted)
+    int lateTicks() const
+    {
+        return m_lateTicks;
+    }
+
+    //Histograms: bins of 10 us
+    //Latency: 0 to 2 ms, jitter: -1 ms to 1 ms. The last bin counts the
+    //values beyond the range (latency) or both tails are clamped (jitter)
+    static const int binWidth = 10000;
+    static const int latencyBins = 200;
+    static const int jitterBins = 200;
+    //Late ticks whose time and latency are kept
+    static const int maxLateTicks = 64;
+
+private:
+    //Fields
+    qint64 m_period;
+    int m_ticks;
+    quint64 m_missed;
+    qint64 firstWakeup;
+    qint64 lastWakeup;
+    qint64 m_maxLatency;
+    qint64 minInterval;
+    qint64 maxInterval;
+    double sumInterval;
+    double sumInterval2;
+    double sumLatency;
+    quint32 latencyHistogram[latencyBins];
+    quint32 jitterHistogram[jitterBins];
+    //Time since the first tick and latency of the first late ticks (ns)
+    qint64 lateTime[maxLateTicks];
+    qint64 lateLatency[maxLateTicks];
+    int m_lateTicks;
+};
+
+#endif // TIMINGSTATS_H
@@ -0,0 +1,327 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "trajectorycodec.h"
+
+#include <QtEndian>
+#include <string.h>
+#include <stddef.h>
+
+//Zero bytes at the end of every block, so the bit-packed values can
+//always be read with 64-bit loads
+static const int tailBytes = 8;
+
+//Zig-zag: small negative and positive numbers become small unsigned numbers
+static inline quint32 ZigZag32(qint32 _v)
+{
+    return ((quint32)_v << 1) ^ (quint32)(_v >> 31);
+}
+
+static inline qint32 UnZigZag32(quint32 _v)
+{
+    return (qint32)((_v >> 1) ^ (0u - (_v & 1)));
+}
+
+static inline quint64 ZigZag64(qint64 _v)
+{
+    return ((quint64)_v << 1) ^ (quint64)(_v >> 63);
+}
+
+static inline qint64 UnZigZag64(quint64 _v)
+{
+    return (qint64)((_v >> 1) ^ (0ull - (_v & 1)));
+}
+
+//Varint: 7 bits per byte, the high bit marks that more bytes follow
+static inline int PutVarint(uchar *_out, quint64 _v)
+{
+    int n = 0;
+    while(_v >= 0x80)
+    {
+        _out[n++] = (uchar)(_v | 0x80);
+        _v >>= 7;
+    }
+    _out[n++] = (uchar)_v;
+    return n;
+}
+
+//Returns false if the varint does not end before _end
+static inline bool GetVarint(const uchar *&_p, const uchar *_end, quint64 &_v)
+{
+    _v = 0;
+    for(int shift=0; shift<64 && _p<_end; shift+=7)
+    {
+        uchar b = *_p++;
+        _v |= (quint64)(b & 0x7F) << shift;
+        if(!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+//Little-endian 64-bit load from any address
+static inline quint64 Load64(const uchar *_p)
+{
+    quint64 v;
+    memcpy(&v, _p, sizeof(v));
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    v = qbswap(v);
+#endif
+    return v;
+}
+
+static inline void Store64(uchar *_p, quint64 _v)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    _v = qbswap(_v);
+#endif
+    memcpy(_p, &_v, sizeof(_v));
+}
+
+//Number of bits needed to store _v
+static inline int BitWidth(quint32 _v)
+{
+    int width = 0;
+    while(_v != 0)
+    {
+        width++;
+        _v >>= 1;
+    }
+    return width;
+}
+
+//Bytes used by _count values of _width bits
+static inline int PackedBytes(int _count, int _width)
+{
+    return (int)(((qint64)_count * _width + 7) / 8);
+}
+
+//Default constructor
+TrajectoryCodec::TrajectoryCodec(bool _timestampDelta)
+{
+    this->m_timestampDelta = _timestampDelta;
+}
+
+//Count, flags and first sample: 5 + 1 + 4x5 bytes
+//Channels: 4 x (1 + 4 bytes per sample)
+//Timestamps: at most 10 bytes per sample
+int TrajectoryCodec::MaxEncodedSize(int _count)
+{
+    return 26 + 4 + 16*_count + 10*(_count+1) + tailBytes;
+}
+
+//Encodes a block of samples
+int TrajectoryCodec::Encode(const CursorSample *_samples, int _count, uchar *_out) const
+{
+    uchar *p = _out;
+    p += PutVarint(p, _count);
+    *p++ = this->m_timestampDelta ? TimestampDelta : 0;
+
+    if(_count > 0)
+    {
+        const CursorSample &first = _samples[0];
+        p += PutVarint(p, ZigZag32(first.rawX));
+        p += PutVarint(p, ZigZag32(first.rawY));
+        p += PutVarint(p, ZigZag32(first.x));
+        p += PutVarint(p, ZigZag32(first.y));
+
+        //Coordinates: the width is chosen from the largest delta of the block
+        static const size_t offsets[4] = {offsetof(CursorSample, rawX), offsetof(CursorSample, rawY),
+                                          offsetof(CursorSample, x), offsetof(CursorSample, y)};
+        for(int c=0; c<4; c++)
+        {
+            const char *base = (const char*)_samples + offsets[c];
+            quint32 all = 0;
+            for(int i=1; i<_count; i++)
+            {
+                qint32 v0, v1;
+                memcpy(&v0, base + (i-1)*sizeof(CursorSample), sizeof(v0));
+                memcpy(&v1, base + i*sizeof(CursorSample), sizeof(v1));
+                all |= ZigZag32((qint32)((quint32)v1 - (quint32)v0));
+            }
+            int width = BitWidth(all);
+            *p++ = (uchar)width;
+
+            int bytes = PackedBytes(_count-1, width);
+            memset(p, 0, bytes + tailBytes);
+            if(width > 0)
+            {
+                qint64 bit = 0;
+                for(int i=1; i<_count; i++, bit+=width)
+                {
+                    qint32 v0, v1;
+                    memcpy(&v0, base + (i-1)*sizeof(CursorSample), sizeof(v0));
+                    memcpy(&v1, base + i*sizeof(CursorSample), sizeof(v1));
+                    quint64 z = ZigZag32((qint32)((quint32)v1 - (quint32)v0));
+                    uchar *word = p + (bit >> 3);
+                    Store64(word, Load64(word) | (z << (bit & 7)));
+                }
+            }
+            p += bytes;
+        }
+
+        //Timestamps
+        if(this->m_timestampDelta)
+        {
+            p += PutVarint(p, ZigZag64(first.timestamp));
+            quint64 previous = 0;
+            for(int i=1; i<_count; i++)
+            {
+                quint64 interval = (quint64)_samples[i].timestamp - (quint64)_samples[i-1].timestamp;
+                p += PutVarint(p, ZigZag64((qint64)(interval - previous)));
+                previous = interval;
+            }
+        }
+        else
+        {
+            for(int i=0; i<_count; i++, p+=8)
+                Store64(p, (quint64)_samples[i].timestamp);
+        }
+    }
+
+    memset(p, 0, tailBytes);
+    p += tailBytes;
+    return (int)(p - _out);
+}
+
+//Encodes into a byte array
+void TrajectoryCodec::Encode(const CursorSample *_samples, int _count, QByteArray &_out) const
+{
+    _out.resize(MaxEncodedSize(_count));
+    int bytes = this->Encode(_samples, _count, (uchar*)_out.data());
+    _out.resize(bytes);
+}
+
+//Number of samples of a block
+int TrajectoryCodec::Count(const uchar *_data, int _bytes)
+{
+    const uchar *p = _data;
+    quint64 count;
+    //Every sample takes at least one byte of the block
+    if(!GetVarint(p, _data + _bytes, count) || count > (quint64)_bytes)
+        return -1;
+    return (int)count;
+}
+
+//Decodes into an array of samples
+int TrajectoryCodec::Decode(const uchar *_data, int _bytes, CursorSample *_out)
+{
+    Destination dst;
+    dst.timestamp.data = (char*)&_out->timestamp;
+    dst.timestamp.stride = sizeof(CursorSample);
+    dst.channels[0].data = (char*)&_out->rawX;
+    dst.channels[1].data = (char*)&_out->rawY;
+    dst.channels[2].data = (char*)&_out->x;
+    dst.channels[3].data = (char*)&_out->y;
+    for(int c=0; c<4; c++)
+        dst.channels[c].stride = sizeof(CursorSample);
+    return DecodeTo(_data, _bytes, dst);
+}
+
+//Decodes into one array per channel
+//The arrays only grow, so decoding blocks of the same size does not allocate
+int TrajectoryCodec::Decode(const uchar *_data, int _bytes, TrajectoryBlock &_block)
+{
+    int count = Count(_data, _bytes);
+    if(count < 0)
+        return -1;
+    if(_block.timestamp.size() < count)
+    {
+        _block.timestamp.resize(count);
+        _block.rawX.resize(count);
+        _block.rawY.resize(count);
+        _block.x.resize(count);
+        _block.y.resize(count);
+    }
+    Destination dst;
+    dst.timestamp.data = (char*)_block.timestamp.data();
+    dst.timestamp.stride = sizeof(qint64);
+    dst.channels[0].data = (char*)_block.rawX.data();
+    dst.channels[1].data = (char*)_block.rawY.data();
+    dst.channels[2].data = (char*)_block.x.data();
+    dst.channels[3].data = (char*)_block.y.data();
+    for(int c=0; c<4; c++)
+        dst.channels[c].stride = sizeof(qint32);
+    _block.count = DecodeTo(_data, _bytes, dst);
+    return _block.count;
+}
+
+//Decodes a block
+//Every size is checked against _bytes before it is read
+int TrajectoryCodec::DecodeTo(const uchar *_data, int _bytes, const Destination &_dst)
+{
+    const uchar *p = _data;
+    const uchar *end = _data + _bytes;
+    quint64 count, flags, first[4];
+    if(!GetVarint(p, end, count) || count > (quint64)_bytes || p >= end)
+        return -1;
+    flags = *p++;
+    int n = (int)count;
+    if(n == 0)
+        return 0;
+
+    for(int c=0; c<4; c++)
+        if(!GetVarint(p, end, first[c]))
+            return -1;
+
+    //Coordinates: unpacks the deltas with a fixed width and adds them up
+    for(int c=0; c<4; c++)
+    {
+        if(p >= end)
+            return -1;
+        int width = *p++;
+        int bytes = PackedBytes(n-1, width);
+        if(width > 32 || end - p < bytes + tailBytes)
+            return -1;
+
+        char *dst = _dst.channels[c].data;
+        int stride = _dst.channels[c].stride;
+        quint32 value = (quint32)UnZigZag32((quint32)first[c]);
+        memcpy(dst, &value, sizeof(value));
+        quint64 mask = width == 0 ? 0 : (~0ull >> (64 - width));
+        qint64 bit = 0;
+        for(int i=1; i<n; i++, bit+=width)
+        {
+            quint32 z = (quint32)((Load64(p + (bit >> 3)) >> (bit & 7)) & mask);
+            value += (quint32)UnZigZag32(z);
+            memcpy(dst + (qint64)i*stride, &value, sizeof(value));
+        }
+        p += bytes;
+    }
+
+    //Timestamps
+    char *ts = _dst.timestamp.data;
+    int tstride = _dst.timestamp.stride;
+    if(flags & TimestampDelta)
+    {
+        quint64 z;
+        if(!GetVarint(p, end, z))
+            return -1;
+        quint64 t = (quint64)UnZigZag64(z);
+        quint64 interval = 0;
+        memcpy(ts, &t, sizeof(t));
+        for(int i=1; i<n; i++)
+        {
+            if(!GetVarint(p, end, z))
+                return -1;
+            interval += (quint64)UnZigZag64(z);
+            t += interval;
+            memcpy(ts + (qint64)i*tstride, &t, sizeof(t));
+        }
+    }
+    else
+    {
+        if(end - p < (qint64)n*8)
+            return -1;
+        for(int i=0; i<n; i++, p+=8)
+        {
+            quint64 t = Load64(p);
+            memcpy(ts + (qint64)i*tstride, &t, sizeof(t));
+        }
+    }
+    return n;
+}
@@ -0,0 +1,105 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Compression of cursor trajectories. The positions change by a
+ * few pixels per sample, so each coordinate is stored as the difference to
+ * the previous sample (delta), mapped to an unsigned number (zig-zag) and
+ * bit-packed with the smallest width that fits the block. Timestamps are
+ * either stored as they are or as the change of the interval between
+ * samples (zig-zag varint), which is zero for the uniform sampling grid.
+ *
+ * Layout of an encoded block (little endian):
+ *   varint count | flags | zig-zag varint rawX, rawY, x, y of the first sample
+ *   4 x (width | bit-packed deltas of rawX, rawY, x, y)
+ *   timestamps: TimestampDelta: zig-zag varint first time, first interval and
+ *               the change of every following interval
+ *               otherwise: count x qint64
+ *   8 zero bytes
+ * Every delta of a channel has the same width, so the block is decoded by
+ * fixed-width loops without branches (see TrajectoryBlock).
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef TRAJECTORYCODEC_H
+#define TRAJECTORYCODEC_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVector>
+#include "samplebuffer.h" //CursorSample
+
+//Decoded block stored as one array per channel
+struct TrajectoryBlock
+{
+    int count;
+    QVector<qint64> timestamp;
+    QVector<qint32> rawX;
+    QVector<qint32> rawY;
+    QVector<qint32> x;
+    QVector<qint32> y;
+};
+
+class TrajectoryCodec
+{
+public:
+    //Flags of an encoded block
+    enum Flags{
+        TimestampDelta = 1 //Timestamps stored as changes of the interval
+    };
+
+    //Constructor
+    TrajectoryCodec(bool _timestampDelta = true);
+
+    //Methods
+    //Largest size of a block of _count samples (bytes)
+    static int MaxEncodedSize(int _count);
+    //Encodes _count samples into _out, which must hold MaxEncodedSize bytes
+    //Returns the size of the block (bytes)
+    int Encode(const CursorSample *_samples, int _count, uchar *_out) const;
+    //Encodes _count samples, replacing the contents of _out
+    void Encode(const CursorSample *_samples, int _count, QByteArray &_out) const;
+    //Number of samples of an encoded block, -1 if it is not valid
+    static int Count(const uchar *_data, int _bytes);
+    //Decodes a block into _out, which must hold Count() samples
+    //Returns the number of samples, -1 if the block is not valid
+    static int Decode(const uchar *_data, int _bytes, CursorSample *_out);
+    //Decodes a block into one array per channel
+    static int Decode(const uchar *_data, int _bytes, TrajectoryBlock &_block);
+
+    //Getters and setters
+    void setTimestampDelta(bool enabled)
+    {
+        m_timestampDelta = enabled;
+    }
+    bool timestampDelta() const
+    {
+        return m_timestampDelta;
+    }
+
+private:
+    //Fields
+    bool m_timestampDelta;
+
+    //Channel decoded into memory: _stride bytes between values
+    struct Channel
+    {
+        char *data;
+        int stride;
+    };
+    //Destination of every channel
+    struct Destination
+    {
+        Channel timestamp;
+        Channel channels[4]; //rawX, rawY, x, y
+    };
+
+    //Methods
+    static int DecodeTo(const uchar *_data, int _bytes, const Destination &_dst);
+};
+
+#endif // TRAJECTORYCODEC_H
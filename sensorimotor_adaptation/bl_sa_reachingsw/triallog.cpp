@@ -0,0 +1,253 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "triallog.h"
+
+#include <string.h>
+
+//Default constructor
+//The blocks and the ring are allocated once, so recording a trial does not
+//allocate
+TrialLog::TrialLog(SessionFileWriter *_sessionFile, int _blockSamples, int _capacity)
+{
+    this->sessionFile = _sessionFile;
+    this->m_blockSamples = qMax(1, _blockSamples);
+    this->gridBlock.reserve(this->m_blockSamples);
+    this->eventBlock.reserve(this->m_blockSamples);
+    //Power of two, so the indexes can be wrapped with a mask (at least the
+    //entries kept for the end of a trial and one block)
+    quint32 cap = 4;
+    while((int)cap < _capacity)
+        cap <<= 1;
+    this->m_capacity = (int)cap;
+    this->mask = cap - 1;
+    this->entries = new Entry[cap];
+    this->blockStorage = new CursorSample[(size_t)cap * this->m_blockSamples];
+    this->head.store(0);
+    this->tail.store(0);
+    this->gridText = new DataFileController("");
+    this->eventText = new DataFileController("");
+    this->gridSequence = 0;
+    this->eventSequence = 0;
+    this->session = 0;
+    this->trial = 0;
+    this->startTime = 0;
+    this->opened = false;
+    this->m_samples = 0;
+    this->m_events = 0;
+    this->lost = 0;
+    this->m_lostBlocks = 0;
+}
+
+//Destructor
+//The owner writes the pending entries first (WritePending)
+TrialLog::~TrialLog()
+{
+    delete this->gridText;
+    delete this->eventText;
+    delete[] this->entries;
+    delete[] this->blockStorage;
+}
+
+//Starts a trial
+void TrialLog::Begin(int _session, int _trial, qint64 _startTime)
+{
+    this->session = _session;
+    this->trial = _trial;
+    this->startTime = _startTime;
+    this->gridBlock.resize(0);
+    this->eventBlock.resize(0);
+    this->gridSequence = 0;
+    this->eventSequence = 0;
+    this->m_samples = 0;
+    this->m_events = 0;
+    this->lost = 0;
+    this->opened = true;
+    //The GUI thread opens the text files of the trial
+    //If the ring is full, only the text files of the trial are not written
+    //(the blocks carry the trial to the session file)
+    this->Push(BeginEntry, StreamGrid, NULL, 0, false, NULL);
+}
+
+//Adds a sample of the uniform grid
+void TrialLog::AddSample(const CursorSample &_sample)
+{
+    if(!this->opened)
+        return;
+    this->gridBlock.push_back(_sample);
+    this->m_samples++;
+    if(this->gridBlock.size() >= this->m_blockSamples)
+        this->HandOver(StreamGrid, this->gridBlock, this->gridSequence, false);
+}
+
+//Adds an input event
+void TrialLog::AddEvent(const CursorSample &_sample)
+{
+    if(!this->opened)
+        return;
+    this->eventBlock.push_back(_sample);
+    this->m_events++;
+    if(this->eventBlock.size() >= this->m_blockSamples)
+        this->HandOver(StreamEvents, this->eventBlock, this->eventSequence, false);
+}
+
+//Hands over the remaining samples as the final blocks, then the timing of
+//the trial (a copy: the statistics have a fixed size)
+void TrialLog::End(const TimingStats &_timing)
+{
+    if(!this->opened)
+        return;
+    this->HandOver(StreamGrid, this->gridBlock, this->gridSequence, true);
+    this->HandOver(StreamEvents, this->eventBlock, this->eventSequence, true);
+    //Uses the entries kept for them, so they are never lost
+    this->Push(EndEntry, StreamTiming, NULL, 0, false, &_timing);
+    this->opened = false;
+}
+
+//Adds an entry to the ring
+//Must only be called from the acquisition thread
+//Returns false if the ring is full. The last three entries are kept for
+//the end of the trial (the final block of each stream and the end itself),
+//so a trial is always closed and complete in the file
+bool TrialLog::Push(EntryType _type, SessionStream _stream, QVector<CursorSample> *_block,
+                    int _sequence, bool _final, const TimingStats *_timing)
+{
+    quint32 h = this->head.load(std::memory_order_relaxed);
+    quint32 t = this->tail.load(std::memory_order_acquire);
+    int reserved = _type == EndEntry ? 0 : _final ? 1 : 3;
+    if(h - t >= (quint32)(this->m_capacity - reserved))
+        return false;
+
+    Entry &entry = this->entries[h & this->mask];
+    entry.type = _type;
+    entry.session = this->session;
+    entry.trial = this->trial;
+    entry.startTime = this->startTime;
+    entry.stream = _stream;
+    entry.sequence = _sequence;
+    entry.final = _final;
+    entry.count = _block != NULL ? _block->size() : 0;
+    entry.lost = this->lost;
+    if(_block != NULL)
+        memcpy(this->blockStorage + (size_t)(h & this->mask) * this->m_blockSamples,
+               _block->constData(), _block->size() * sizeof(CursorSample));
+    if(_timing != NULL)
+        entry.timing = *_timing;
+    //Publishes the entry to the GUI thread
+    this->head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+//Hands a block over to the GUI thread and starts the next one
+void TrialLog::HandOver(SessionStream _stream, QVector<CursorSample> &_block,
+                        int &_sequence, bool _final)
+{
+    if(!this->Push(BlockEntry, _stream, &_block, _sequence, _final, NULL))
+        this->lost++;
+    _sequence++;
+    //Keeps the capacity of the block
+    _block.resize(0);
+}
+
+//Writes every entry handed over so far
+//Must only be called from the GUI thread
+int TrialLog::WritePending()
+{
+    int written = 0;
+    while(true)
+    {
+        quint32 t = this->tail.load(std::memory_order_relaxed);
+        quint32 h = this->head.load(std::memory_order_acquire);
+        if(t == h)
+            break;
+        this->Write(this->entries[t & this->mask],
+                    this->blockStorage + (size_t)(t & this->mask) * this->m_blockSamples);
+        //Gives the entry back to the acquisition thread
+        this->tail.store(t + 1, std::memory_order_release);
+        written++;
+    }
+    return written;
+}
+
+//Writes one entry to the session file and to the text files
+void TrialLog::Write(const Entry &_entry, const CursorSample *_samples)
+{
+    bool text = !this->m_textPrefix.isEmpty();
+
+    switch(_entry.type)
+    {
+    case BeginEntry:
+        //Text files of the previous versions, one per trial and stream
+        if(text)
+        {
+            this->gridText->filename = this->TextFilename(_entry.session, _entry.trial, "data").toStdString();
+            this->gridText->Open();
+            this->eventText->filename = this->TextFilename(_entry.session, _entry.trial, "events").toStdString();
+            this->eventText->Open();
+        }
+        break;
+
+    case BlockEntry:
+        this->sessionFile->WriteSamples(_entry.session, _entry.trial, _entry.stream, _entry.startTime,
+                                        _samples, _entry.count, _entry.sequence, _entry.final);
+        if(text)
+        {
+            for(int i=0; i<_entry.count; i++)
+            {
+                const CursorSample &s = _samples[i];
+                //Visual feedback X and Y
+                if(_entry.stream == StreamGrid)
+                    this->gridText->WriteData(QString::number(s.x) + "\t" + QString::number(s.y));
+                //Time since the start of the trial (ns), raw X, raw Y,
+                //visual feedback X, visual feedback Y
+                else
+                    this->eventText->WriteData(QString::number(s.timestamp - _entry.startTime) + "\t" +
+                                               QString::number(s.rawX) + "\t" + QString::number(s.rawY) + "\t" +
+                                               QString::number(s.x) + "\t" + QString::number(s.y));
+            }
+        }
+        break;
+
+    case EndEntry:
+    {
+        //Timing report, then the trial is forced to the disk
+        QString report = _entry.timing.Report();
+        this->sessionFile->WriteText(_entry.session, _entry.trial, StreamTiming,
+                                     _entry.startTime, report);
+        this->sessionFile->Sync();
+        this->m_lostBlocks = _entry.lost;
+        if(text)
+        {
+            this->gridText->Close();
+            this->eventText->Close();
+            //Saves the timing quality of the acquisition during the trial
+            this->gridText->filename = this->TextFilename(_entry.session, _entry.trial, "timing").toStdString();
+            if(this->gridText->Open())
+            {
+                this->gridText->WriteData(report);
+                this->gridText->Close();
+            }
+            //Adds the summary to the header, so flagged trials are easy to find
+            this->gridText->filename = (this->m_textPrefix + "_header.txt").toStdString();
+            if(this->gridText->Open(true))
+            {
+                this->gridText->WriteData("Timing " + QString::number(_entry.session) + "_" +
+                                          QString::number(_entry.trial) + ": " + _entry.timing.Summary());
+                this->gridText->Close();
+            }
+        }
+        break;
+    }
+    }
+}
+
+//Example: for prefix "subject1", session 1, trial 1: subject1_data_1_1.txt
+QString TrialLog::TextFilename(int _session, int _trial, const QString &_kind) const
+{
+    return this->m_textPrefix + "_" + _kind + "_" + QString::number(_session) +
+            "_" + QString::number(_trial) + ".txt";
+}
@@ -0,0 +1,163 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Streams the trial being recorded to the session file. The
+ * samples are collected in fixed-size blocks, and every full block is
+ * appended to the file while the trial is still running, so the memory used
+ * does not depend on the length of the trial and a crash only loses the
+ * blocks that were not written yet.
+ * The log has two sides. The acquisition thread (Begin, AddSample,
+ * AddEvent, End) only copies the samples: completed blocks, the start and
+ * the end of each trial are handed over through a lock-free
+ * single-producer/single-consumer ring of preallocated entries, as the
+ * samples of SampleBuffer, so it never allocates, locks or waits for the
+ * disk. The GUI thread (WritePending) takes the entries from the ring and
+ * does everything else: encoding, the timing report, the session file and
+ * the text files of the previous versions. It is the only thread that uses
+ * the SessionFileWriter.
+ * If the ring is full, the block is lost and counted (lostBlocks); the last
+ * entries are kept for the final blocks and the end of the trial, so a
+ * trial is always closed.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef TRIALLOG_H
+#define TRIALLOG_H
+
+#include <atomic>
+#include <QString>
+#include <QVector>
+#include "samplebuffer.h"
+#include "sessionfilewriter.h"
+#include "datafilecontroller.h"
+#include "timingstats.h"
+
+class TrialLog
+{
+public:
+    //Constructor
+    //_blockSamples: samples in each block of the session file
+    //_capacity: entries of the ring between the two threads (rounded up to
+    //the next power of two)
+    TrialLog(SessionFileWriter *_sessionFile, int _blockSamples = 256, int _capacity = 64);
+    ~TrialLog();
+
+    //Methods
+    //Acquisition thread
+    //Starts a trial
+    void Begin(int _session, int _trial, qint64 _startTime);
+    //Adds a sample of the uniform grid
+    void AddSample(const CursorSample &_sample);
+    //Adds an input event
+    void AddEvent(const CursorSample &_sample);
+    //Hands over the last blocks and the timing of the trial
+    void End(const TimingStats &_timing);
+    //GUI thread
+    //Writes the entries handed over so far; returns the number of entries
+    int WritePending();
+
+    //Getters and setters
+    //Prefix of the text files of the previous versions (empty: not written)
+    //Set before the first trial
+    void setTextPrefix(QString prefix)
+    {
+        m_textPrefix = prefix;
+    }
+    int blockSamples() const
+    {
+        return m_blockSamples;
+    }
+    int capacity() const
+    {
+        return m_capacity;
+    }
+    //A trial is being recorded (acquisition thread)
+    bool isOpen() const
+    {
+        return opened;
+    }
+    //Samples handed over in the current (or last) trial
+    int samples() const
+    {
+        return m_samples;
+    }
+    int events() const
+    {
+        return m_events;
+    }
+    //Blocks of the last trial written by WritePending() that were lost
+    //because the ring was full
+    int lostBlocks() const
+    {
+        return m_lostBlocks;
+    }
+
+private:
+    //Entry of the ring
+    enum EntryType{BeginEntry=0, BlockEntry=1, EndEntry=2};
+    struct Entry
+    {
+        EntryType type;
+        int session;
+        int trial;
+        qint64 startTime;
+        SessionStream stream; //Block
+        int sequence; //Block
+        bool final; //Block
+        int count; //Block: samples
+        int lost; //End: blocks lost during the trial
+        TimingStats timing; //End
+    };
+
+    //Fields
+    SessionFileWriter *sessionFile;
+    //Ring: the samples of entry i are at blockStorage + i * m_blockSamples
+    Entry *entries;
+    CursorSample *blockStorage;
+    int m_capacity;
+    quint32 mask;
+    char padding0[64];
+    std::atomic<quint32> head; //Written only by the acquisition thread
+    char padding1[64];
+    std::atomic<quint32> tail; //Written only by the GUI thread
+    char padding2[64];
+    //Acquisition thread
+    QVector<CursorSample> gridBlock;
+    QVector<CursorSample> eventBlock;
+    int gridSequence;
+    int eventSequence;
+    int session;
+    int trial;
+    qint64 startTime;
+    bool opened;
+    int m_blockSamples;
+    int m_samples;
+    int m_events;
+    int lost;
+    //GUI thread
+    DataFileController *gridText;
+    DataFileController *eventText;
+    QString m_textPrefix;
+    int m_lostBlocks;
+
+    //Methods
+    //Acquisition thread
+    bool Push(EntryType _type, SessionStream _stream, QVector<CursorSample> *_block,
+              int _sequence, bool _final, const TimingStats *_timing);
+    void HandOver(SessionStream _stream, QVector<CursorSample> &_block,
+                  int &_sequence, bool _final);
+    //GUI thread
+    void Write(const Entry &_entry, const CursorSample *_samples);
+    QString TextFilename(int _session, int _trial, const QString &_kind) const;
+
+    //Not copyable
+    TrialLog(const TrialLog&);
+    TrialLog& operator=(const TrialLog&);
+};
+
+#endif // TRIALLOG_H
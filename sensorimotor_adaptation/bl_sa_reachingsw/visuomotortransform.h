@@ -0,0 +1,305 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Visuomotor transforms that map the position of the hand to
+ * the position of the visual feedback. A TransformPipeline is a list of
+ * stages fixed at compile time, e.g.
+ *   TransformPipeline<ErrorClampStage, LinearStage, VelocityStage, OffsetStage>
+ * and every event goes through all of them with inlined calls, in double
+ * precision and relative to the origin of the reaches. The result is only
+ * rounded to pixels by the caller.
+ * The parameters of the stages (cosines and sines, matrices, directions)
+ * are computed when they are set, so an event costs a few multiplications
+ * and additions whatever the paradigm:
+ *   LinearStage: rotation, gain and mirror reversal, composed into one
+ *                2x2 matrix (LinearStage::Rotation(-40) * LinearStage::Gain(1.5))
+ *   OffsetStage: constant displacement
+ *   VelocityStage: displacement proportional to the velocity of the hand
+ *                  (shear or curl, like a velocity-dependent force field)
+ *   ErrorClampStage: the feedback moves along a fixed direction, at the
+ *                    distance of the hand from the origin
+ * A stage is a class with Apply(x, y, motion) and a static usesVelocity; the
+ * velocity of the hand is only computed if a stage of the pipeline needs it.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef VISUOMOTORTRANSFORM_H
+#define VISUOMOTORTRANSFORM_H
+
+#include <QtGlobal>
+#include <tuple>
+#include <cmath>
+
+//Position and velocity of the hand relative to the origin
+struct TransformMotion
+{
+    double x; //pixels
+    double y;
+    double vx; //pixels/s (0 if no stage uses the velocity)
+    double vy;
+};
+
+//Rotation, gain and mirror reversal: feedback = M * hand
+class LinearStage
+{
+public:
+    static const bool usesVelocity = false;
+
+    //Identity
+    LinearStage() : m11(1), m12(0), m21(0), m22(1) {}
+    LinearStage(double _m11, double _m12, double _m21, double _m22) :
+        m11(_m11), m12(_m12), m21(_m21), m22(_m22) {}
+
+    //Rotation by the given angle (degrees)
+    //Positive angles turn clockwise on the screen (Y grows downwards),
+    //as in the data recorded by the previous versions
+    static LinearStage Rotation(double _degrees)
+    {
+        double rad = _degrees * (3.14159265358979323846/180.0);
+        double c = cos(rad);
+        double s = sin(rad);
+        return LinearStage(c, -s, s, c);
+    }
+    //Gain of the movement along each axis
+    static LinearStage Gain(double _gainX, double _gainY)
+    {
+        return LinearStage(_gainX, 0, 0, _gainY);
+    }
+    //Mirror reversal about an axis through the origin
+    //_axisDegrees: angle of the axis from the X axis of the screen
+    //(90: left-right reversal, 0: up-down reversal)
+    static LinearStage Mirror(double _axisDegrees)
+    {
+        double rad = 2 * _axisDegrees * (3.14159265358979323846/180.0);
+        double c = cos(rad);
+        double s = sin(rad);
+        return LinearStage(c, s, s, -c);
+    }
+
+    //Composition: (A * B) applies B first
+    LinearStage operator*(const LinearStage &_b) const
+    {
+        return LinearStage(m11*_b.m11 + m12*_b.m21, m11*_b.m12 + m12*_b.m22,
+                           m21*_b.m11 + m22*_b.m21, m21*_b.m12 + m22*_b.m22);
+    }
+
+    void Apply(double &_x, double &_y, const TransformMotion &) const
+    {
+        double x = m11*_x + m12*_y;
+        _y = m21*_x + m22*_y;
+        _x = x;
+    }
+
+private:
+    double m11, m12, m21, m22;
+};
+
+//Constant displacement (pixels)
+class OffsetStage
+{
+public:
+    static const bool usesVelocity = false;
+
+    OffsetStage(double _dx = 0, double _dy = 0) : dx(_dx), dy(_dy) {}
+
+    void Apply(double &_x, double &_y, const TransformMotion &) const
+    {
+        _x += dx;
+        _y += dy;
+    }
+
+private:
+    double dx, dy;
+};
+
+//Displacement proportional to the velocity of the hand: feedback += B * v
+//B is in seconds (pixels of displacement per pixel/s of velocity)
+class VelocityStage
+{
+public:
+    static const bool usesVelocity = true;
+
+    //No displacement
+    VelocityStage() : b11(0), b12(0), b21(0), b22(0) {}
+    VelocityStage(double _b11, double _b12, double _b21, double _b22) :
+        b11(_b11), b12(_b12), b21(_b21), b22(_b22) {}
+
+    //Displacement perpendicular to the velocity (curl field)
+    //_seconds > 0: to the right of the movement on the screen
+    static VelocityStage Curl(double _seconds)
+    {
+        return VelocityStage(0, -_seconds, _seconds, 0);
+    }
+    //Displacement along X proportional to the velocity along Y
+    static VelocityStage Shear(double _seconds)
+    {
+        return VelocityStage(0, _seconds, 0, 0);
+    }
+
+    void Apply(double &_x, double &_y, const TransformMotion &_motion) const
+    {
+        _x += b11*_motion.vx + b12*_motion.vy;
+        _y += b21*_motion.vx + b22*_motion.vy;
+    }
+
+private:
+    double b11, b12, b21, b22;
+};
+
+//Error clamp: the feedback follows a fixed direction from the origin,
+//at the distance of the point that reaches this stage
+class ErrorClampStage
+{
+public:
+    static const bool usesVelocity = false;
+
+    //Disabled
+    ErrorClampStage() : enabled(false), ux(0), uy(-1) {}
+
+    //Direction of the clamp (need not be normalized), e.g. from the origin
+    //to the target of the trial
+    void setDirection(double _dx, double _dy)
+    {
+        double norm = sqrt(_dx*_dx + _dy*_dy);
+        if(norm > 0)
+        {
+            ux = _dx / norm;
+            uy = _dy / norm;
+        }
+    }
+    void setEnabled(bool _enabled)
+    {
+        enabled = _enabled;
+    }
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    void Apply(double &_x, double &_y, const TransformMotion &) const
+    {
+        if(!enabled)
+            return;
+        double distance = sqrt(_x*_x + _y*_y);
+        _x = distance * ux;
+        _y = distance * uy;
+    }
+
+private:
+    bool enabled;
+    double ux, uy;
+};
+
+//Whether any of the stages needs the velocity of the hand
+template<typename... Stages> struct TransformUsesVelocity;
+template<> struct TransformUsesVelocity<>
+{
+    static const bool value = false;
+};
+template<typename First, typename... Rest> struct TransformUsesVelocity<First, Rest...>
+{
+    static const bool value = First::usesVelocity || TransformUsesVelocity<Rest...>::value;
+};
+
+//Applies the stages N to Count-1 of the tuple, in order
+template<int N, int Count> struct TransformStages
+{
+    template<typename Tuple>
+    static void Apply(const Tuple &_stages, double &_x, double &_y, const TransformMotion &_motion)
+    {
+        std::get<N>(_stages).Apply(_x, _y, _motion);
+        TransformStages<N+1, Count>::Apply(_stages, _x, _y, _motion);
+    }
+};
+template<int Count> struct TransformStages<Count, Count>
+{
+    template<typename Tuple>
+    static void Apply(const Tuple &, double &, double &, const TransformMotion &) {}
+};
+
+template<typename... Stages>
+class TransformPipeline
+{
+public:
+    TransformPipeline() : originX(0), originY(0)
+    {
+        this->ResetMotion();
+    }
+
+    //Stage N of the pipeline, to change its parameters
+    template<int N>
+    typename std::tuple_element<N, std::tuple<Stages...> >::type& stage()
+    {
+        return std::get<N>(this->stages);
+    }
+
+    //Point around which the transforms are applied
+    void setOrigin(double _x, double _y)
+    {
+        originX = _x;
+        originY = _y;
+    }
+
+    //Forgets the previous position of the hand (the next velocity is 0)
+    void ResetMotion()
+    {
+        this->hasPrevious = false;
+        this->previousX = 0;
+        this->previousY = 0;
+        this->previousTime = 0;
+        this->vx = 0;
+        this->vy = 0;
+    }
+
+    //Position of the feedback for the hand at (_x, _y) at time _timestamp (ns)
+    void Apply(double _x, double _y, qint64 _timestamp, double &_outX, double &_outY)
+    {
+        TransformMotion motion;
+        motion.x = _x - originX;
+        motion.y = _y - originY;
+        motion.vx = 0;
+        motion.vy = 0;
+        if(TransformUsesVelocity<Stages...>::value)
+        {
+            //Events with the same timestamp keep the previous velocity
+            qint64 dt = _timestamp - this->previousTime;
+            if(!this->hasPrevious)
+                this->hasPrevious = true;
+            else if(dt > 0)
+            {
+                this->vx = (_x - this->previousX) * 1e9 / dt;
+                this->vy = (_y - this->previousY) * 1e9 / dt;
+            }
+            this->previousX = _x;
+            this->previousY = _y;
+            this->previousTime = _timestamp;
+            motion.vx = this->vx;
+            motion.vy = this->vy;
+        }
+
+        double x = motion.x;
+        double y = motion.y;
+        TransformStages<0, sizeof...(Stages)>::Apply(this->stages, x, y, motion);
+        _outX = x + originX;
+        _outY = y + originY;
+    }
+
+private:
+    std::tuple<Stages...> stages;
+    double originX;
+    double originY;
+    //Previous position of the hand, for the velocity
+    bool hasPrevious;
+    double previousX;
+    double previousY;
+    qint64 previousTime;
+    double vx;
+    double vy;
+};
+
+#endif // VISUOMOTORTRANSFORM_H
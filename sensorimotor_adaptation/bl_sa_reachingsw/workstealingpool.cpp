@@ -0,0 +1,116 @@
+/* FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+*/
+
+#include "workstealingpool.h"
+
+//Default constructor
+WorkStealingPool::WorkStealingPool(int _threads)
+{
+    this->m_threads = qMax(1, _threads);
+    this->m_steals = 0;
+    for(int i=0; i<this->m_threads; i++)
+        this->vRanges.push_back(new Range());
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    for(int i=0; i<this->vRanges.size(); i++)
+        delete this->vRanges.at(i);
+}
+
+void WorkStealingPool::Run(int _tasks, std::function<void(int)> _task)
+{
+    this->task = _task;
+    this->m_steals = 0;
+    //Contiguous ranges of the same size
+    for(int i=0; i<this->m_threads; i++)
+    {
+        this->vRanges.at(i)->front = (int)((qint64)_tasks * i / this->m_threads);
+        this->vRanges.at(i)->back = (int)((qint64)_tasks * (i + 1) / this->m_threads);
+    }
+    //The calling thread is the first worker
+    QVector<Worker*> workers;
+    for(int i=1; i<this->m_threads; i++)
+    {
+        workers.push_back(new Worker(this, i));
+        workers.last()->start();
+    }
+    this->Work(0);
+    for(int i=0; i<workers.size(); i++)
+    {
+        workers.at(i)->wait();
+        delete workers.at(i);
+    }
+}
+
+void WorkStealingPool::Work(int _worker)
+{
+    //A stolen range can be emptied by a thief before this worker pops from
+    //it, so the worker only retires when there is nothing left to steal
+    int next;
+    while(true)
+    {
+        if(this->Pop(_worker, next))
+            this->task(next);
+        else if(!this->Steal(_worker))
+            break;
+    }
+}
+
+//Takes the last task of the range of the worker
+bool WorkStealingPool::Pop(int _worker, int &_task)
+{
+    Range *range = this->vRanges.at(_worker);
+    QMutexLocker lock(&range->mutex);
+    if(range->front >= range->back)
+        return false;
+    _task = --range->back;
+    return true;
+}
+
+//Moves the front half of the largest range of the other workers to the
+//range of this worker; false when every range is empty
+bool WorkStealingPool::Steal(int _worker)
+{
+    while(true)
+    {
+        int victim = -1;
+        int largest = 0;
+        for(int i=1; i<this->m_threads; i++)
+        {
+            int other = (_worker + i) % this->m_threads;
+            Range *range = this->vRanges.at(other);
+            QMutexLocker lock(&range->mutex);
+            if(range->back - range->front > largest)
+            {
+                largest = range->back - range->front;
+                victim = other;
+            }
+        }
+        if(victim < 0)
+            return false;
+
+        int front, back;
+        {
+            Range *range = this->vRanges.at(victim);
+            QMutexLocker lock(&range->mutex);
+            //The range may have been emptied since it was chosen
+            int count = range->back - range->front;
+            if(count <= 0)
+                continue;
+            front = range->front;
+            back = front + (count + 1) / 2;
+            range->front = back;
+        }
+        Range *own = this->vRanges.at(_worker);
+        QMutexLocker lock(&own->mutex);
+        own->front = front;
+        own->back = back;
+        this->m_steals++;
+        return true;
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * ----------------------------------------------------------------------------
+ * FEDERAL UNIVERSITY OF UBERLÂNDIA
+ * Faculty of Electrical Engineering
+ * Biomedical Engineering Laboratory
+ * Author: Andrei Nakagawa, MSc
+ * contact: andrei.ufu@gmail.com
+ * ----------------------------------------------------------------------------
+ * Description: Runs a number of independent tasks on a fixed number of
+ * threads (see bl_sa_fit). The tasks are dealt to the workers in contiguous
+ * ranges; each worker runs its range from the back, and a worker that has
+ * run out of tasks steals the front half of the range of another worker.
+ * The tasks of the fits take very different times (grid searches, starts
+ * that converge slowly), so the work is balanced without knowing the cost
+ * of each task in advance. Each range has its own lock, taken once per
+ * task, which is negligible next to tasks of milliseconds.
+ * ----------------------------------------------------------------------------
+ * */
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <functional>
+#include <atomic>
+
+class WorkStealingPool
+{
+public:
+    //Constructor
+    WorkStealingPool(int _threads);
+    ~WorkStealingPool();
+
+    //Methods
+    //Runs _task(i) for every i in [0, _tasks) and returns when all have run
+    void Run(int _tasks, std::function<void(int)> _task);
+
+    //Getters
+    int threads() const
+    {
+        return m_threads;
+    }
+    //Ranges stolen during the last Run()
+    int steals() const
+    {
+        return m_steals;
+    }
+
+private:
+    //Tasks [front, back) of a worker
+    struct Range
+    {
+        QMutex mutex;
+        int front;
+        int back;
+    };
+    class Worker : public QThread
+    {
+    public:
+        Worker(WorkStealingPool *_pool, int _index) : pool(_pool), index(_index) {}
+    protected:
+        void run()
+        {
+            pool->Work(index);
+        }
+    private:
+        WorkStealingPool *pool;
+        int index;
+    };
+
+    //Fields
+    int m_threads;
+    QVector<Range*> vRanges;
+    std::function<void(int)> task;
+    std::atomic<int> m_steals;
+
+    //Methods
+    void Work(int _worker);
+    bool Pop(int _worker, int &_task);
+    bool Steal(int _worker);
+};
+
+#endif // WORKSTEALINGPOOL_H